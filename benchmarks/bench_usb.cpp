@@ -0,0 +1,327 @@
+#include <benchmark/benchmark.h>
+#include <libudev.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "services/usb/usb_service.h"
+
+// Micro-benchmarks for the USB detection hot path (Linux)
+//
+// The Sysfs* benchmarks run against a synthetic /sys/bus/usb/devices tree and
+// need no hardware, so they are suitable for tracking regressions on CI:
+//   ./bench_usb --benchmark_filter=Sysfs --benchmark_counters_tabular=true
+// The *Context benchmarks enumerate the real bus of the machine they run on.
+
+namespace {
+
+// Heap allocations made by the process, reported per iteration
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+/**
+ * Counts allocations over a benchmark loop
+ */
+class AllocationCounter {
+public:
+    AllocationCounter() : m_start(g_allocations.load(std::memory_order_relaxed)) {}
+    
+    void report(benchmark::State& state) const {
+        const uint64_t count = g_allocations.load(std::memory_order_relaxed) - m_start;
+        state.counters["allocs"] = benchmark::Counter(static_cast<double>(count),
+                                                      benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    uint64_t m_start;
+};
+
+/**
+ * Temporary directory shaped like /sys/bus/usb/devices with N devices
+ * Device i is attached at bus 1 + i / 1000, ports (i / 100 % 10 + 1).(i / 10 % 10 + 1).(i % 10 + 1)
+ */
+class FakeSysfsTree {
+public:
+    explicit FakeSysfsTree(int count) {
+        char pattern[] = "/tmp/bench_usb_sysfs.XXXXXX";
+        if (!mkdtemp(pattern)) {
+            std::perror("mkdtemp");
+            std::abort();
+        }
+        m_root = pattern;
+        
+        for (int i = 0; i < count; ++i) {
+            addDevice(i, 1 + i);
+        }
+    }
+    
+    ~FakeSysfsTree() {
+        nftw(m_root.c_str(), [](const char* path, const struct stat*, int, struct FTW*) {
+            return remove(path);
+        }, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    
+    const std::string& root() const { return m_root; }
+    
+    /**
+     * Create (or re-create with another device number) device i
+     */
+    void addDevice(int i, int devnum) {
+        const std::string path = devicePath(i);
+        mkdir(path.c_str(), 0755);
+        
+        char value[64];
+        snprintf(value, sizeof(value), "%04x", 0x1000 + i % 0x1000);
+        writeAttribute(path, "idVendor", value);
+        snprintf(value, sizeof(value), "%04x", i / 0x1000);
+        writeAttribute(path, "idProduct", value);
+        snprintf(value, sizeof(value), "SN%08d", i);
+        writeAttribute(path, "serial", value);
+        snprintf(value, sizeof(value), "%d", devnum);
+        writeAttribute(path, "devnum", value);
+        writeAttribute(path, "manufacturer", "Bench");
+        snprintf(value, sizeof(value), "Device %d", i);
+        writeAttribute(path, "product", value);
+    }
+    
+    void removeDevice(int i) {
+        const std::string path = devicePath(i);
+        for (const char* name : {"idVendor", "idProduct", "serial", "devnum", "manufacturer", "product"}) {
+            unlink((path + "/" + name).c_str());
+        }
+        rmdir(path.c_str());
+    }
+
+private:
+    std::string devicePath(int i) const {
+        char name[64];
+        snprintf(name, sizeof(name), "/%d-%d.%d.%d", 1 + i / 1000, i / 100 % 10 + 1, i / 10 % 10 + 1, i % 10 + 1);
+        return m_root + name;
+    }
+    
+    static void writeAttribute(const std::string& dir, const char* name, const char* value) {
+        FILE* file = std::fopen((dir + "/" + name).c_str(), "w");
+        if (file) {
+            std::fprintf(file, "%s\n", value);
+            std::fclose(file);
+        }
+    }
+    
+    std::string m_root;
+};
+
+/**
+ * One tree per device count, shared by all benchmarks and removed at exit
+ */
+FakeSysfsTree& fakeTree(int count) {
+    static std::map<int, std::unique_ptr<FakeSysfsTree>> trees;
+    auto& tree = trees[count];
+    if (!tree) {
+        tree = std::make_unique<FakeSysfsTree>(count);
+    }
+    return *tree;
+}
+
+void deviceCounts(benchmark::internal::Benchmark* benchmark) {
+    benchmark->Arg(10)->Arg(100)->Arg(1000)->Arg(10000);
+}
+
+// Steady state: every device is already cached, nothing changed
+void BM_SysfsRescanUnchanged(benchmark::State& state) {
+    FakeSysfsTree& tree = fakeTree(static_cast<int>(state.range(0)));
+    UsbService service;
+    service.setSysfsRoot(tree.root());
+    service.rescan();
+    
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        auto snapshot = service.rescan();
+        benchmark::DoNotOptimize(snapshot);
+    }
+    allocations.report(state);
+    state.counters["devices"] = static_cast<double>(service.snapshot()->devices.size());
+}
+BENCHMARK(BM_SysfsRescanUnchanged)->Apply(deviceCounts)->Unit(benchmark::kMicrosecond);
+
+// Cold cache: every device attribute is read and interned again
+void BM_SysfsEnumerateCold(benchmark::State& state) {
+    FakeSysfsTree& tree = fakeTree(static_cast<int>(state.range(0)));
+    
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        UsbService service;
+        service.setSysfsRoot(tree.root());
+        auto snapshot = service.rescan();
+        benchmark::DoNotOptimize(snapshot);
+    }
+    allocations.report(state);
+}
+BENCHMARK(BM_SysfsEnumerateCold)->Apply(deviceCounts)->Unit(benchmark::kMicrosecond);
+
+// One device re-attaches per pass: enumeration, diff, snapshot publication
+// and listener notification
+void BM_SysfsDetectChange(benchmark::State& state) {
+    const int count = static_cast<int>(state.range(0));
+    FakeSysfsTree& tree = fakeTree(count);
+    UsbService service;
+    service.setSysfsRoot(tree.root());
+    
+    size_t notified = 0;
+    service.setOnDevicesChanged([&notified](const DeviceDelta& delta) {
+        notified += delta.added.size() + delta.removed.size();
+    });
+    service.rescan();
+    
+    bool present = true;
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        state.PauseTiming();
+        if (present) {
+            tree.removeDevice(count / 2);
+        } else {
+            tree.addDevice(count / 2, 1 + count / 2);
+        }
+        present = !present;
+        state.ResumeTiming();
+        
+        auto snapshot = service.rescan();
+        benchmark::DoNotOptimize(snapshot);
+    }
+    allocations.report(state);
+    state.counters["notified"] = benchmark::Counter(static_cast<double>(notified),
+                                                    benchmark::Counter::kAvgIterations);
+    
+    if (!present) {
+        tree.addDevice(count / 2, 1 + count / 2);
+    }
+}
+BENCHMARK(BM_SysfsDetectChange)->Apply(deviceCounts)->Unit(benchmark::kMicrosecond);
+
+// Diff alone: hashed comparison of two device sets differing by one device
+void BM_DiffDeviceSets(benchmark::State& state) {
+    const int count = static_cast<int>(state.range(0));
+    StringPool pool;
+    std::vector<UsbDevice> previous;
+    for (int i = 0; i < count; ++i) {
+        UsbDeviceKey key;
+        key.vendorId = static_cast<uint16_t>(0x1000 + i % 0x1000);
+        key.productId = static_cast<uint16_t>(i / 0x1000);
+        key.serialHash = static_cast<uint32_t>(i + 1);
+        previous.emplace_back(pool, formatDeviceId(key), "Device");
+    }
+    std::vector<UsbDevice> current = previous;
+    current.erase(current.begin() + count / 2);
+    
+    DeviceIndex previousIndex;
+    DeviceIndex currentIndex;
+    DeviceDelta delta;
+    
+    // Indexes are rebuilt every pass, as in UsbService
+    AllocationCounter allocations;
+    for (auto _ : state) {
+        previousIndex.rebuild(previous);
+        currentIndex.rebuild(current);
+        computeDeviceDelta(previous, previousIndex, current, currentIndex, delta);
+        benchmark::DoNotOptimize(delta);
+    }
+    allocations.report(state);
+}
+BENCHMARK(BM_DiffDeviceSets)->Apply(deviceCounts)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Reference implementation of the enumeration as it was before the udev
+ * context and sysattr reads were cached: a new context, enumerator and
+ * udev_device per node on every call
+ */
+std::vector<UsbDevice> enumerateWithFreshContext(StringPool& pool) {
+    std::vector<UsbDevice> devices;
+    
+    struct udev* udev = udev_new();
+    if (!udev) {
+        return devices;
+    }
+    
+    struct udev_enumerate* enumerate = udev_enumerate_new(udev);
+    udev_enumerate_add_match_subsystem(enumerate, "usb");
+    udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
+    udev_enumerate_scan_devices(enumerate);
+    
+    struct udev_list_entry* dev_list_entry;
+    udev_list_entry_foreach(dev_list_entry, udev_enumerate_get_list_entry(enumerate)) {
+        struct udev_device* dev = udev_device_new_from_syspath(udev, udev_list_entry_get_name(dev_list_entry));
+        if (!dev) continue;
+        
+        const char* vid = udev_device_get_sysattr_value(dev, "idVendor");
+        const char* pid = udev_device_get_sysattr_value(dev, "idProduct");
+        const char* product = udev_device_get_sysattr_value(dev, "product");
+        const char* manufacturer = udev_device_get_sysattr_value(dev, "manufacturer");
+        if (vid && pid) {
+            std::string friendlyName = manufacturer && product
+                ? std::string(manufacturer) + " " + product
+                : (product ? std::string(product) : std::string("Unknown USB Device"));
+            devices.emplace_back(pool, "USB_VID_" + std::string(vid) + "&PID_" + std::string(pid),
+                                 friendlyName);
+        }
+        udev_device_unref(dev);
+    }
+    
+    udev_enumerate_unref(enumerate);
+    udev_unref(udev);
+    return devices;
+}
+
+void BM_EnumerateFreshContext(benchmark::State& state) {
+    StringPool pool;
+    size_t count = 0;
+    for (auto _ : state) {
+        auto devices = enumerateWithFreshContext(pool);
+        count = devices.size();
+        benchmark::DoNotOptimize(devices);
+    }
+    state.counters["devices"] = static_cast<double>(count);
+}
+BENCHMARK(BM_EnumerateFreshContext)->Unit(benchmark::kMicrosecond);
+
+void BM_EnumeratePersistentContext(benchmark::State& state) {
+    UsbService service;
+    service.initialize();
+    
+    size_t count = 0;
+    for (auto _ : state) {
+        auto devices = service.rescan();
+        count = devices->devices.size();
+        benchmark::DoNotOptimize(devices);
+    }
+    state.counters["devices"] = static_cast<double>(count);
+}
+BENCHMARK(BM_EnumeratePersistentContext)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
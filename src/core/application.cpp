@@ -3,7 +3,7 @@
 #include "application.h"
 #include "utils.h"
 #include "config.h"
-#include <iostream>
+#include "logger.h"
 #include <vector>
 #include <thread>
 #include <chrono>
@@ -16,18 +16,40 @@ std::vector<UsbDevice> Application::getConnectedUsbDevices() const {
     return {};
 }
 
+UsbService::DeviceSnapshot Application::getUsbDeviceSnapshot() const {
+    return m_usbService->snapshot();
+}
+
+UsbService::DeviceSnapshot Application::rescanUsbDevices() {
+    return m_usbService->rescan();
+}
+
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
 Application::Application() 
-    : m_isRunning(false), m_isSelectedDeviceConnected(false) {
+    : m_isRunning(false), m_isSelectedDeviceConnected(false), m_debounceFlushScheduled(false) {
     
     // Initialize services
     m_displayService = std::make_unique<DisplayService>();
     m_usbService = std::make_unique<UsbService>();
     m_storageService = std::make_unique<StorageService>();
     m_autostartService = std::make_unique<AutostartService>();
+    
+    // One timer thread serves every delayed display operation
+    m_timerScheduler = std::make_shared<TimerScheduler>();
+    m_displayService->setScheduler(m_timerScheduler);
+    
+    // Settled device transitions reach the handlers below
+    m_deviceDebouncer.setOnTransition([this](const UsbDevice& device, bool connected,
+                                             DeviceDebouncer::Clock::time_point detectedAt) {
+        if (connected) {
+            onDeviceConnected(device, detectedAt);
+        } else {
+            onDeviceDisconnected(device, detectedAt);
+        }
+    });
 }
 
 Application::~Application() {
@@ -35,81 +57,94 @@ Application::~Application() {
 }
 
 void Application::setLogCallback(std::function<void(const std::string&)> logCallback) {
-    // Store the callback for UI logging
     m_uiLogCallback = logCallback;
-    
-    // Pass the log callback to the storage service
-    if (m_storageService) {
-        m_storageService->setLogCallback(logCallback);
+    if (!logCallback) {
+        Logger::instance().setUiSink(nullptr);
+        return;
     }
     
-    // Pass the log callback to the display service
-    if (m_displayService) {
-        m_displayService->setLogCallback(logCallback);
-    }
+    // Messages from every thread reach the UI in batches, on the main thread
+    Logger::instance().setUiSink([this](std::vector<Logger::Entry> entries) {
+        auto deliver = [this, entries = std::move(entries)]() {
+            if (!m_uiLogCallback) {
+                return;
+            }
+            for (const Logger::Entry& entry : entries) {
+                m_uiLogCallback(entry.message);
+            }
+        };
+        if (m_mainThreadInvoker) {
+            m_mainThreadInvoker(std::move(deliver), 0);
+        } else {
+            deliver();
+        }
+    });
 }
 
-void Application::logToUI(const std::string& message) {
-    // Log to console
-    std::cout << "[ACTIVITY] " << message << std::endl;
-    
-    // Log to UI if callback is available
-    if (m_uiLogCallback) {
-        m_uiLogCallback(message);
-    }
+void Application::setMainThreadInvoker(MainThreadInvoker invoker) {
+    m_mainThreadInvoker = invoker;
 }
 
 bool Application::initialize() {
-    std::cout << "Initializing " << APP_NAME << "..." << std::endl;
+    LOG_INFO("APP", "Initializing " << APP_NAME << "...");
     
     // Display current platform with detailed information
 #ifdef _WIN32
-    std::cout << "[PLATFORM] Running on: Windows" << std::endl;
-    std::cout << "[PLATFORM] Platform features: Win32 API, Registry autostart, DPMS display control" << std::endl;
+    LOG_INFO("PLATFORM", "Running on: Windows");
+    LOG_INFO("PLATFORM", "Platform features: Win32 API, Registry autostart, DPMS display control");
 #elif defined(__APPLE__)
-    std::cout << "[PLATFORM] Running on: macOS" << std::endl;
-    std::cout << "[PLATFORM] Platform features: IOKit, launchd autostart, CoreGraphics display control" << std::endl;
+    LOG_INFO("PLATFORM", "Running on: macOS");
+    LOG_INFO("PLATFORM", "Platform features: IOKit, launchd autostart, CoreGraphics display control");
 #elif defined(__linux__)
-    std::cout << "[PLATFORM] Running on: Linux" << std::endl;
-    std::cout << "[PLATFORM] Platform features: X11/udev, XDG autostart, DPMS display control" << std::endl;
+    LOG_INFO("PLATFORM", "Running on: Linux");
+    LOG_INFO("PLATFORM", "Platform features: X11/udev, XDG autostart, DPMS display control");
 #else
-    std::cout << "[PLATFORM] Running on: Unknown Platform" << std::endl;
-    std::cout << "[PLATFORM] Warning: Some features may not be available" << std::endl;
+    LOG_INFO("PLATFORM", "Running on: Unknown Platform");
+    LOG_WARNING("PLATFORM", "Some features may not be available");
 #endif
     
     // Initialize storage service first
     if (!m_storageService->initialize()) {
-        std::cerr << "Failed to initialize storage service" << std::endl;
+        LOG_ERROR("APP", "Failed to initialize storage service");
         return false;
     }
     
     // Initialize USB service
     if (!m_usbService->initialize()) {
-        std::cerr << "Failed to initialize USB service" << std::endl;
+        LOG_ERROR("APP", "Failed to initialize USB service");
         return false;
     }
     
-    // Set up USB device callbacks
-    m_usbService->setOnDeviceConnected(
-        [this](const UsbDevice& device) { onDeviceConnected(device); }
+    // Set up USB device callbacks (one batch per detection pass)
+    m_usbService->setOnDevicesChanged(
+        [this](const DeviceDelta& delta) { onDevicesChanged(delta); }
     );
     
-    m_usbService->setOnDeviceDisconnected(
-        [this](const UsbDevice& device) { onDeviceDisconnected(device); }
+    // Raised on the monitor thread itself, ahead of the debounced events
+    m_usbService->setOnWakeHint(
+        [this](std::chrono::steady_clock::time_point hintedAt) { onWakeHint(hintedAt); }
     );
     
+    // Hand events from the monitor thread over to the UI thread, so device
+    // handling never races with the UI or the display service
+    if (m_mainThreadInvoker) {
+        m_usbService->setEventNotifier([this]() {
+            m_mainThreadInvoker([this]() { m_usbService->dispatchPendingEvents(); }, 0);
+        });
+    }
+    
     // Start USB monitoring
     if (!m_usbService->startMonitoring()) {
-        std::cerr << "Failed to start USB monitoring" << std::endl;
+        LOG_ERROR("APP", "Failed to start USB monitoring");
         return false;
     }
     
-    std::cout << "Application initialized successfully" << std::endl;
+    LOG_INFO("APP", "Application initialized successfully");
     return true;
 }
 
 void Application::startConfiguration() {
-    std::cout << "Starting application configuration..." << std::endl;
+    LOG_DEBUG("APP", "Starting application configuration...");
     
     // Load configuration
     loadConfiguration();
@@ -118,9 +153,22 @@ void Application::startConfiguration() {
     if (!m_config.selectedDeviceId.empty()) {
         m_isSelectedDeviceConnected = m_usbService->isDeviceConnected(m_config.selectedDeviceId);
         m_selectedDeviceId = m_config.selectedDeviceId;
+        
+        // Only the selected device matters for screen control
+        m_usbService->watchDevice(m_selectedDeviceId);
     }
     
-    std::cout << "Application configuration completed" << std::endl;
+    // Edits to the file (configuration management, a text editor) apply
+    // to the running services, on the main thread like device events
+    m_storageService->startWatching([this](const AppConfig& config) {
+        if (m_mainThreadInvoker) {
+            m_mainThreadInvoker([this, config]() { applyConfiguration(config); }, 0);
+        } else {
+            applyConfiguration(config);
+        }
+    });
+    
+    LOG_DEBUG("APP", "Application configuration completed");
 }
 
 int Application::run() {
@@ -130,8 +178,8 @@ int Application::run() {
     
     m_isRunning = true;
     
-    std::cout << "Application running. Selected device: " 
-              << (m_selectedDeviceId.empty() ? "None" : m_selectedDeviceId) << std::endl;
+    LOG_INFO("APP", "Application running. Selected device: "
+             << (m_selectedDeviceId.empty() ? "None" : m_selectedDeviceId));
     
 #ifdef _WIN32
     // Windows message loop
@@ -149,19 +197,28 @@ int Application::run() {
 }
 
 void Application::shutdown() {
-    std::cout << "Shutting down application..." << std::endl;
+    // The window may already be gone; what follows goes to the console only
+    Logger::instance().setUiSink(nullptr);
+    LOG_INFO("APP", "Shutting down application...");
     
     m_isRunning = false;
     
-    // Save current configuration
+    // Save current configuration, writing anything still pending; it is
+    // only written if it differs from the file
+    m_storageService->stopWatching();
     saveConfiguration();
+    m_storageService->shutdown();
+    
+    // No delayed display operation may run while the services go away
+    m_timerScheduler->stop();
     
     // Shutdown services
     if (m_usbService) {
         m_usbService->shutdown();
     }
     
-    std::cout << "Application shutdown complete" << std::endl;
+    LOG_INFO("APP", "Application shutdown complete");
+    Logger::instance().flush();
 }
 
 void Application::setSelectedDevice(const std::string& deviceId) {
@@ -170,11 +227,12 @@ void Application::setSelectedDevice(const std::string& deviceId) {
     
     // Check if the device is currently connected
     m_isSelectedDeviceConnected = m_usbService->isDeviceConnected(deviceId);
+    m_usbService->watchDevice(deviceId);
     
     // Save the updated configuration
     saveConfiguration();
     
-    std::cout << "Selected device set to: " << deviceId << std::endl;
+    LOG_DEBUG("APP", "Selected device set to: " << deviceId);
 }
 
 std::string Application::getSelectedDevice() const {
@@ -240,40 +298,99 @@ int Application::getScreenDelay() const {
     return m_config.screenOffDelay;
 }
 
-void Application::testScreenControl(std::function<void(bool)> onComplete) {
-    if (!m_displayService) {
-        std::cerr << "[SCREEN TEST] Display service not available" << std::endl;
-        if (onComplete) onComplete(false);
-        return;
+void Application::setDeviceDebounce(int delayMs) {
+    m_config.deviceDebounceMs = delayMs < 0 ? 0 : delayMs;
+    applyDebounceWindow();
+    saveConfiguration();
+}
+
+int Application::getDeviceDebounce() const {
+    return m_config.deviceDebounceMs;
+}
+
+void Application::setDeviceMatchPolicy(DeviceMatchPolicy policy) {
+    m_config.deviceMatchPolicy = deviceMatchPolicyName(policy);
+    m_usbService->setMatchPolicy(policy);
+    
+    // Re-evaluate the selection under the new rules
+    if (!m_selectedDeviceId.empty()) {
+        m_isSelectedDeviceConnected = m_usbService->isDeviceConnected(m_selectedDeviceId);
+        m_usbService->watchDevice(m_selectedDeviceId);
     }
-    
-    std::cout << "[SCREEN TEST] Starting screen control test..." << std::endl;
-    
-    // Turn off the display
-    bool turnOffSuccess = m_displayService->turnOff();
-    if (!turnOffSuccess) {
-        std::cerr << "[SCREEN TEST] Failed to turn off display" << std::endl;
-        if (onComplete) onComplete(false);
-        return;
+    saveConfiguration();
+}
+
+DeviceMatchPolicy Application::getDeviceMatchPolicy() const {
+    return parseDeviceMatchPolicy(m_config.deviceMatchPolicy);
+}
+
+bool Application::isSelectedDevice(const UsbDevice& device) const {
+    if (m_selectedDeviceId.empty()) {
+        return false;
     }
+    return matchDeviceKey(parseDeviceKey(m_selectedDeviceId), device.key, getDeviceMatchPolicy());
+}
+
+DebounceStats Application::getDeviceEventStats() const {
+    return m_deviceDebouncer.stats();
+}
+
+void Application::applyDebounceWindow() {
+    // The flush timer runs on the UI event loop; without one, act immediately
+    int window = m_mainThreadInvoker ? m_config.deviceDebounceMs : 0;
+    m_deviceDebouncer.setWindow(std::chrono::milliseconds(window));
+    
+    // An early wake is confirmed once the reconnect has settled and reached
+    // the main thread
+    m_displayService->setEarlyWakeTimeout(std::chrono::milliseconds(window) + DisplayService::DefaultEarlyWakeTimeout);
+}
+
+std::future<bool> Application::testScreenControl(std::function<void(bool)> onComplete) {
+    auto outcome = std::make_shared<std::promise<bool>>();
+    std::future<bool> result = outcome->get_future();
+    auto finish = [outcome, onComplete](bool success) {
+        if (onComplete) onComplete(success);
+        outcome->set_value(success);
+    };
     
-    std::cout << "[SCREEN TEST] Display turned off, waiting 1 second..." << std::endl;
+    if (!m_displayService) {
+        LOG_ERROR("SCREEN TEST", "Display service not available");
+        finish(false);
+        return result;
+    }
     
-    // Create a separate thread to wait 1 second and then turn the display back on
-    std::thread([this, onComplete]() {
-        // Wait for 1 second
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        
-        // Turn the display back on
-        bool turnOnSuccess = m_displayService->turnOn();
-        if (turnOnSuccess) {
-            std::cout << "[SCREEN TEST] Display turned back on - test completed successfully" << std::endl;
+    LOG_DEBUG("SCREEN TEST", "Starting screen control test...");
+    
+    // Both commands run on the display command thread; the caller only waits
+    // if it chooses to block on the returned future
+    m_displayService->requestPower(false, [this, finish](DisplayCommandResult off) {
+        // A timed-out turn-off may still blank the screen, so the display is
+        // turned back on before the test is reported as failed
+        const bool turnOffSuccess = off == DisplayCommandResult::Completed;
+        if (off == DisplayCommandResult::TimedOut) {
+            LOG_ERROR("SCREEN TEST", "Turning off the display timed out, turning it back on");
+        } else if (!turnOffSuccess) {
+            LOG_ERROR("SCREEN TEST", "Failed to turn off display (" << displayCommandResultName(off) << ")");
+            finish(false);
+            return;
         } else {
-            std::cerr << "[SCREEN TEST] Failed to turn display back on" << std::endl;
+            LOG_DEBUG("SCREEN TEST", "Display turned off, waiting 1 second...");
         }
         
-        if (onComplete) onComplete(turnOnSuccess);
-    }).detach(); // Detach the thread so it runs independently
+        m_timerScheduler->schedule(std::chrono::seconds(1), [this, finish, turnOffSuccess]() {
+            m_displayService->requestPower(true, [finish, turnOffSuccess](DisplayCommandResult on) {
+                bool turnOnSuccess = on == DisplayCommandResult::Completed;
+                if (!turnOnSuccess) {
+                    LOG_ERROR("SCREEN TEST", "Failed to turn display back on (" << displayCommandResultName(on) << ")");
+                } else if (turnOffSuccess) {
+                    LOG_DEBUG("SCREEN TEST", "Display turned back on - test completed successfully");
+                }
+                
+                finish(turnOffSuccess && turnOnSuccess);
+            });
+        });
+    });
+    return result;
 }
 
 void Application::controlScreen() {
@@ -281,7 +398,7 @@ void Application::controlScreen() {
     if (m_displayService) {
         // This is called from the legacy interface
         // You can implement specific screen control logic here
-        std::cout << "Screen control accessed via legacy interface" << std::endl;
+        LOG_DEBUG("APP", "Screen control accessed via legacy interface");
     }
 }
 
@@ -289,90 +406,217 @@ void Application::managePeripheralIDs() {
     // Manage peripheral IDs
     if (m_usbService) {
         auto devices = m_usbService->getConnectedDevices();
-        std::cout << "Connected USB devices:" << std::endl;
+        LOG_DEBUG("APP", "Connected USB devices:");
         for (const auto& device : devices) {
-            std::cout << "  - " << device.friendlyName << " (" << device.deviceId << ")" << std::endl;
+            LOG_DEBUG("APP", "  - " << device.friendlyName() << " (" << device.deviceId() << ")");
         }
     }
 }
 
-void Application::onDeviceConnected(const UsbDevice& device) {
-    std::cout << "Device connected: " << device.friendlyName << " (" << device.deviceId << ")" << std::endl;
+void Application::onDevicesChanged(const DeviceDelta& delta) {
+    // Hubs re-enumerating behind a KVM switch produce bursts of
+    // disconnect/connect pairs; only the net change per device is handled
+    if (m_deviceDebouncer.submit(delta, DeviceDebouncer::Clock::now())) {
+        scheduleDebounceFlush();
+    }
+}
+
+void Application::scheduleDebounceFlush() {
+    if (m_debounceFlushScheduled || !m_mainThreadInvoker) {
+        return;
+    }
+    
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+        m_deviceDebouncer.nextDeadline() - DeviceDebouncer::Clock::now());
+    int delayMs = wait.count() > 0 ? static_cast<int>(wait.count()) + 1 : 0;
+    
+    m_debounceFlushScheduled = true;
+    m_mainThreadInvoker([this]() {
+        m_debounceFlushScheduled = false;
+        if (m_deviceDebouncer.flush(DeviceDebouncer::Clock::now())) {
+            scheduleDebounceFlush();
+        }
+    }, delayMs);
+}
+
+void Application::onDeviceConnected(const UsbDevice& device, DeviceDebouncer::Clock::time_point detectedAt) {
+    TransitionLatencyTracker::Timeline timeline;
+    timeline.detected = detectedAt;
+    timeline.delivered = TransitionLatencyTracker::Clock::now();
     
     // Log all device connections to UI
-    logToUI("Device connected: " + device.friendlyName + " (" + device.deviceId + ")");
+    LOG_INFO("ACTIVITY", "Device connected: " << device.friendlyName() << " (" << device.deviceId() << ")");
     
     // If this is our selected device, handle reconnection
-    if (device.deviceId == m_selectedDeviceId) {
-        logToUI("Selected device reconnected: " + device.friendlyName);
-        handleSelectedDeviceReconnected();
+    if (isSelectedDevice(device)) {
+        LOG_INFO("ACTIVITY", "Selected device reconnected: " << device.friendlyName());
+        handleSelectedDeviceReconnected(timeline);
     }
+    
+    // After the display work: a sighting costs at most one journal line
+    m_storageService->addKnownDevice(device.deviceId(), device.friendlyName());
 }
 
-void Application::onDeviceDisconnected(const UsbDevice& device) {
-    std::cout << "Device disconnected: " << device.friendlyName << " (" << device.deviceId << ")" << std::endl;
+void Application::onDeviceDisconnected(const UsbDevice& device, DeviceDebouncer::Clock::time_point detectedAt) {
+    TransitionLatencyTracker::Timeline timeline;
+    timeline.detected = detectedAt;
+    timeline.delivered = TransitionLatencyTracker::Clock::now();
     
     // Log all device disconnections to UI
-    logToUI("Device disconnected: " + device.friendlyName + " (" + device.deviceId + ")");
+    LOG_INFO("ACTIVITY", "Device disconnected: " << device.friendlyName() << " (" << device.deviceId() << ")");
     
     // If this is our selected device, handle disconnection
-    if (device.deviceId == m_selectedDeviceId) {
-        logToUI("Selected device disconnected: " + device.friendlyName);
-        handleSelectedDeviceDisconnected();
+    if (isSelectedDevice(device)) {
+        LOG_INFO("ACTIVITY", "Selected device disconnected: " << device.friendlyName());
+        handleSelectedDeviceDisconnected(timeline);
     }
 }
 
-void Application::handleSelectedDeviceDisconnected() {
-    std::cout << "Selected device disconnected - initiating screen control sequence" << std::endl;
-    logToUI("Initiating screen control: turning off display in " + std::to_string(m_config.screenOffDelay) + " seconds");
+void Application::handleSelectedDeviceDisconnected(TransitionLatencyTracker::Timeline timeline) {
+    LOG_DEBUG("APP", "Selected device disconnected - initiating screen control sequence");
+    LOG_INFO("ACTIVITY", "Initiating screen control: turning off display in " << m_config.screenOffDelay << " seconds");
     
     m_isSelectedDeviceConnected = false;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeHintMutex);
+        m_wakeHintAt = TransitionLatencyTracker::Clock::time_point();
+    }
     
-    // Schedule display to turn off after the configured delay
+    // Only the outputs mapped to this device are switched, if any are configured
+    auto outputs = m_config.deviceOutputs.find(m_selectedDeviceId);
+    m_displayService->setTargetOutputs(outputs != m_config.deviceOutputs.end()
+                                       ? outputs->second : std::vector<std::string>());
+    
+    // Schedule display to turn off after the configured delay. This only
+    // queues the command; the backends complete it once the display server
+    // has processed the request
+    timeline.issued = TransitionLatencyTracker::Clock::now();
     m_displayService->scheduleDisplayOff(m_config.screenOffDelay, [this]() {
-        std::cout << "Display turned off due to device disconnection" << std::endl;
-        logToUI("Display automatically turned back on (timeout reached)");
-        
-        // Turn display back on after the off period
-        m_displayService->turnOn();
-        std::cout << "Display turned back on" << std::endl;
+        // The display service has already turned the display back on
+        LOG_INFO("ACTIVITY", "Display automatically turned back on (timeout reached)");
+    }, [this, timeline](DisplayCommandResult result) mutable {
+        if (result == DisplayCommandResult::Completed) {
+            timeline.acknowledged = TransitionLatencyTracker::Clock::now();
+            m_transitionLatency.record(TransitionLatencyTracker::Direction::Off, timeline);
+        }
     });
 }
 
-void Application::handleSelectedDeviceReconnected() {
-    std::cout << "Selected device reconnected - turning display back on" << std::endl;
-    logToUI("Device reconnected: turning display back on");
+void Application::handleSelectedDeviceReconnected(TransitionLatencyTracker::Timeline timeline) {
+    LOG_DEBUG("APP", "Selected device reconnected - turning display back on");
+    LOG_INFO("ACTIVITY", "Device reconnected: turning display back on");
     
     m_isSelectedDeviceConnected = true;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeHintMutex);
+        timeline.hinted = m_wakeHintAt;
+        m_wakeHintAt = TransitionLatencyTracker::Clock::time_point();
+    }
     
     // Handle device reconnection (will cancel scheduled operations and turn display on)
-    m_displayService->onDeviceReconnected();
+    timeline.issued = TransitionLatencyTracker::Clock::now();
+    m_displayService->onDeviceReconnected([this, timeline](DisplayCommandResult result) mutable {
+        if (result == DisplayCommandResult::Completed) {
+            timeline.acknowledged = TransitionLatencyTracker::Clock::now();
+            m_transitionLatency.record(TransitionLatencyTracker::Direction::On, timeline);
+        }
+    });
+}
+
+void Application::onWakeHint(TransitionLatencyTracker::Clock::time_point hintedAt) {
+    // Runs on the USB monitor thread: only thread-safe services are touched
+    TransitionLatencyTracker::Timeline timeline;
+    timeline.detected = hintedAt;
+    timeline.delivered = TransitionLatencyTracker::Clock::now();
+    timeline.issued = timeline.delivered;
+    
+    auto switched = m_displayService->onDeviceReturning([this, timeline](DisplayCommandResult result) mutable {
+        if (result == DisplayCommandResult::Completed) {
+            timeline.acknowledged = TransitionLatencyTracker::Clock::now();
+            m_transitionLatency.record(TransitionLatencyTracker::Direction::EarlyOn, timeline);
+        }
+    });
+    if (!switched.valid()) {
+        return; // The display was not turned off for this device
+    }
+    
+    LOG_DEBUG("APP", "Selected device is coming back, display turning on early");
+    std::lock_guard<std::mutex> lock(m_wakeHintMutex);
+    m_wakeHintAt = hintedAt;
 }
 
 void Application::loadConfiguration() {
-    std::cout << "[APP] Loading application configuration..." << std::endl;
+    LOG_DEBUG("APP", "Loading application configuration...");
     
     m_config = m_storageService->loadConfig();
     m_selectedDeviceId = m_config.selectedDeviceId;
+    m_usbService->setMatchPolicy(parseDeviceMatchPolicy(m_config.deviceMatchPolicy));
+    applyDebounceWindow();
+    m_displayService->setExternalToolFallback(m_config.displayToolFallback);
+    
+    // Probing only happens when the cached backend is missing or gone
+    std::string displayBackend = m_displayService->initialize(m_config.displayBackend);
+    
+    LOG_DEBUG("APP", "Configuration loaded:");
+    LOG_DEBUG("APP", "  - Start on boot: " << (m_config.startOnBoot ? "Yes" : "No"));
+    LOG_DEBUG("APP", "  - Start minimized: " << (m_config.startMinimized ? "Yes" : "No"));
+    LOG_DEBUG("APP", "  - Selected device: " << (m_config.selectedDeviceId.empty() ? "None" : m_config.selectedDeviceId));
+    LOG_DEBUG("APP", "  - Screen off delay: " << m_config.screenOffDelay << " seconds");
+    LOG_DEBUG("APP", "  - Device debounce: " << m_config.deviceDebounceMs << " ms");
+    LOG_DEBUG("APP", "  - Device matching: " << m_config.deviceMatchPolicy);
+    LOG_DEBUG("APP", "  - Display backend: " << (m_config.displayBackend.empty() ? "None" : m_config.displayBackend));
+    LOG_DEBUG("APP", "  - External display tools: " << (m_config.displayToolFallback ? "Allowed" : "Disabled"));
+    LOG_DEBUG("APP", "  - Known devices count: " << m_storageService->knownDevices().size());
+    
+    // The file is only written back when a new backend was probed; settings
+    // missing from it simply keep their defaults
+    if (displayBackend != m_config.displayBackend) {
+        m_config.displayBackend = displayBackend;
+        saveConfiguration();
+    }
+}
+
+void Application::applyConfiguration(const AppConfig& config) {
+    // Only what changed is passed on; the services keep running
+    AppConfig previous = m_config;
+    m_config = config;
+    
+    if (config.displayBackend != previous.displayBackend) {
+        // Switching backends means probing the display system again
+        LOG_INFO("ACTIVITY", "Display backend change takes effect at next start");
+    }
+    if (config.displayToolFallback != previous.displayToolFallback) {
+        m_displayService->setExternalToolFallback(config.displayToolFallback);
+    }
+    if (config.deviceDebounceMs != previous.deviceDebounceMs) {
+        applyDebounceWindow();
+    }
     
-    std::cout << "[APP] Configuration loaded:" << std::endl;
-    std::cout << "[APP]   - Start on boot: " << (m_config.startOnBoot ? "Yes" : "No") << std::endl;
-    std::cout << "[APP]   - Start minimized: " << (m_config.startMinimized ? "Yes" : "No") << std::endl;
-    std::cout << "[APP]   - Selected device: " << (m_config.selectedDeviceId.empty() ? "None" : m_config.selectedDeviceId) << std::endl;
-    std::cout << "[APP]   - Screen off delay: " << m_config.screenOffDelay << " seconds" << std::endl;
-    std::cout << "[APP]   - Known devices count: " << m_config.knownDevices.size() << std::endl;
+    bool policyChanged = config.deviceMatchPolicy != previous.deviceMatchPolicy;
+    if (policyChanged) {
+        m_usbService->setMatchPolicy(parseDeviceMatchPolicy(config.deviceMatchPolicy));
+    }
+    if (policyChanged || config.selectedDeviceId != previous.selectedDeviceId) {
+        m_selectedDeviceId = config.selectedDeviceId;
+        m_isSelectedDeviceConnected = !m_selectedDeviceId.empty()
+            && m_usbService->isDeviceConnected(m_selectedDeviceId);
+        m_usbService->watchDevice(m_selectedDeviceId);
+        LOG_INFO("ACTIVITY", "Selected device: " << (m_selectedDeviceId.empty() ? "None" : m_selectedDeviceId));
+    }
     
-    // Force save configuration to ensure all new fields are written to file
-    // This handles cases where config file was created with older version
-    saveConfiguration();
+    // The delay, start options and outputs are read when they are used
+    if (config.screenOffDelay != previous.screenOffDelay) {
+        LOG_INFO("ACTIVITY", "Screen off delay: " << config.screenOffDelay << " seconds");
+    }
+    
+    // Matches the file already, so nothing is written back
+    if (config.startOnBoot != previous.startOnBoot) {
+        setAutostart(config.startOnBoot);
+    }
 }
 
 void Application::saveConfiguration() {
-    std::cout << "[APP] Saving application configuration..." << std::endl;
-    
-    if (!m_storageService->saveConfig(m_config)) {
-        std::cerr << "[APP] Failed to save configuration" << std::endl;
-    } else {
-        std::cout << "[APP] Configuration saved successfully" << std::endl;
-    }
+    // Written in the background: bursts of settings changes (a spinbox
+    // being dragged) end in a single write, flushed at shutdown
+    m_storageService->saveConfigDeferred(m_config);
 }
\ No newline at end of file
@@ -4,10 +4,15 @@
 #include <memory>
 #include <string>
 #include <functional>
+#include <future>
+#include <mutex>
 #include "../services/display/display_service.h"
 #include "../services/usb/usb_service.h"
 #include "../services/storage/storage_service.h"
 #include "../services/autostart/autostart_service.h"
+#include "device_debouncer.h"
+#include "latency_histogram.h"
+#include "timer_scheduler.h"
 
 /**
  * Main application controller that coordinates all services
@@ -18,110 +23,181 @@ public:
      * Get all currently connected USB devices (for UI)
      */
     std::vector<UsbDevice> getConnectedUsbDevices() const;
+    
+    /**
+     * Get the last known USB device set without enumerating the hardware
+     * @return immutable snapshot, never null
+     */
+    UsbService::DeviceSnapshot getUsbDeviceSnapshot() const;
+    
+    /**
+     * Force a fresh USB enumeration (e.g. the UI refresh button)
+     * @return the updated snapshot
+     */
+    UsbService::DeviceSnapshot rescanUsbDevices();
 public:
+    using MainThreadInvoker = std::function<void(std::function<void()> task, int delayMs)>;
+    
     Application();
     ~Application();
-
+    
+    /**
+     * Set how work is posted to the UI thread
+     * When set before initialize(), USB events are handled on that thread
+     * instead of the USB monitor thread
+     * It is also used to time the device debounce window; without it
+     * device events are handled as soon as they arrive
+     * @param invoker function queuing a task on the UI event loop, after delayMs milliseconds
+     */
+    void setMainThreadInvoker(MainThreadInvoker invoker);
+    
     /**
      * Initialize the application and all services
      * @return true if successful, false otherwise
      */
     bool initialize();
-
+    
     /**
      * Load application configuration from storage
      * Call this after initialize() and UI setup is complete
      */
     void startConfiguration();
-
+    
     /**
      * Set up logging callback for UI integration
-     * @param logCallback function to call for logging messages
+     * Log messages at info level and above, from any thread, are passed to it
+     * on the main thread when a main-thread invoker is set.
+     * @param logCallback function to call for logging messages, nullptr to stop
      */
     void setLogCallback(std::function<void(const std::string&)> logCallback);
-
+    
     /**
      * Run the main application loop
      * @return exit code
      */
     int run();
-
+    
     /**
      * Shutdown the application gracefully
      */
     void shutdown();
-
+    
     /**
      * Set the selected device for monitoring
      * @param deviceId device ID to monitor
      */
     void setSelectedDevice(const std::string& deviceId);
-
+    
     /**
      * Get the currently selected device
      * @return device ID or empty string if none selected
      */
     std::string getSelectedDevice() const;
-
+    
     /**
      * Enable or disable autostart
      * @param enable true to enable, false to disable
      * @return true if successful, false otherwise
      */
     bool setAutostart(bool enable);
-
+    
     /**
      * Check if autostart is enabled
      * @return true if enabled, false otherwise
      */
     bool isAutostartEnabled() const;
-
+    
     /**
      * Set start minimized option
      * @param enable true to start minimized, false to start normally
      */
     void setStartMinimized(bool enable);
-
+    
     /**
      * Check if start minimized is enabled
      * @return true if enabled, false otherwise
      */
     bool isStartMinimizedEnabled() const;
-
+    
     /**
      * Set screen off delay in seconds
      * @param delay delay in seconds before turning off screen
      */
     void setScreenDelay(int delay);
-
+    
     /**
      * Get current screen off delay
      * @return delay in seconds
      */
     int getScreenDelay() const;
-
+    
+    /**
+     * Set the hysteresis window used to coalesce flapping device events
+     * @param delayMs quiet time in milliseconds before a device change is acted on, 0 to disable
+     */
+    void setDeviceDebounce(int delayMs);
+    
+    /**
+     * Get the device debounce window
+     * @return window in milliseconds
+     */
+    int getDeviceDebounce() const;
+    
+    /**
+     * Set how the selected device is recognised among connected devices
+     * @param policy exact identity, model only or port only
+     */
+    void setDeviceMatchPolicy(DeviceMatchPolicy policy);
+    
+    /**
+     * Get the device match policy
+     */
+    DeviceMatchPolicy getDeviceMatchPolicy() const;
+    
+    /**
+     * Check whether a device is the selected one under the match policy
+     * @param device device to test
+     * @return true if it matches the selected device
+     */
+    bool isSelectedDevice(const UsbDevice& device) const;
+    
+    /**
+     * Get counters of raw and suppressed device events
+     */
+    DebounceStats getDeviceEventStats() const;
+    
+    /**
+     * Get the per-stage latency of display switches caused by the selected device
+     */
+    const TransitionLatencyTracker& getTransitionLatency() const { return m_transitionLatency; }
+    
     /**
      * Test screen control by turning display off for 1 second then back on
-     * @param onComplete callback to execute when test completes
+     * Returns immediately; the commands run on the display command thread
+     * @param onComplete callback to execute when test completes (background thread)
+     * @return future resolved with the test outcome
      */
-    void testScreenControl(std::function<void(bool)> onComplete = nullptr);
-
+    std::future<bool> testScreenControl(std::function<void(bool)> onComplete = nullptr);
+    
     // Legacy methods for compatibility
     void start() { initialize(); }
     void controlScreen();
     void managePeripheralIDs();
 
 private:
-    void onDeviceConnected(const UsbDevice& device);
-    void onDeviceDisconnected(const UsbDevice& device);
-    void handleSelectedDeviceDisconnected();
-    void handleSelectedDeviceReconnected();
+    void onDevicesChanged(const DeviceDelta& delta);
+    void scheduleDebounceFlush();
+    void applyDebounceWindow();
+    void onDeviceConnected(const UsbDevice& device, DeviceDebouncer::Clock::time_point detectedAt);
+    void onDeviceDisconnected(const UsbDevice& device, DeviceDebouncer::Clock::time_point detectedAt);
+    void handleSelectedDeviceDisconnected(TransitionLatencyTracker::Timeline timeline);
+    void handleSelectedDeviceReconnected(TransitionLatencyTracker::Timeline timeline);
+    void onWakeHint(TransitionLatencyTracker::Clock::time_point hintedAt);
     void loadConfiguration();
     void saveConfiguration();
+    void applyConfiguration(const AppConfig& config);
     
-    // Helper method to log messages to UI
-    void logToUI(const std::string& message);
-    
+    std::shared_ptr<TimerScheduler> m_timerScheduler;
     std::unique_ptr<DisplayService> m_displayService;
     std::unique_ptr<UsbService> m_usbService;
     std::unique_ptr<StorageService> m_storageService;
@@ -132,6 +208,14 @@ private:
     bool m_isSelectedDeviceConnected;
     std::string m_selectedDeviceId;
     std::function<void(const std::string&)> m_uiLogCallback;
+    MainThreadInvoker m_mainThreadInvoker;
+    DeviceDebouncer m_deviceDebouncer;
+    bool m_debounceFlushScheduled;
+    TransitionLatencyTracker m_transitionLatency;
+    
+    // Set from the USB monitor thread when a wake hint turned the display on
+    std::mutex m_wakeHintMutex;
+    TransitionLatencyTracker::Clock::time_point m_wakeHintAt;
 };
 
 #endif // APPLICATION_H
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "device_debouncer.h"
+#include "logger.h"
+#include <vector>
+
+DeviceDebouncer::DeviceDebouncer() : m_window(0) {
+}
+
+void DeviceDebouncer::setWindow(std::chrono::milliseconds window) {
+    m_window = window < std::chrono::milliseconds(0) ? std::chrono::milliseconds(0) : window;
+}
+
+void DeviceDebouncer::setOnTransition(TransitionCallback callback) {
+    m_onTransition = callback;
+}
+
+bool DeviceDebouncer::submit(const DeviceDelta& delta, Clock::time_point now) {
+    const Clock::time_point detected = delta.detectedAt != Clock::time_point() ? delta.detectedAt : now;
+    for (const auto& device : delta.removed) {
+        record(device, false, detected, now);
+    }
+    for (const auto& device : delta.added) {
+        record(device, true, detected, now);
+    }
+    
+    // Without a window everything is settled right away
+    if (m_window.count() == 0) {
+        return flush(now);
+    }
+    return !m_pending.empty();
+}
+
+void DeviceDebouncer::record(const UsbDevice& device, bool connected, Clock::time_point detected,
+                             Clock::time_point now) {
+    ++m_stats.rawEvents;
+    
+    auto it = m_pending.find(device.identityHash);
+    if (it == m_pending.end()) {
+        PendingDevice pending;
+        pending.device = device;
+        pending.initiallyConnected = !connected;
+        pending.connected = connected;
+        pending.events = 1;
+        pending.firstDetected = detected;
+        pending.lastEvent = now;
+        m_pending.emplace(device.identityHash, std::move(pending));
+        return;
+    }
+    
+    PendingDevice& pending = it->second;
+    if (connected) {
+        pending.device = device;  // keep the newest attributes
+    }
+    pending.connected = connected;
+    pending.events++;
+    pending.lastEvent = now;
+}
+
+bool DeviceDebouncer::flush(Clock::time_point now) {
+    // Collect first: the callback may submit new events
+    std::vector<PendingDevice> settled;
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (now - it->second.lastEvent >= m_window) {
+            settled.push_back(std::move(it->second));
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    for (auto& pending : settled) {
+        if (pending.connected == pending.initiallyConnected) {
+            // The device came back to where it started: nothing to report
+            m_stats.suppressedEvents += pending.events;
+            LOG_DEBUG("USB", "Ignored " << pending.events << " flapping events for "
+                      << pending.device.deviceId());
+            continue;
+        }
+        
+        m_stats.suppressedEvents += pending.events - 1;
+        m_stats.transitions++;
+        if (pending.events > 1) {
+            LOG_DEBUG("USB", "Coalesced " << pending.events << " events for " << pending.device.deviceId());
+        }
+        
+        if (m_onTransition) {
+            pending.device.isConnected = pending.connected;
+            m_onTransition(pending.device, pending.connected, pending.firstDetected);
+        }
+    }
+    
+    return !m_pending.empty();
+}
+
+DeviceDebouncer::Clock::time_point DeviceDebouncer::nextDeadline() const {
+    Clock::time_point deadline = Clock::time_point::max();
+    for (const auto& entry : m_pending) {
+        Clock::time_point settle = entry.second.lastEvent + m_window;
+        if (settle < deadline) {
+            deadline = settle;
+        }
+    }
+    return deadline;
+}
+
+void DeviceDebouncer::reset() {
+    m_pending.clear();
+}
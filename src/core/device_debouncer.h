@@ -0,0 +1,98 @@
+#ifndef DEVICE_DEBOUNCER_H
+#define DEVICE_DEBOUNCER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include "../services/usb/device_index.h"
+
+/**
+ * Counters describing how much device event traffic was coalesced
+ */
+struct DebounceStats {
+    uint64_t rawEvents = 0;         // connect/disconnect events received
+    uint64_t suppressedEvents = 0;  // events that did not produce a transition
+    uint64_t transitions = 0;       // net state changes reported
+};
+
+/**
+ * Collapses bursts of connect/disconnect events into one net transition per device
+ *
+ * A device is reported once no event has been seen for it during the
+ * hysteresis window, and only if its state then differs from the state it
+ * had before the burst (a disconnect/reconnect flap is reported as nothing).
+ * The debouncer has no timer of its own: the owner calls flush() at the
+ * deadline returned by submit()/flush(). Not thread-safe.
+ */
+class DeviceDebouncer {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TransitionCallback = std::function<void(const UsbDevice& device, bool connected,
+                                                  Clock::time_point detectedAt)>;
+    
+    DeviceDebouncer();
+
+    /**
+     * Set the hysteresis window; zero reports every event immediately
+     * @param window quiet time required before a device state is considered settled
+     */
+    void setWindow(std::chrono::milliseconds window);
+    
+    std::chrono::milliseconds window() const { return m_window; }
+
+    /**
+     * Set callback receiving the settled transitions
+     * @param callback function called with the device, its new state and the
+     *                 detection time of the first event of the burst
+     */
+    void setOnTransition(TransitionCallback callback);
+
+    /**
+     * Feed one batch of raw events (removals are applied before additions)
+     * @param delta devices added/removed in one detection pass
+     * @param now time of submission, used for the window; delta.detectedAt
+     *            (when set) is kept as the detection time of the burst
+     * @return true if devices are pending and flush() must be called at nextDeadline()
+     */
+    bool submit(const DeviceDelta& delta, Clock::time_point now);
+
+    /**
+     * Report every device whose window has elapsed
+     * @param now current time
+     * @return true if devices are still pending
+     */
+    bool flush(Clock::time_point now);
+
+    /**
+     * Earliest time at which a pending device settles
+     * @return deadline, or Clock::time_point::max() if nothing is pending
+     */
+    Clock::time_point nextDeadline() const;
+
+    /**
+     * Drop all pending devices without reporting them
+     */
+    void reset();
+
+    const DebounceStats& stats() const { return m_stats; }
+
+private:
+    struct PendingDevice {
+        UsbDevice device;           // last record seen during the burst
+        bool initiallyConnected;    // state before the first event of the burst
+        bool connected;             // state after the latest event
+        uint32_t events;
+        Clock::time_point firstDetected;  // kernel time of the event that opened the burst
+        Clock::time_point lastEvent;
+    };
+    
+    void record(const UsbDevice& device, bool connected, Clock::time_point detected, Clock::time_point now);
+    
+    std::chrono::milliseconds m_window;
+    TransitionCallback m_onTransition;
+    std::unordered_map<uint64_t, PendingDevice> m_pending;  // keyed on identity hash
+    DebounceStats m_stats;
+};
+
+#endif // DEVICE_DEBOUNCER_H
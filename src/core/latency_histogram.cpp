@@ -0,0 +1,200 @@
+#include "latency_histogram.h"
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+constexpr uint64_t LinearLimit = uint64_t(1) << LatencyHistogram::SubBucketBits;
+constexpr uint64_t HalfBuckets = LinearLimit / 2;
+constexpr uint64_t MaxTrackable = (uint64_t(1) << LatencyHistogram::MaxValueBits) - 1;
+
+unsigned highestBit(uint64_t value) {
+    unsigned bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+
+const double ReportedPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+const char* const ReportedPercentileNames[] = {"p50", "p90", "p99", "p999"};
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value > MaxTrackable) {
+        value = MaxTrackable;
+    }
+    if (value < LinearLimit) {
+        return static_cast<size_t>(value);
+    }
+    
+    // Keep the top SubBucketBits-1 bits below the leading one
+    const unsigned shift = highestBit(value) - (SubBucketBits - 1);
+    return static_cast<size_t>(LinearLimit + (shift - 1) * HalfBuckets + ((value >> shift) - HalfBuckets));
+}
+
+uint64_t LatencyHistogram::bucketLowest(size_t index) {
+    if (index < LinearLimit) {
+        return index;
+    }
+    const uint64_t offset = index - LinearLimit;
+    const unsigned shift = static_cast<unsigned>(offset / HalfBuckets) + 1;
+    return (offset % HalfBuckets + HalfBuckets) << shift;
+}
+
+uint64_t LatencyHistogram::bucketHighest(size_t index) {
+    if (index < LinearLimit) {
+        return index;
+    }
+    const unsigned shift = static_cast<unsigned>((index - LinearLimit) / HalfBuckets) + 1;
+    return bucketLowest(index) + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::microseconds value) {
+    const uint64_t micros = value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+    
+    m_counts[bucketIndex(micros)]++;
+    m_count++;
+    m_sum += micros;
+    if (micros < m_min) m_min = micros;
+    if (micros > m_max) m_max = micros;
+}
+
+void LatencyHistogram::reset() {
+    m_counts.fill(0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+}
+
+std::chrono::microseconds LatencyHistogram::min() const {
+    return std::chrono::microseconds(m_count ? m_min : 0);
+}
+
+std::chrono::microseconds LatencyHistogram::max() const {
+    return std::chrono::microseconds(m_max);
+}
+
+std::chrono::microseconds LatencyHistogram::mean() const {
+    return std::chrono::microseconds(m_count ? m_sum / m_count : 0);
+}
+
+std::chrono::microseconds LatencyHistogram::percentile(double percent) const {
+    if (m_count == 0) {
+        return std::chrono::microseconds(0);
+    }
+    if (percent < 0.0) percent = 0.0;
+    if (percent > 100.0) percent = 100.0;
+    
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(m_count)));
+    if (rank == 0) rank = 1;
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; ++i) {
+        seen += m_counts[i];
+        if (seen >= rank) {
+            // The bucket bound may overshoot the largest sample actually seen
+            uint64_t value = bucketHighest(i);
+            return std::chrono::microseconds(value < m_max ? value : m_max);
+        }
+    }
+    return max();
+}
+
+std::string LatencyHistogram::toJson() const {
+    std::ostringstream json;
+    json << "{\"count\":" << m_count
+         << ",\"min\":" << min().count()
+         << ",\"mean\":" << mean().count()
+         << ",\"max\":" << max().count();
+    for (size_t i = 0; i < sizeof(ReportedPercentiles) / sizeof(ReportedPercentiles[0]); ++i) {
+        json << ",\"" << ReportedPercentileNames[i] << "\":" << percentile(ReportedPercentiles[i]).count();
+    }
+    
+    json << ",\"buckets\":[";
+    bool first = true;
+    for (size_t i = 0; i < BucketCount; ++i) {
+        if (m_counts[i] == 0) {
+            continue;
+        }
+        json << (first ? "" : ",") << "[" << bucketHighest(i) << "," << m_counts[i] << "]";
+        first = false;
+    }
+    json << "]}";
+    return json.str();
+}
+
+void TransitionLatencyTracker::record(Direction direction, const Timeline& timeline) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    recordStage(direction, Stage::Delivery, timeline.detected, timeline.delivered);
+    recordStage(direction, Stage::Dispatch, timeline.delivered, timeline.issued);
+    recordStage(direction, Stage::Command, timeline.issued, timeline.acknowledged);
+    recordStage(direction, Stage::Total, timeline.detected, timeline.acknowledged);
+    recordStage(direction, Stage::Lead, timeline.hinted, timeline.detected);
+}
+
+void TransitionLatencyTracker::recordStage(Direction direction, Stage stage,
+                                           Clock::time_point from, Clock::time_point to) {
+    if (from == Clock::time_point() || to == Clock::time_point()) {
+        return;
+    }
+    m_histograms[static_cast<size_t>(direction)][static_cast<size_t>(stage)].record(
+        std::chrono::duration_cast<std::chrono::microseconds>(to - from));
+}
+
+LatencyHistogram TransitionLatencyTracker::histogram(Direction direction, Stage stage) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_histograms[static_cast<size_t>(direction)][static_cast<size_t>(stage)];
+}
+
+std::string TransitionLatencyTracker::toJson() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    std::ostringstream json;
+    json << "{\"unit\":\"us\"";
+    for (size_t d = 0; d < DirectionCount; ++d) {
+        json << ",\"" << directionName(static_cast<Direction>(d)) << "\":{";
+        for (size_t s = 0; s < StageCount; ++s) {
+            json << (s ? "," : "") << "\"" << stageName(static_cast<Stage>(s)) << "\":"
+                 << m_histograms[d][s].toJson();
+        }
+        json << "}";
+    }
+    json << "}";
+    return json.str();
+}
+
+void TransitionLatencyTracker::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& direction : m_histograms) {
+        for (auto& histogram : direction) {
+            histogram.reset();
+        }
+    }
+}
+
+const char* TransitionLatencyTracker::directionName(Direction direction) {
+    switch (direction) {
+        case Direction::Off: return "off";
+        case Direction::On: return "on";
+        case Direction::EarlyOn: return "early on";
+        default: return "unknown";
+    }
+}
+
+const char* TransitionLatencyTracker::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Delivery: return "delivery";
+        case Stage::Dispatch: return "dispatch";
+        case Stage::Command: return "command";
+        case Stage::Total: return "total";
+        case Stage::Lead: return "lead";
+        default: return "unknown";
+    }
+}
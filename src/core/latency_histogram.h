@@ -0,0 +1,145 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * Fixed-size latency histogram with bounded relative error, in the style of
+ * HdrHistogram
+ *
+ * Values are recorded in microseconds. Below 64 us every value has its own
+ * bucket; above, each power of two is split into 32 linear buckets, so a
+ * reported percentile is never more than ~3% above the recorded value.
+ * Values up to 2^40 us (about 12 days) are tracked, larger ones are clamped.
+ * Recording is O(1) and never allocates. Not thread-safe.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SubBucketBits = 6;
+    static constexpr unsigned MaxValueBits = 40;
+    static constexpr size_t BucketCount =
+        (size_t(1) << SubBucketBits) + (MaxValueBits - SubBucketBits) * (size_t(1) << (SubBucketBits - 1));
+    
+    LatencyHistogram();
+    
+    /**
+     * Add one sample; negative durations count as zero
+     * @param value measured latency
+     */
+    void record(std::chrono::microseconds value);
+    
+    /**
+     * Drop every sample
+     */
+    void reset();
+    
+    uint64_t count() const { return m_count; }
+    std::chrono::microseconds min() const;
+    std::chrono::microseconds max() const;
+    std::chrono::microseconds mean() const;
+    
+    /**
+     * Value below or at which a share of the samples fall
+     * @param percent percentile in [0, 100], e.g. 99.9
+     * @return upper bound of the bucket holding that rank, 0 if empty
+     */
+    std::chrono::microseconds percentile(double percent) const;
+    
+    /**
+     * Serialise the summary and the non-empty buckets
+     * @return JSON object; buckets are [highest value, count] pairs
+     */
+    std::string toJson() const;
+    
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketLowest(size_t index);
+    static uint64_t bucketHighest(size_t index);
+
+private:
+    std::array<uint64_t, BucketCount> m_counts;
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_min;
+    uint64_t m_max;
+};
+
+/**
+ * Per-stage latency of display switches triggered by device events
+ *
+ * A switch is timed at four points: the kernel event reaching UsbService,
+ * the settled transition reaching Application, the display command being
+ * issued and the display server acknowledging it. Each stage and the end
+ * to end total feed one histogram per direction. Early wakes started by a
+ * wake hint are kept apart, and a reconnect that was hinted also records
+ * how far ahead of its confirmation the hint came. Thread-safe.
+ */
+class TransitionLatencyTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    enum class Direction {
+        Off,
+        On,
+        EarlyOn,    // turned on by a wake hint, before the reconnect was confirmed
+        Count
+    };
+    
+    enum class Stage {
+        Delivery,   // kernel event -> Application (includes the debounce window)
+        Dispatch,   // Application -> display command issued
+        Command,    // command issued -> acknowledged by the display server
+        Total,      // kernel event -> acknowledged
+        Lead,       // wake hint -> kernel event of the confirmed reconnect
+        Count
+    };
+    
+    /**
+     * Timestamps of one switch; default-constructed points are unknown and
+     * the stages depending on them are not recorded
+     */
+    struct Timeline {
+        Clock::time_point hinted;
+        Clock::time_point detected;
+        Clock::time_point delivered;
+        Clock::time_point issued;
+        Clock::time_point acknowledged;
+    };
+    
+    /**
+     * Add the stages of one completed switch
+     * @param direction whether the display was turned off or on
+     * @param timeline timestamps of the switch
+     */
+    void record(Direction direction, const Timeline& timeline);
+    
+    /**
+     * Copy of one histogram
+     */
+    LatencyHistogram histogram(Direction direction, Stage stage) const;
+    
+    /**
+     * Serialise every histogram, grouped by direction then stage
+     */
+    std::string toJson() const;
+    
+    void reset();
+    
+    static const char* directionName(Direction direction);
+    static const char* stageName(Stage stage);
+
+private:
+    static constexpr size_t DirectionCount = static_cast<size_t>(Direction::Count);
+    static constexpr size_t StageCount = static_cast<size_t>(Stage::Count);
+    
+    void recordStage(Direction direction, Stage stage, Clock::time_point from, Clock::time_point to);
+    
+    mutable std::mutex m_mutex;
+    LatencyHistogram m_histograms[DirectionCount][StageCount];
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,206 @@
+#include "logger.h"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger(size_t capacity)
+    : m_level(static_cast<int>(LogLevel::Info)) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    m_slots.reset(new Slot[size]);
+    m_mask = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    
+    m_consoleSink = [](const std::string& text) {
+        std::cout << text << std::flush;
+    };
+    
+    LogLevel level;
+    const char* configured = getenv("MONITORSWITCH_LOG_LEVEL");
+    if (configured && parseLevel(configured, level)) {
+        m_level.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    drain();
+}
+
+void Logger::setLevel(LogLevel level) {
+    m_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::level() const {
+    return static_cast<LogLevel>(m_level.load(std::memory_order_relaxed));
+}
+
+bool Logger::write(LogLevel level, const char* tag, std::string message) {
+    // Bounded multi-producer ring: each slot's sequence says whether it is
+    // free for the claimed position, so writers only race on m_tail
+    size_t pos = m_tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &m_slots[pos & m_mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+    
+    slot->entry.level = level;
+    slot->entry.tag = tag;
+    slot->entry.message = std::move(message);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    
+    ensureThread();
+    
+    // Only the first message of a batch wakes the logger thread; errors
+    // cut the batching delay short
+    bool urgent = level >= LogLevel::Error;
+    if (!m_signalled.exchange(true, std::memory_order_acq_rel) || urgent) {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_urgent = m_urgent || urgent;
+        }
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+void Logger::setUiSink(UiSink sink) {
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+    m_uiSink = std::move(sink);
+}
+
+void Logger::setConsoleSink(std::function<void(const std::string& text)> sink) {
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+    m_consoleSink = std::move(sink);
+}
+
+void Logger::flush() {
+    drain();
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& level) {
+    for (LogLevel candidate : {LogLevel::Debug, LogLevel::Info, LogLevel::Warning, LogLevel::Error, LogLevel::Off}) {
+        if (name == levelName(candidate)) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Info: return "info";
+        case LogLevel::Warning: return "warning";
+        case LogLevel::Error: return "error";
+        case LogLevel::Off: return "off";
+    }
+    return "";
+}
+
+bool Logger::tryPop(Entry& entry) {
+    // Single consumer: callers hold m_drainMutex
+    size_t pos = m_head.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[pos & m_mask];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+        return false;
+    }
+    entry = std::move(slot.entry);
+    slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+    m_head.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void Logger::ensureThread() {
+    if (m_threadStarted.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    if (!m_threadStarted.load(std::memory_order_relaxed) && !m_stopping) {
+        m_thread = std::thread(&Logger::run, this);
+        m_threadStarted.store(true, std::memory_order_release);
+    }
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_stopping || m_signalled.load(std::memory_order_acquire); });
+        
+        // Let the rest of a burst arrive so it goes out as one write
+        m_wake.wait_for(lock, FlushInterval, [this] { return m_stopping || m_urgent; });
+        
+        bool stopping = m_stopping;
+        m_urgent = false;
+        m_signalled.store(false, std::memory_order_release);  // later messages wake us again
+        lock.unlock();
+        drain();
+        lock.lock();
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+void Logger::drain() {
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+    
+    std::string text;
+    std::vector<Entry> uiEntries;
+    Entry entry;
+    while (tryPop(entry)) {
+        text += '[';
+        text += entry.tag;
+        text += "] ";
+        if (entry.level >= LogLevel::Warning) {
+            text += entry.level == LogLevel::Error ? "Error: " : "Warning: ";
+        }
+        text += entry.message;
+        text += '\n';
+        if (entry.level >= LogLevel::Info && m_uiSink) {
+            uiEntries.push_back(std::move(entry));
+        }
+    }
+    
+    size_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reportedDrops) {
+        text += "[LOG] " + std::to_string(dropped - m_reportedDrops) + " messages dropped\n";
+        m_reportedDrops = dropped;
+    }
+    
+    if (!text.empty() && m_consoleSink) {
+        m_consoleSink(text);
+    }
+    if (!uiEntries.empty()) {
+        m_uiSink(std::move(uiEntries));
+    }
+}
@@ -0,0 +1,173 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Severity of a log message, lowest first
+ */
+enum class LogLevel {
+    Debug = 0,
+    Info = 1,
+    Warning = 2,
+    Error = 3,
+    Off = 4
+};
+
+// Messages below this level are compiled out: their arguments are never
+// evaluated. Set with -DMONITORSWITCH_LOG_COMPILE_LEVEL=<0..4>.
+#ifndef MONITORSWITCH_LOG_COMPILE_LEVEL
+#define MONITORSWITCH_LOG_COMPILE_LEVEL 0
+#endif
+
+/**
+ * Process-wide logger
+ * Callers never block on output: messages go into a fixed-size ring buffer
+ * and a background thread writes them to the console in batches, one write
+ * and one flush per batch. Messages at Info and above are also handed, in
+ * batches, to the UI sink. When the ring is full new messages are dropped
+ * and counted.
+ */
+class Logger {
+public:
+    /**
+     * One formatted message
+     */
+    struct Entry {
+        LogLevel level = LogLevel::Info;
+        const char* tag = "";
+        std::string message;
+    };
+    
+    using UiSink = std::function<void(std::vector<Entry> entries)>;
+    
+    static constexpr size_t DefaultCapacity = 1024;
+    static constexpr std::chrono::milliseconds FlushInterval{50};
+    
+    /**
+     * @return the logger used by the LOG_* macros
+     */
+    static Logger& instance();
+    
+    /**
+     * @param capacity ring buffer size, rounded up to a power of two
+     */
+    explicit Logger(size_t capacity = DefaultCapacity);
+    ~Logger();
+    
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+    
+    /**
+     * Check whether a message would be kept; cheap enough for every call site
+     */
+    bool isEnabled(LogLevel level) const {
+        return static_cast<int>(level) >= m_level.load(std::memory_order_relaxed);
+    }
+    
+    /**
+     * Set the runtime level; messages below it are not formatted
+     */
+    void setLevel(LogLevel level);
+    LogLevel level() const;
+    
+    /**
+     * Queue a message without waiting for output
+     * @param tag subsystem shown in brackets, must outlive the logger (a literal)
+     * @return false if the ring buffer was full and the message was dropped
+     */
+    bool write(LogLevel level, const char* tag, std::string message);
+    
+    /**
+     * Set where UI messages go; called on the logger thread with each batch
+     * After setUiSink() returns the previous sink is no longer called.
+     * @param sink receiver of Info and above, or nullptr to stop
+     */
+    void setUiSink(UiSink sink);
+    
+    /**
+     * Set the console output, std::cout by default; for tests
+     * @param sink receiver of each batch as one block of text
+     */
+    void setConsoleSink(std::function<void(const std::string& text)> sink);
+    
+    /**
+     * Write everything queued so far before returning
+     */
+    void flush();
+    
+    /**
+     * Number of messages dropped because the ring buffer was full
+     */
+    size_t droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+    
+    /**
+     * Parse "debug", "info", "warning", "error" or "off"
+     * @return false if the name is not a level
+     */
+    static bool parseLevel(const std::string& name, LogLevel& level);
+    static const char* levelName(LogLevel level);
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Entry entry;
+    };
+    
+    bool tryPop(Entry& entry);
+    void ensureThread();
+    void run();
+    void drain();
+    
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0};  // next slot to read, logger thread only
+    alignas(64) std::atomic<size_t> m_tail{0};  // next slot to claim, any thread
+    std::atomic<size_t> m_dropped{0};
+    std::atomic<int> m_level;
+    
+    std::mutex m_drainMutex;    // one drainer at a time; also guards the sinks
+    std::function<void(const std::string&)> m_consoleSink;
+    UiSink m_uiSink;
+    size_t m_reportedDrops = 0;
+    
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_threadStarted{false};
+    std::atomic<bool> m_signalled{false};   // a batch is waiting to be written
+    bool m_urgent = false;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+// Compile-time check first, so disabled levels leave no code behind; the
+// message is only formatted when the runtime level lets it through
+#define MONITORSWITCH_LOG(level, tag, expr)                                              \
+    do {                                                                                \
+        if (static_cast<int>(level) >= MONITORSWITCH_LOG_COMPILE_LEVEL                  \
+            && Logger::instance().isEnabled(level)) {                                   \
+            std::ostringstream logStream_;                                              \
+            logStream_ << expr;                                                         \
+            Logger::instance().write(level, tag, logStream_.str());                     \
+        }                                                                               \
+    } while (0)
+
+/**
+ * Log with stream syntax: LOG_INFO("DISPLAY", "Turned off " << count << " outputs")
+ */
+#define LOG_DEBUG(tag, expr) MONITORSWITCH_LOG(LogLevel::Debug, tag, expr)
+#define LOG_INFO(tag, expr) MONITORSWITCH_LOG(LogLevel::Info, tag, expr)
+#define LOG_WARNING(tag, expr) MONITORSWITCH_LOG(LogLevel::Warning, tag, expr)
+#define LOG_ERROR(tag, expr) MONITORSWITCH_LOG(LogLevel::Error, tag, expr)
+
+#endif // LOGGER_H
@@ -0,0 +1,74 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * Bounded single-producer/single-consumer ring buffer
+ * tryPush() must only be called from one thread and tryPop() from one
+ * (other) thread; neither blocks nor allocates after construction.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    /**
+     * @param capacity maximum number of queued elements, rounded up to a power of two
+     */
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * Append an element (producer thread)
+     * @return false if the queue is full, value is left untouched
+     */
+    bool tryPush(T&& value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+            return false;
+        }
+        m_slots[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Remove the oldest element (consumer thread)
+     * @return false if the queue is empty
+     */
+    bool tryPop(T& value) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask;
+    // Kept on separate cache lines so producer and consumer do not false-share
+    alignas(64) std::atomic<size_t> m_head{0};  // next slot to read
+    alignas(64) std::atomic<size_t> m_tail{0};  // next slot to write
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,98 @@
+#include "timer_scheduler.h"
+
+TimerScheduler::TimerScheduler()
+    : m_nextGeneration(1), m_stopping(false) {
+}
+
+TimerScheduler::~TimerScheduler() {
+    stop();
+}
+
+TimerScheduler::Token TimerScheduler::schedule(Clock::duration delay, Task task) {
+    Token token;
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        token.generation = m_nextGeneration++;
+        m_tasks.emplace(token.generation, std::move(task));
+        
+        // Only a new earliest deadline changes how long the thread must sleep
+        Entry entry{Clock::now() + delay, token.generation};
+        wake = m_queue.empty() || entry.deadline < m_queue.top().deadline;
+        m_queue.push(entry);
+        
+        if (!m_thread.joinable()) {
+            m_stopping = false;
+            m_thread = std::thread(&TimerScheduler::run, this);
+            wake = false;
+        }
+    }
+    
+    if (wake) {
+        m_wake.notify_one();
+    }
+    return token;
+}
+
+bool TimerScheduler::cancel(Token token) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.erase(token.generation) > 0;
+}
+
+void TimerScheduler::stop() {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.clear();
+        m_queue = std::priority_queue<Entry>();
+        
+        // A task cannot join its own thread; dropping the queue is all it gets
+        if (m_thread.get_id() == std::this_thread::get_id()) {
+            return;
+        }
+        m_stopping = true;
+        thread = std::move(m_thread);
+    }
+    m_wake.notify_one();
+    
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+size_t TimerScheduler::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size();
+}
+
+void TimerScheduler::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    while (!m_stopping) {
+        if (m_queue.empty()) {
+            m_wake.wait(lock);
+            continue;
+        }
+        
+        Entry next = m_queue.top();
+        auto task = m_tasks.find(next.generation);
+        if (task == m_tasks.end()) {
+            // Cancelled while queued
+            m_queue.pop();
+            continue;
+        }
+        
+        if (Clock::now() < next.deadline) {
+            m_wake.wait_until(lock, next.deadline);
+            continue;
+        }
+        
+        m_queue.pop();
+        Task work = std::move(task->second);
+        m_tasks.erase(task);
+        
+        lock.unlock();
+        work();
+        lock.lock();
+    }
+}
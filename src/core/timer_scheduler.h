@@ -0,0 +1,93 @@
+#ifndef TIMER_SCHEDULER_H
+#define TIMER_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * One background thread running delayed tasks from a cancellable timer queue
+ *
+ * Timers live in a min-heap ordered by deadline, so scheduling is O(log n).
+ * Each timer gets a fresh generation number; its token can only ever cancel
+ * that timer, never a later one reusing the same slot. Cancellation takes
+ * effect immediately: a cancelled task is guaranteed not to start. Tasks run
+ * on the scheduler thread, one at a time, outside the internal lock, so they
+ * may schedule or cancel other timers. The thread is started on first use.
+ */
+class TimerScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+    /**
+     * Handle of one scheduled task; a default-constructed token refers to nothing
+     */
+    struct Token {
+        uint64_t generation = 0;
+        explicit operator bool() const { return generation != 0; }
+    };
+
+    TimerScheduler();
+    ~TimerScheduler();
+
+    TimerScheduler(const TimerScheduler&) = delete;
+    TimerScheduler& operator=(const TimerScheduler&) = delete;
+
+    /**
+     * Run a task once after a delay
+     * @param delay time to wait before running the task
+     * @param task function to run on the scheduler thread
+     * @return token to cancel the task with
+     */
+    Token schedule(Clock::duration delay, Task task);
+
+    /**
+     * Cancel a scheduled task
+     * @param token token returned by schedule()
+     * @return true if the task was still pending and will not run
+     */
+    bool cancel(Token token);
+
+    /**
+     * Drop all pending tasks and join the thread; later schedule() calls
+     * restart it. From inside a task, only the pending tasks are dropped
+     */
+    void stop();
+
+    /**
+     * @return number of tasks waiting to run
+     */
+    size_t pending() const;
+
+private:
+    struct Entry {
+        Clock::time_point deadline;
+        uint64_t generation;
+
+        // Inverted so std::priority_queue keeps the earliest deadline on top
+        bool operator<(const Entry& other) const {
+            return deadline != other.deadline ? deadline > other.deadline
+                                              : generation > other.generation;
+        }
+    };
+
+    void run();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::priority_queue<Entry> m_queue;
+    // Cancelled entries stay in the heap and are skipped when they surface
+    std::unordered_map<uint64_t, Task> m_tasks;
+    uint64_t m_nextGeneration;
+    bool m_stopping;
+    std::thread m_thread;
+};
+
+#endif // TIMER_SCHEDULER_H
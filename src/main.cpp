@@ -58,6 +58,18 @@ int main(int argc, char *argv[]) {
     // Create the core application
     Application coreApplication;
     
+    // Run USB event handling (and its debounce timer) on the Qt main thread
+    coreApplication.setMainThreadInvoker([&app](std::function<void()> task, int delayMs) {
+        if (delayMs <= 0) {
+            QMetaObject::invokeMethod(&app, std::move(task), Qt::QueuedConnection);
+            return;
+        }
+        // Timers belong to the thread that starts them, so arm it from the main thread
+        QMetaObject::invokeMethod(&app, [&app, task, delayMs]() {
+            QTimer::singleShot(delayMs, &app, task);
+        }, Qt::QueuedConnection);
+    });
+    
     // Initialize the core application
     if (!coreApplication.initialize()) {
         QMessageBox::critical(nullptr, "Initialization Error",
@@ -0,0 +1,130 @@
+#include "display_backend.h"
+#include <algorithm>
+#include "core/logger.h"
+
+void DisplayBackendRegistry::add(std::unique_ptr<DisplayBackend> backend) {
+    if (backend) {
+        m_backends.push_back(std::move(backend));
+    }
+}
+
+DisplayBackend* DisplayBackendRegistry::find(const std::string& name) const {
+    for (const auto& backend : m_backends) {
+        if (name == backend->name()) {
+            return backend.get();
+        }
+    }
+    return nullptr;
+}
+
+DisplayBackendProbe DisplayBackendRegistry::probe(DisplayBackend& backend) {
+    DisplayBackendProbe result;
+    result.name = backend.name();
+    result.available = backend.isAvailable();
+    if (!result.available) {
+        return result;
+    }
+    
+    // A wake request goes through the same transport as a sleep request
+    // (connection, ioctl or fork) without blanking the screen at startup
+    auto start = std::chrono::steady_clock::now();
+    result.working = backend.setPower(true);
+    result.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+std::string DisplayBackendRegistry::select(const std::string& preferred) {
+    m_active = nullptr;
+    m_probes.clear();
+    
+    if (!preferred.empty()) {
+        DisplayBackend* cached = find(preferred);
+        if (cached && cached->isAvailable()) {
+            m_active = cached;
+            LOG_DEBUG("DISPLAY", "Using cached backend: " << preferred);
+            return preferred;
+        }
+        LOG_INFO("DISPLAY", "Cached backend " << preferred << " unavailable, probing");
+    }
+    
+    std::chrono::microseconds bestLatency{0};
+    for (const auto& backend : m_backends) {
+        DisplayBackendProbe result = probe(*backend);
+        if (!result.available) {
+            LOG_DEBUG("DISPLAY", "Backend " << result.name << ": not available");
+        } else if (!result.working) {
+            LOG_DEBUG("DISPLAY", "Backend " << result.name << ": failed");
+        } else {
+            LOG_DEBUG("DISPLAY", "Backend " << result.name << ": "
+                      << result.latency.count() / 1000.0 << " ms");
+            
+            // A backend that blanks every output beats a faster backlight;
+            // latency decides between equals, then registration order
+            bool covers = backend->coversAllOutputs();
+            bool better = !m_active || (covers && !m_active->coversAllOutputs()) ||
+                          (covers == m_active->coversAllOutputs() && result.latency < bestLatency);
+            if (better) {
+                m_active = backend.get();
+                bestLatency = result.latency;
+            }
+        }
+        m_probes.push_back(result);
+    }
+    
+    if (!m_active) {
+        LOG_ERROR("DISPLAY", "No working display backend");
+        return "";
+    }
+    
+    LOG_INFO("DISPLAY", "Selected backend: " << m_active->name());
+    return m_active->name();
+}
+
+bool DisplayBackendRegistry::setPower(bool on) {
+    if (m_active && m_active->setPower(on)) {
+        return true;
+    }
+    
+    for (const auto& backend : m_backends) {
+        if (backend.get() == m_active) {
+            continue;
+        }
+        
+        // Skip backends the startup probe already found broken
+        auto probed = std::find_if(m_probes.begin(), m_probes.end(), [&backend](const DisplayBackendProbe& p) {
+            return p.name == backend->name();
+        });
+        if (probed != m_probes.end() && !probed->working) {
+            continue;
+        }
+        
+        if (backend->isAvailable() && backend->setPower(on)) {
+            LOG_WARNING("DISPLAY", "Backend " << (m_active ? m_active->name() : "none")
+                        << " failed, switched to " << backend->name());
+            m_active = backend.get();
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool DisplayBackendRegistry::queryPower(bool& on) {
+    return m_active && m_active->queryPower(on);
+}
+
+bool DisplayBackendRegistry::setOutputPower(const std::vector<std::string>& outputs, bool on) {
+    if (m_active && m_active->supportsOutputs()) {
+        return m_active->setOutputPower(outputs, on);
+    }
+    
+    for (const auto& backend : m_backends) {
+        if (backend.get() != m_active && backend->isAvailable() && backend->supportsOutputs()) {
+            return backend->setOutputPower(outputs, on);
+        }
+    }
+    
+    LOG_WARNING("DISPLAY", "No backend supports per-output control");
+    return false;
+}
@@ -0,0 +1,163 @@
+#ifndef DISPLAY_BACKEND_H
+#define DISPLAY_BACKEND_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * One way of switching the display power state (X11 DPMS, DRM, backlight...)
+ *
+ * Backends are not thread-safe; the owner serialises calls.
+ */
+class DisplayBackend {
+public:
+    virtual ~DisplayBackend() = default;
+
+    /**
+     * Stable identifier, stored in the configuration to skip probing
+     */
+    virtual const char* name() const = 0;
+
+    /**
+     * Cheap check that the backend can be used on this system
+     * (device nodes present, server reachable, permissions)
+     * @return true if setPower() is worth trying
+     */
+    virtual bool isAvailable() = 0;
+
+    /**
+     * Switch the display power state
+     * @param on true to wake the display, false to put it to sleep
+     * @return true if the request was accepted
+     */
+    virtual bool setPower(bool on) = 0;
+
+    /**
+     * Read the current display power state
+     * @param on receives true if the display is on
+     * @return false if the backend cannot report the state
+     */
+    virtual bool queryPower(bool& on) = 0;
+
+    /**
+     * Whether setPower() blanks every connected output; a backlight only
+     * darkens built-in panels and leaves external monitors lit
+     */
+    virtual bool coversAllOutputs() const { return true; }
+
+    /**
+     * Descriptor that becomes readable when power state notifications are
+     * waiting, or -1 if the backend has none or lost its connection. May
+     * change after a reconnect.
+     */
+    virtual int notificationFd() { return -1; }
+
+    /**
+     * Whether notifications cover every power change, including those made
+     * by other clients and idle timeouts, so a cached state can be trusted
+     */
+    virtual bool reportsAllChanges() const { return false; }
+
+    /**
+     * Consume pending notifications
+     * @param on receives the current power state if it may have changed
+     * @return true if on was updated
+     */
+    virtual bool readNotifications(bool& on) {
+        (void)on;
+        return false;
+    }
+
+    /**
+     * Whether individual outputs can be switched instead of the whole screen
+     */
+    virtual bool supportsOutputs() { return false; }
+
+    /**
+     * Switch a set of outputs in one batch, leaving the others untouched
+     * @param outputs output names as reported by the backend (e.g. "HDMI-1")
+     * @param on true to restore the outputs, false to turn them off
+     * @return true if every listed output was switched; when turning off,
+     *         outputs that already are off count as switched, unknown
+     *         names never do
+     */
+    virtual bool setOutputPower(const std::vector<std::string>& outputs, bool on) {
+        (void)outputs;
+        (void)on;
+        return false;
+    }
+};
+
+/**
+ * Result of probing one backend at startup
+ */
+struct DisplayBackendProbe {
+    std::string name;
+    bool available = false;
+    bool working = false;
+    std::chrono::microseconds latency{0};
+};
+
+/**
+ * Ordered set of display backends with one active choice
+ *
+ * select() probes every available backend once, timing a wake request
+ * round trip, and keeps the working one that covers the most outputs,
+ * the fastest among equals. A backend remembered from an earlier run is
+ * taken without probing as long as it is still available. Not thread-safe.
+ */
+class DisplayBackendRegistry {
+public:
+    /**
+     * Register a backend; registration order is the fallback order
+     * @param backend backend to take ownership of
+     */
+    void add(std::unique_ptr<DisplayBackend> backend);
+
+    /**
+     * Choose the active backend
+     * @param preferred name cached from a previous run, empty to force probing
+     * @return name of the chosen backend, empty if none works
+     */
+    std::string select(const std::string& preferred);
+
+    /**
+     * Switch the display power state with the active backend, falling back
+     * to the other working backends in registration order
+     * @param on true to wake the display, false to put it to sleep
+     * @return true if some backend accepted the request
+     */
+    bool setPower(bool on);
+
+    /**
+     * Read the display power state from the active backend
+     * @param on receives true if the display is on
+     * @return false if no backend can report the state
+     */
+    bool queryPower(bool& on);
+
+    /**
+     * Switch individual outputs with the active backend, or with the first
+     * available backend that supports per-output control
+     * @param outputs output names to switch
+     * @param on true to restore the outputs, false to turn them off
+     * @return false if no backend supports outputs or the switch failed
+     */
+    bool setOutputPower(const std::vector<std::string>& outputs, bool on);
+
+    DisplayBackend* active() const { return m_active; }
+    DisplayBackend* find(const std::string& name) const;
+    const std::vector<DisplayBackendProbe>& probeResults() const { return m_probes; }
+    size_t size() const { return m_backends.size(); }
+
+private:
+    DisplayBackendProbe probe(DisplayBackend& backend);
+
+    std::vector<std::unique_ptr<DisplayBackend>> m_backends;
+    std::vector<DisplayBackendProbe> m_probes;
+    DisplayBackend* m_active = nullptr;
+};
+
+#endif // DISPLAY_BACKEND_H
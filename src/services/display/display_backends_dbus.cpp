@@ -0,0 +1,129 @@
+#include "display_backends_linux.h"
+#include "core/logger.h"
+
+#ifdef HAVE_QTDBUS
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusVariant>
+#include <QVariant>
+#endif
+
+#ifdef HAVE_QTDBUS
+
+namespace {
+
+// Session bus calls block the display command thread; never for long
+const int CallTimeoutMs = 1000;
+
+const char* const MutterService = "org.gnome.Mutter.DisplayConfig";
+const char* const MutterPath = "/org/gnome/Mutter/DisplayConfig";
+const char* const PropertiesInterface = "org.freedesktop.DBus.Properties";
+const int MutterPowerSaveOn = 0;   // DPMS levels as used by Mutter
+const int MutterPowerSaveOff = 3;
+
+const char* const KGlobalAccelService = "org.kde.kglobalaccel";
+const char* const PowerDevilComponent = "/component/org_kde_powerdevil";
+const char* const ScreenSaverService = "org.freedesktop.ScreenSaver";
+
+bool serviceRegistered(const char* service) {
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected() || !bus.interface()) {
+        return false;
+    }
+    return bus.interface()->isServiceRegistered(QString::fromLatin1(service)).value();
+}
+
+bool call(const QDBusMessage& message, QDBusMessage* reply = nullptr) {
+    QDBusMessage result = QDBusConnection::sessionBus().call(message, QDBus::Block, CallTimeoutMs);
+    if (result.type() == QDBusMessage::ErrorMessage) {
+        LOG_WARNING("DISPLAY", "D-Bus call " << message.member().toStdString() << " failed: "
+                    << result.errorMessage().toStdString());
+        return false;
+    }
+    if (reply) {
+        *reply = result;
+    }
+    return true;
+}
+
+} // namespace
+
+bool GnomeDisplayConfigBackend::isAvailable() {
+    return serviceRegistered(MutterService);
+}
+
+bool GnomeDisplayConfigBackend::setPower(bool on) {
+    QDBusMessage message = QDBusMessage::createMethodCall(MutterService, MutterPath, PropertiesInterface, "Set");
+    message << QString::fromLatin1(MutterService) << QString::fromLatin1("PowerSaveMode")
+            << QVariant::fromValue(QDBusVariant(on ? MutterPowerSaveOn : MutterPowerSaveOff));
+    return call(message);
+}
+
+bool GnomeDisplayConfigBackend::queryPower(bool& on) {
+    QDBusMessage message = QDBusMessage::createMethodCall(MutterService, MutterPath, PropertiesInterface, "Get");
+    message << QString::fromLatin1(MutterService) << QString::fromLatin1("PowerSaveMode");
+    
+    QDBusMessage reply;
+    if (!call(message, &reply) || reply.arguments().isEmpty()) {
+        return false;
+    }
+    QVariant mode = reply.arguments().first().value<QDBusVariant>().variant();
+    on = mode.toInt() == MutterPowerSaveOn;
+    return true;
+}
+
+bool KdePowerDevilBackend::isAvailable() {
+    return serviceRegistered(KGlobalAccelService) && serviceRegistered(ScreenSaverService);
+}
+
+bool KdePowerDevilBackend::setPower(bool on) {
+    if (on) {
+        // Plasma wakes the screens on any user activity
+        return call(QDBusMessage::createMethodCall(ScreenSaverService, "/ScreenSaver",
+                                                   ScreenSaverService, "SimulateUserActivity"));
+    }
+    
+    QDBusMessage message = QDBusMessage::createMethodCall(KGlobalAccelService, PowerDevilComponent,
+                                                          "org.kde.kglobalaccel.Component", "invokeShortcut");
+    message << QString::fromLatin1("Turn Off Screen");
+    return call(message);
+}
+
+bool KdePowerDevilBackend::queryPower(bool& on) {
+    (void)on;
+    return false;
+}
+
+#else
+
+// Built without QtDBus: never available
+bool GnomeDisplayConfigBackend::isAvailable() {
+    return false;
+}
+
+bool GnomeDisplayConfigBackend::setPower(bool on) {
+    (void)on;
+    return false;
+}
+
+bool GnomeDisplayConfigBackend::queryPower(bool& on) {
+    (void)on;
+    return false;
+}
+
+bool KdePowerDevilBackend::isAvailable() {
+    return false;
+}
+
+bool KdePowerDevilBackend::setPower(bool on) {
+    (void)on;
+    return false;
+}
+
+bool KdePowerDevilBackend::queryPower(bool& on) {
+    (void)on;
+    return false;
+}
+
+#endif // HAVE_QTDBUS
@@ -0,0 +1,249 @@
+#include "display_backends_linux.h"
+#include <algorithm>
+#include "core/logger.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBDRM
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#endif
+
+DrmDpmsBackend::DrmDpmsBackend(const std::string& deviceDir)
+    : m_deviceDir(deviceDir), m_fd(-1), m_atomic(false) {
+}
+
+DrmDpmsBackend::~DrmDpmsBackend() {
+    close();
+}
+
+#ifdef HAVE_LIBDRM
+
+namespace {
+
+/**
+ * Look up a KMS property of an object by name
+ * @param value receives the current value if not null
+ * @return property id, 0 if the object has no such property
+ */
+uint32_t findProperty(int fd, uint32_t object, uint32_t type, const char* name, uint64_t* value = nullptr) {
+    drmModeObjectProperties* properties = drmModeObjectGetProperties(fd, object, type);
+    if (!properties) {
+        return 0;
+    }
+    
+    uint32_t id = 0;
+    for (uint32_t i = 0; i < properties->count_props && id == 0; ++i) {
+        drmModePropertyRes* property = drmModeGetProperty(fd, properties->props[i]);
+        if (!property) {
+            continue;
+        }
+        if (std::strcmp(property->name, name) == 0) {
+            id = property->prop_id;
+            if (value) {
+                *value = properties->prop_values[i];
+            }
+        }
+        drmModeFreeProperty(property);
+    }
+    drmModeFreeObjectProperties(properties);
+    return id;
+}
+
+} // namespace
+
+bool DrmDpmsBackend::open() {
+    if (m_fd >= 0) {
+        return true;
+    }
+    
+    for (int card = 0; card < 8; ++card) {
+        std::string path = m_deviceDir + "/card" + std::to_string(card);
+        int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        
+        drmModeRes* resources = drmModeGetResources(fd);
+        if (!resources) {
+            ::close(fd);
+            continue;
+        }
+        
+        // Atomic clients see the CRTC_ID/ACTIVE properties; DPMS stays as fallback
+        bool atomic = drmSetClientCap(fd, DRM_CLIENT_CAP_ATOMIC, 1) == 0;
+        
+        // Remember the DPMS property of every connected output, and the CRTC
+        // currently driving it
+        std::vector<Connector> connectors;
+        std::vector<Crtc> crtcs;
+        for (int i = 0; i < resources->count_connectors; ++i) {
+            drmModeConnector* connector = drmModeGetConnector(fd, resources->connectors[i]);
+            if (!connector) {
+                continue;
+            }
+            if (connector->connection == DRM_MODE_CONNECTED) {
+                uint32_t dpms = findProperty(fd, connector->connector_id, DRM_MODE_OBJECT_CONNECTOR, "DPMS");
+                if (dpms != 0) {
+                    connectors.push_back({connector->connector_id, dpms});
+                }
+                
+                uint64_t crtcId = 0;
+                if (atomic && findProperty(fd, connector->connector_id, DRM_MODE_OBJECT_CONNECTOR,
+                                           "CRTC_ID", &crtcId) != 0 && crtcId != 0) {
+                    uint32_t crtc = static_cast<uint32_t>(crtcId);
+                    uint32_t active = findProperty(fd, crtc, DRM_MODE_OBJECT_CRTC, "ACTIVE");
+                    bool known = std::any_of(crtcs.begin(), crtcs.end(),
+                                             [crtc](const Crtc& entry) { return entry.id == crtc; });
+                    if (active != 0 && !known) {
+                        crtcs.push_back({crtc, active});  // cloned outputs share a CRTC
+                    }
+                }
+            }
+            drmModeFreeConnector(connector);
+        }
+        drmModeFreeResources(resources);
+        
+        m_fd = fd;
+        m_atomic = atomic && !crtcs.empty();
+        m_connectors = std::move(connectors);
+        m_crtcs = std::move(crtcs);
+        
+        if ((m_atomic || !m_connectors.empty()) && probe()) {
+            LOG_INFO("DISPLAY", "Driving " << path << " through "
+                     << (m_atomic ? "atomic commits" : "connector DPMS"));
+            return true;
+        }
+        close();
+    }
+    
+    return false;
+}
+
+bool DrmDpmsBackend::probe() {
+    if (m_atomic) {
+        return commitActive(false, true);
+    }
+    
+    // No test-only mode for legacy properties: rewrite the current value
+    const Connector& connector = m_connectors.front();
+    uint64_t mode = DRM_MODE_DPMS_ON;
+    findProperty(m_fd, connector.id, DRM_MODE_OBJECT_CONNECTOR, "DPMS", &mode);
+    if (drmModeConnectorSetProperty(m_fd, connector.id, connector.dpmsProperty, mode) != 0) {
+        LOG_WARNING("DISPLAY", "DRM connector DPMS not permitted (no DRM master?): " << strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool DrmDpmsBackend::commitActive(bool on, bool testOnly) {
+    drmModeAtomicReq* request = drmModeAtomicAlloc();
+    if (!request) {
+        return false;
+    }
+    for (const Crtc& crtc : m_crtcs) {
+        drmModeAtomicAddProperty(request, crtc.id, crtc.activeProperty, on ? 1 : 0);
+    }
+    
+    // Mode, connectors and planes stay bound to the CRTC while it is
+    // inactive, so ACTIVE alone switches the outputs back on
+    uint32_t flags = DRM_MODE_ATOMIC_ALLOW_MODESET | (testOnly ? DRM_MODE_ATOMIC_TEST_ONLY : 0);
+    int result = drmModeAtomicCommit(m_fd, request, flags, nullptr);
+    drmModeAtomicFree(request);
+    
+    if (result != 0) {
+        LOG_WARNING("DISPLAY", "DRM atomic commit " << (testOnly ? "test " : "") << "failed"
+                    << (result == -EACCES ? " (no DRM master?)" : "") << ": " << strerror(-result));
+        return false;
+    }
+    return true;
+}
+
+bool DrmDpmsBackend::setPower(bool on) {
+    if (!open()) {
+        return false;
+    }
+    if (m_atomic) {
+        return commitActive(on, false);
+    }
+    
+    bool success = true;
+    for (const Connector& connector : m_connectors) {
+        if (drmModeConnectorSetProperty(m_fd, connector.id, connector.dpmsProperty,
+                                        on ? DRM_MODE_DPMS_ON : DRM_MODE_DPMS_OFF) != 0) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool DrmDpmsBackend::queryPower(bool& on) {
+    if (!open()) {
+        return false;
+    }
+    
+    if (m_atomic) {
+        // The display counts as on while any CRTC is active
+        bool found = false;
+        on = false;
+        for (const Crtc& crtc : m_crtcs) {
+            uint64_t active = 0;
+            if (findProperty(m_fd, crtc.id, DRM_MODE_OBJECT_CRTC, "ACTIVE", &active) != 0) {
+                found = true;
+                on = on || active != 0;
+            }
+        }
+        return found;
+    }
+    
+    uint64_t mode = 0;
+    if (findProperty(m_fd, m_connectors.front().id, DRM_MODE_OBJECT_CONNECTOR, "DPMS", &mode) == 0) {
+        return false;
+    }
+    on = mode == DRM_MODE_DPMS_ON;
+    return true;
+}
+
+#else
+
+bool DrmDpmsBackend::open() {
+    return false;
+}
+
+bool DrmDpmsBackend::probe() {
+    return false;
+}
+
+bool DrmDpmsBackend::commitActive(bool on, bool testOnly) {
+    (void)on;
+    (void)testOnly;
+    return false;
+}
+
+bool DrmDpmsBackend::setPower(bool on) {
+    (void)on;
+    return false;
+}
+
+bool DrmDpmsBackend::queryPower(bool& on) {
+    (void)on;
+    return false;
+}
+
+#endif // HAVE_LIBDRM
+
+void DrmDpmsBackend::close() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_atomic = false;
+    m_connectors.clear();
+    m_crtcs.clear();
+}
+
+bool DrmDpmsBackend::isAvailable() {
+    return open();
+}
@@ -0,0 +1,508 @@
+#include "display_backends_linux.h"
+#include <algorithm>
+#include "core/logger.h"
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/dpms.h>
+#ifdef HAVE_XSCREENSAVER
+#include <X11/extensions/scrnsaver.h>
+#endif
+#ifdef HAVE_XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif
+#ifdef None
+#undef None
+#endif
+
+namespace {
+
+#ifdef HAVE_XSETIOERROREXITHANDLER
+/**
+ * Called by Xlib instead of exit() when the X connection breaks, so the
+ * backend can drop the dead Display and reconnect on the next request
+ */
+void onDisplayConnectionLost(Display* display, void* userData) {
+    (void)display;
+    static_cast<std::atomic<bool>*>(userData)->store(true);
+}
+#endif
+
+// Last protocol error seen while our own requests were being synced; backend
+// calls are serialised by the owner
+int g_lastXErrorCode = 0;
+
+int recordXError(Display* display, XErrorEvent* event) {
+    (void)display;
+    g_lastXErrorCode = event->error_code;
+    return 0;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// X11 DPMS
+// ---------------------------------------------------------------------------
+
+X11DpmsBackend::X11DpmsBackend()
+    : m_display(nullptr), m_dpmsAvailable(false), m_connectionLost(false),
+      m_dpmsOpcode(-1), m_screenSaverEventBase(-1), m_randrAvailable(false) {
+}
+
+X11DpmsBackend::~X11DpmsBackend() {
+    closeConnection();
+}
+
+bool X11DpmsBackend::ensureConnection() {
+    if (m_display && m_connectionLost) {
+        LOG_WARNING("DISPLAY", "X connection lost, reconnecting");
+        closeConnection();
+    }
+    
+    if (m_display) {
+        return true;
+    }
+    
+    Display* display = XOpenDisplay(nullptr);
+    if (!display) {
+        return false;
+    }
+    
+    m_connectionLost = false;
+#ifdef HAVE_XSETIOERROREXITHANDLER
+    XSetIOErrorExitHandler(display, onDisplayConnectionLost, &m_connectionLost);
+#endif
+
+    int dummy;
+    m_dpmsAvailable = DPMSQueryExtension(display, &dummy, &dummy) && DPMSCapable(display);
+    m_display = display;
+    
+#ifdef HAVE_XRANDR
+    int randrMajor = 0, randrMinor = 0;
+    m_randrAvailable = XRRQueryExtension(display, &dummy, &dummy) &&
+                       XRRQueryVersion(display, &randrMajor, &randrMinor) &&
+                       (randrMajor > 1 || (randrMajor == 1 && randrMinor >= 2));
+#endif
+    subscribeNotifications();
+    
+    LOG_INFO("DISPLAY", "Connected to X server " << DisplayString(display)
+             << (m_dpmsAvailable ? "" : " (DPMS not available)")
+             << (m_dpmsOpcode >= 0 ? " (DPMS notifications)" : ""));
+    return true;
+}
+
+void X11DpmsBackend::subscribeNotifications() {
+    Window root = DefaultRootWindow(m_display);
+    m_dpmsOpcode = -1;
+    m_screenSaverEventBase = -1;
+    
+#ifdef HAVE_DPMS_SELECT_INPUT
+    // DPMSInfoNotify arrives as a generic event tagged with the DPMS opcode
+    int major = 0, minor = 0, opcode, eventBase, errorBase;
+    if (m_dpmsAvailable && DPMSGetVersion(m_display, &major, &minor) &&
+        (major > 1 || (major == 1 && minor >= 2)) &&
+        XQueryExtension(m_display, "DPMS", &opcode, &eventBase, &errorBase)) {
+        DPMSSelectInput(m_display, root, DPMSInfoNotifyMask);
+        m_dpmsOpcode = opcode;
+    }
+#endif
+    
+#ifdef HAVE_XSCREENSAVER
+    int screenSaverError;
+    if (XScreenSaverQueryExtension(m_display, &m_screenSaverEventBase, &screenSaverError)) {
+        XScreenSaverSelectInput(m_display, root, ScreenSaverNotifyMask);
+    } else {
+        m_screenSaverEventBase = -1;
+    }
+#endif
+    
+    (void)root;
+    XFlush(m_display);
+}
+
+void X11DpmsBackend::closeConnection() {
+    if (m_display) {
+        XCloseDisplay(m_display);
+        m_display = nullptr;
+    }
+    m_dpmsAvailable = false;
+    m_dpmsOpcode = -1;
+    m_screenSaverEventBase = -1;
+    m_randrAvailable = false;
+}
+
+bool X11DpmsBackend::isAvailable() {
+    return ensureConnection() && m_dpmsAvailable;
+}
+
+bool X11DpmsBackend::setPower(bool on) {
+    // A second attempt is only made when the connection broke under the first
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!ensureConnection() || !m_dpmsAvailable) {
+            return false;
+        }
+        
+        // Forcing a level fails with BadMatch while DPMS is disabled, so enable
+        // it first like xset does. Neither request has a reply; the XSync is
+        // the only round trip and surfaces any error before we report success
+        g_lastXErrorCode = 0;
+        XErrorHandler previousHandler = XSetErrorHandler(recordXError);
+        DPMSEnable(m_display);
+        DPMSForceLevel(m_display, on ? DPMSModeOn : DPMSModeOff);
+        XSync(m_display, False);
+        XSetErrorHandler(previousHandler);
+        
+        if (!m_connectionLost) {
+            if (g_lastXErrorCode != 0) {
+                LOG_WARNING("DISPLAY", "DPMS request failed with X error " << g_lastXErrorCode);
+                return false;
+            }
+            return true;
+        }
+        
+        closeConnection();
+    }
+    
+    return false;
+}
+
+bool X11DpmsBackend::queryPower(bool& on) {
+    if (!ensureConnection() || !m_dpmsAvailable) {
+        return false;
+    }
+    
+    CARD16 state;
+    BOOL enabled;
+    if (!DPMSInfo(m_display, &state, &enabled) || m_connectionLost) {
+        return false;
+    }
+    
+    on = !enabled || state == DPMSModeOn;
+    return true;
+}
+
+int X11DpmsBackend::notificationFd() {
+    // A lost connection stays readable until the next request reconnects
+    if (!m_display || m_connectionLost || (m_dpmsOpcode < 0 && m_screenSaverEventBase < 0)) {
+        return -1;
+    }
+    return ConnectionNumber(m_display);
+}
+
+bool X11DpmsBackend::reportsAllChanges() const {
+    // ScreenSaver events miss forced levels and DPMS idle timeouts
+    return m_display && m_dpmsOpcode >= 0;
+}
+
+bool X11DpmsBackend::readNotifications(bool& on) {
+    if (!m_display) {
+        return false;
+    }
+    
+    // Only whether something changed matters; the state itself is re-read
+    // once below instead of decoding every event
+    bool changed = false;
+    while (!m_connectionLost && XPending(m_display) > 0) {
+        XEvent event;
+        XNextEvent(m_display, &event);
+        
+        if (m_dpmsOpcode >= 0 && event.type == GenericEvent &&
+            event.xgeneric.extension == m_dpmsOpcode) {
+            changed = true;
+        }
+#ifdef HAVE_XSCREENSAVER
+        if (m_screenSaverEventBase >= 0 && event.type == m_screenSaverEventBase + ScreenSaverNotify) {
+            changed = true;
+        }
+#endif
+    }
+    
+    if (m_connectionLost) {
+        closeConnection();
+        return false;
+    }
+    
+    return changed && queryPower(on);
+}
+
+bool X11DpmsBackend::supportsOutputs() {
+    return ensureConnection() && m_randrAvailable;
+}
+
+bool X11DpmsBackend::setOutputPower(const std::vector<std::string>& outputs, bool on) {
+    if (!supportsOutputs() || outputs.empty()) {
+        return false;
+    }
+    
+#ifdef HAVE_XRANDR
+    // Every CRTC change goes out under one server grab, so other clients see
+    // a single layout change; the final XSync reports any error for the batch
+    g_lastXErrorCode = 0;
+    XErrorHandler previousHandler = XSetErrorHandler(recordXError);
+    XGrabServer(m_display);
+    bool success = on ? restoreOutputs(outputs) : disableOutputs(outputs);
+    XUngrabServer(m_display);
+    XSync(m_display, False);
+    XSetErrorHandler(previousHandler);
+    
+    if (m_connectionLost) {
+        closeConnection();
+        return false;
+    }
+    if (g_lastXErrorCode != 0) {
+        LOG_WARNING("DISPLAY", "RandR request failed with X error " << g_lastXErrorCode);
+        return false;
+    }
+    return success;
+#else
+    (void)on;
+    return false;
+#endif
+}
+
+#ifdef HAVE_XRANDR
+
+bool X11DpmsBackend::disableOutputs(const std::vector<std::string>& outputs) {
+    XRRScreenResources* resources = XRRGetScreenResourcesCurrent(m_display, DefaultRootWindow(m_display));
+    if (!resources) {
+        return false;
+    }
+    
+    // Every name is checked before anything is switched: a typo, or a name
+    // from another backend, must not pass as an output that is already off
+    std::vector<std::string> known;
+    std::vector<std::string> inactive;
+    for (int o = 0; o < resources->noutput; ++o) {
+        XRROutputInfo* output = XRRGetOutputInfo(m_display, resources, resources->outputs[o]);
+        if (!output) {
+            continue;
+        }
+        std::string name(output->name, output->nameLen);
+        if (std::find(outputs.begin(), outputs.end(), name) != outputs.end()) {
+            known.push_back(name);
+            if (output->crtc == 0) {  // None, undefined above
+                inactive.push_back(name);
+            }
+        }
+        XRRFreeOutputInfo(output);
+    }
+    for (const SavedCrtc& saved : m_savedCrtcs) {
+        known.insert(known.end(), saved.outputNames.begin(), saved.outputNames.end());
+        inactive.insert(inactive.end(), saved.outputNames.begin(), saved.outputNames.end());
+    }
+    for (const std::string& name : outputs) {
+        if (std::find(known.begin(), known.end(), name) == known.end()) {
+            LOG_WARNING("DISPLAY", "Unknown X output: " << name);
+            XRRFreeScreenResources(resources);
+            return false;
+        }
+    }
+    
+    bool failed = false;
+    std::vector<std::string> active;  // requested outputs found driving a CRTC
+    for (int c = 0; c < resources->ncrtc; ++c) {
+        XRRCrtcInfo* crtc = XRRGetCrtcInfo(m_display, resources, resources->crtcs[c]);
+        if (!crtc) {
+            continue;
+        }
+        
+        // Split the CRTC's outputs into the ones to switch off and the ones
+        // that keep running (clone setups)
+        std::vector<RROutput> remaining;
+        std::vector<std::string> names;
+        for (int o = 0; o < crtc->noutput; ++o) {
+            XRROutputInfo* output = XRRGetOutputInfo(m_display, resources, crtc->outputs[o]);
+            std::string name = output ? std::string(output->name, output->nameLen) : std::string();
+            if (output) {
+                XRRFreeOutputInfo(output);
+            }
+            
+            names.push_back(name);
+            if (std::find(outputs.begin(), outputs.end(), name) == outputs.end()) {
+                remaining.push_back(crtc->outputs[o]);
+            } else {
+                active.push_back(name);
+            }
+        }
+        
+        size_t targeted = names.size() - remaining.size();
+        if (targeted > 0) {
+            SavedCrtc saved{resources->crtcs[c], crtc->mode, crtc->x, crtc->y, crtc->rotation,
+                            std::vector<unsigned long>(crtc->outputs, crtc->outputs + crtc->noutput), names};
+            
+            Status status = XRRSetCrtcConfig(m_display, resources, resources->crtcs[c], CurrentTime,
+                                             crtc->x, crtc->y, remaining.empty() ? 0 : crtc->mode,
+                                             crtc->rotation, remaining.empty() ? nullptr : remaining.data(),
+                                             static_cast<int>(remaining.size()));
+            if (status == RRSetConfigSuccess) {
+                m_savedCrtcs.push_back(saved);
+            } else {
+                failed = true;
+            }
+        }
+        XRRFreeCrtcInfo(crtc);
+    }
+    XRRFreeScreenResources(resources);
+    
+    // An output driving no CRTC is already off: switched off by an earlier
+    // call (and kept in m_savedCrtcs), disabled by the user or unplugged.
+    // One whose CRTC could not be read was not switched
+    for (const std::string& output : outputs) {
+        if (std::find(active.begin(), active.end(), output) != active.end()) {
+            continue;
+        }
+        if (std::find(inactive.begin(), inactive.end(), output) == inactive.end()) {
+            failed = true;
+        } else {
+            LOG_DEBUG("DISPLAY", "Output " << output << " is already inactive");
+        }
+    }
+    return !failed;
+}
+
+bool X11DpmsBackend::restoreOutputs(const std::vector<std::string>& outputs) {
+    XRRScreenResources* resources = XRRGetScreenResourcesCurrent(m_display, DefaultRootWindow(m_display));
+    if (!resources) {
+        return false;
+    }
+    
+    bool success = true;
+    bool restored = false;
+    for (auto saved = m_savedCrtcs.begin(); saved != m_savedCrtcs.end();) {
+        bool wanted = std::any_of(saved->outputNames.begin(), saved->outputNames.end(),
+                                  [&outputs](const std::string& name) {
+            return std::find(outputs.begin(), outputs.end(), name) != outputs.end();
+        });
+        if (!wanted) {
+            ++saved;
+            continue;
+        }
+        
+        std::vector<RROutput> crtcOutputs(saved->outputs.begin(), saved->outputs.end());
+        Status status = XRRSetCrtcConfig(m_display, resources, saved->crtc, CurrentTime,
+                                         saved->x, saved->y, saved->mode, saved->rotation,
+                                         crtcOutputs.data(), static_cast<int>(crtcOutputs.size()));
+        if (status != RRSetConfigSuccess) {
+            success = false;
+        }
+        restored = true;
+        saved = m_savedCrtcs.erase(saved);
+    }
+    XRRFreeScreenResources(resources);
+    
+    // Outputs switched off by an earlier run cannot be restored from here
+    if (!restored) {
+        LOG_WARNING("DISPLAY", "No saved configuration for the requested outputs");
+    }
+    return success && restored;
+}
+
+#else
+
+bool X11DpmsBackend::disableOutputs(const std::vector<std::string>& outputs) {
+    (void)outputs;
+    return false;
+}
+
+bool X11DpmsBackend::restoreOutputs(const std::vector<std::string>& outputs) {
+    (void)outputs;
+    return false;
+}
+
+#endif // HAVE_XRANDR
+
+// ---------------------------------------------------------------------------
+// sysfs backlight
+// ---------------------------------------------------------------------------
+
+SysfsBacklightBackend::SysfsBacklightBackend(const std::string& backlightDir)
+    : m_backlightDir(backlightDir) {
+}
+
+bool SysfsBacklightBackend::isAvailable() {
+    m_powerFiles.clear();
+    
+    DIR* dir = opendir(m_backlightDir.c_str());
+    if (!dir) {
+        return false;
+    }
+    
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::string powerFile = m_backlightDir + "/" + entry->d_name + "/bl_power";
+        if (access(powerFile.c_str(), W_OK) == 0) {
+            m_powerFiles.push_back(powerFile);
+        }
+    }
+    closedir(dir);
+    
+    return !m_powerFiles.empty();
+}
+
+bool SysfsBacklightBackend::setPower(bool on) {
+    if (m_powerFiles.empty() && !isAvailable()) {
+        return false;
+    }
+    
+    // FB_BLANK_UNBLANK / FB_BLANK_POWERDOWN
+    bool success = true;
+    for (const std::string& powerFile : m_powerFiles) {
+        std::ofstream file(powerFile);
+        file << (on ? "0" : "4");
+        file.flush();
+        if (!file) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool SysfsBacklightBackend::queryPower(bool& on) {
+    if (m_powerFiles.empty() && !isAvailable()) {
+        return false;
+    }
+    
+    std::ifstream file(m_powerFiles.front());
+    int value;
+    if (!(file >> value)) {
+        return false;
+    }
+    
+    on = value == 0;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// External commands
+// ---------------------------------------------------------------------------
+
+bool ExternalCommandBackend::isAvailable() {
+    return std::system(nullptr) != 0;
+}
+
+bool ExternalCommandBackend::setPower(bool on) {
+    if (std::system(on ? "xset dpms force on" : "xset dpms force off") == 0) {
+        return true;
+    }
+    
+    if (on) {
+        // Simulate user activity
+        if (std::system("xdotool mousemove_relative 1 1") == 0) {
+            std::system("xdotool mousemove_relative -- -1 -1");
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool ExternalCommandBackend::queryPower(bool& on) {
+    (void)on;
+    return false;
+}
@@ -0,0 +1,234 @@
+#ifndef DISPLAY_BACKENDS_LINUX_H
+#define DISPLAY_BACKENDS_LINUX_H
+
+#include "display_backend.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// X11 headers stay in the source file to avoid macro conflicts with Qt
+struct _XDisplay;
+
+// Wayland objects, defined by libwayland and the generated protocol code
+struct wl_display;
+struct wl_registry;
+struct wl_output;
+struct zwlr_output_power_manager_v1;
+struct zwlr_output_power_v1;
+
+/**
+ * DPMS through the X server, over one persistent connection that is
+ * reopened after the server goes away
+ *
+ * The connection also listens for DPMS (1.2+) and ScreenSaver notifications
+ * so the owner can keep a display state cache without polling. With XRandR
+ * (1.2+), individual outputs can be switched off by detaching them from
+ * their CRTC; the previous CRTC configuration is kept to restore them.
+ */
+class X11DpmsBackend : public DisplayBackend {
+public:
+    X11DpmsBackend();
+    ~X11DpmsBackend() override;
+
+    const char* name() const override { return "x11-dpms"; }
+    bool isAvailable() override;
+    bool setPower(bool on) override;
+    bool queryPower(bool& on) override;
+    int notificationFd() override;
+    bool reportsAllChanges() const override;
+    bool readNotifications(bool& on) override;
+    bool supportsOutputs() override;
+    bool setOutputPower(const std::vector<std::string>& outputs, bool on) override;
+
+private:
+    // CRTC configuration saved before some of its outputs were switched off
+    struct SavedCrtc {
+        unsigned long crtc;
+        unsigned long mode;
+        int x;
+        int y;
+        unsigned short rotation;
+        std::vector<unsigned long> outputs;
+        std::vector<std::string> outputNames;
+    };
+
+    bool ensureConnection();
+    void closeConnection();
+    void subscribeNotifications();
+    bool disableOutputs(const std::vector<std::string>& outputs);
+    bool restoreOutputs(const std::vector<std::string>& outputs);
+
+    struct _XDisplay* m_display;
+    bool m_dpmsAvailable;
+    std::atomic<bool> m_connectionLost;
+    int m_dpmsOpcode;            // major opcode of DPMS generic events, -1 if not selected
+    int m_screenSaverEventBase;  // -1 if the ScreenSaver extension is missing
+    bool m_randrAvailable;
+    std::vector<SavedCrtc> m_savedCrtcs;  // survives reconnects, XIDs stay valid on the same server
+};
+
+/**
+ * Output power through the wlr-output-power-management protocol (sway,
+ * Hyprland, labwc, river and other wlroots compositors), over one persistent
+ * Wayland connection that is reopened after the compositor goes away
+ *
+ * The compositor reports every mode change, including its own idle
+ * blanking, so the state cache can be trusted. Outputs are addressed by
+ * their wl_output name (e.g. "HDMI-A-1"). Compiled in when wayland-client
+ * and wayland-scanner are available.
+ */
+class WaylandOutputPowerBackend : public DisplayBackend {
+public:
+    WaylandOutputPowerBackend();
+    ~WaylandOutputPowerBackend() override;
+
+    const char* name() const override { return "wayland-output-power"; }
+    bool isAvailable() override;
+    bool setPower(bool on) override;
+    bool queryPower(bool& on) override;
+    int notificationFd() override;
+    bool reportsAllChanges() const override;
+    bool readNotifications(bool& on) override;
+    bool supportsOutputs() override;
+    bool setOutputPower(const std::vector<std::string>& outputs, bool on) override;
+
+private:
+    friend struct WaylandListeners;
+
+    struct Output {
+        WaylandOutputPowerBackend* owner;
+        uint32_t globalName;
+        struct wl_output* output;
+        struct zwlr_output_power_v1* power;
+        std::string name;
+        int mode;  // -1 until the compositor reports it, then 0 (off) or 1 (on)
+    };
+
+    bool ensureConnection();
+    void closeConnection();
+    void bindPower(Output& output);
+    bool switchOutputs(const std::vector<Output*>& outputs, bool on);
+    bool aggregatePower(bool& on) const;
+
+    struct wl_display* m_display;
+    struct wl_registry* m_registry;
+    struct zwlr_output_power_manager_v1* m_manager;
+    std::vector<std::unique_ptr<Output>> m_outputs;  // listener data, addresses must stay stable
+    bool m_modeChanged;                               // a mode event arrived since readNotifications()
+};
+
+/**
+ * GNOME Wayland sessions: the PowerSaveMode property of Mutter's
+ * org.gnome.Mutter.DisplayConfig interface on the session bus
+ *
+ * Compiled in when QtDBus is available.
+ */
+class GnomeDisplayConfigBackend : public DisplayBackend {
+public:
+    const char* name() const override { return "gnome-displayconfig"; }
+    bool isAvailable() override;
+    bool setPower(bool on) override;
+    bool queryPower(bool& on) override;
+};
+
+/**
+ * KDE Plasma sessions: PowerDevil's "Turn Off Screen" global shortcut to
+ * blank, simulated user activity on org.freedesktop.ScreenSaver to wake
+ *
+ * Plasma offers no way to read the state back. Compiled in when QtDBus is
+ * available.
+ */
+class KdePowerDevilBackend : public DisplayBackend {
+public:
+    const char* name() const override { return "kde-powerdevil"; }
+    bool isAvailable() override;
+    bool setPower(bool on) override;
+    bool queryPower(bool& on) override;
+};
+
+/**
+ * Direct DRM/KMS power control of the connected outputs (/dev/dri/card*),
+ * bypassing any display server
+ *
+ * Uses an atomic commit of the CRTC ACTIVE property when the driver supports
+ * atomic modesetting, and the legacy connector DPMS property otherwise. Both
+ * need DRM master, so a card is only used when a probe (test-only commit, or
+ * rewriting the current DPMS value) succeeds: no compositor or X server owns
+ * it and the process may drive it (console sessions, kiosks). The first
+ * process to open a card becomes its master, so a display server started
+ * later cannot take the card over while this backend holds it. Compiled in
+ * when libdrm is available.
+ */
+class DrmDpmsBackend : public DisplayBackend {
+public:
+    explicit DrmDpmsBackend(const std::string& deviceDir = "/dev/dri");
+    ~DrmDpmsBackend() override;
+
+    const char* name() const override { return "drm-dpms"; }
+    bool isAvailable() override;
+    bool setPower(bool on) override;
+    bool queryPower(bool& on) override;
+
+    /**
+     * @return true if the open card is driven through atomic commits
+     */
+    bool usesAtomic() const { return m_atomic; }
+
+private:
+    struct Connector {
+        uint32_t id;
+        uint32_t dpmsProperty;
+    };
+
+    struct Crtc {
+        uint32_t id;
+        uint32_t activeProperty;
+    };
+
+    bool open();
+    void close();
+    bool probe();
+    bool commitActive(bool on, bool testOnly);
+
+    std::string m_deviceDir;
+    int m_fd;
+    bool m_atomic;
+    std::vector<Connector> m_connectors;
+    std::vector<Crtc> m_crtcs;
+};
+
+/**
+ * Backlight power through /sys/class/backlight/<device>/bl_power
+ *
+ * Blanks internal panels only; needs write access to the attribute.
+ */
+class SysfsBacklightBackend : public DisplayBackend {
+public:
+    explicit SysfsBacklightBackend(const std::string& backlightDir = "/sys/class/backlight");
+
+    const char* name() const override { return "sysfs-backlight"; }
+    bool isAvailable() override;
+    bool setPower(bool on) override;
+    bool queryPower(bool& on) override;
+    bool coversAllOutputs() const override { return false; }
+
+private:
+    std::string m_backlightDir;
+    std::vector<std::string> m_powerFiles;
+};
+
+/**
+ * External tools (xset, xdotool); every call forks a shell and a process,
+ * so this is only registered when explicitly allowed in the configuration
+ */
+class ExternalCommandBackend : public DisplayBackend {
+public:
+    const char* name() const override { return "external-command"; }
+    bool isAvailable() override;
+    bool setPower(bool on) override;
+    bool queryPower(bool& on) override;
+};
+
+#endif // DISPLAY_BACKENDS_LINUX_H
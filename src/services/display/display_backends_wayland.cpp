@@ -0,0 +1,367 @@
+#include "display_backends_linux.h"
+#include <algorithm>
+#include "core/logger.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+
+#ifdef HAVE_WAYLAND
+#include <wayland-client.h>
+#include "wlr-output-power-management-unstable-v1-client-protocol.h"
+#endif
+
+WaylandOutputPowerBackend::WaylandOutputPowerBackend()
+    : m_display(nullptr), m_registry(nullptr), m_manager(nullptr), m_modeChanged(false) {
+}
+
+WaylandOutputPowerBackend::~WaylandOutputPowerBackend() {
+    closeConnection();
+}
+
+#ifdef HAVE_WAYLAND
+
+namespace {
+
+// wl_output v4 adds the connector name; older servers only get generated names
+#ifdef WL_OUTPUT_NAME_SINCE_VERSION
+const uint32_t OutputVersion = 4;
+#else
+const uint32_t OutputVersion = 2;
+#endif
+
+} // namespace
+
+/**
+ * C callbacks of the Wayland listeners, with access to the backend internals
+ */
+struct WaylandListeners {
+    using Output = WaylandOutputPowerBackend::Output;
+    
+    static void global(void* data, wl_registry* registry, uint32_t name, const char* interface, uint32_t version) {
+        auto* backend = static_cast<WaylandOutputPowerBackend*>(data);
+        
+        if (strcmp(interface, zwlr_output_power_manager_v1_interface.name) == 0 && !backend->m_manager) {
+            backend->m_manager = static_cast<zwlr_output_power_manager_v1*>(
+                wl_registry_bind(registry, name, &zwlr_output_power_manager_v1_interface, 1));
+            for (auto& output : backend->m_outputs) {
+                backend->bindPower(*output);
+            }
+        } else if (strcmp(interface, wl_output_interface.name) == 0) {
+            // Hotplugged outputs arrive here too, while the connection stays open
+            auto output = std::make_unique<Output>();
+            output->owner = backend;
+            output->globalName = name;
+            output->power = nullptr;
+            output->name = "output-" + std::to_string(name);
+            output->mode = -1;
+            output->output = static_cast<wl_output*>(
+                wl_registry_bind(registry, name, &wl_output_interface, std::min(version, OutputVersion)));
+            wl_output_add_listener(output->output, &outputListener, output.get());
+            backend->bindPower(*output);
+            backend->m_outputs.push_back(std::move(output));
+        }
+    }
+    
+    static void globalRemove(void* data, wl_registry*, uint32_t name) {
+        auto* backend = static_cast<WaylandOutputPowerBackend*>(data);
+        auto& outputs = backend->m_outputs;
+        
+        for (auto it = outputs.begin(); it != outputs.end(); ++it) {
+            if ((*it)->globalName != name) {
+                continue;
+            }
+            if ((*it)->power) {
+                zwlr_output_power_v1_destroy((*it)->power);
+            }
+            wl_output_destroy((*it)->output);
+            outputs.erase(it);
+            backend->m_modeChanged = true;
+            return;
+        }
+    }
+    
+    static void outputGeometry(void*, wl_output*, int32_t, int32_t, int32_t, int32_t, int32_t,
+                               const char*, const char*, int32_t) {}
+    static void outputMode(void*, wl_output*, uint32_t, int32_t, int32_t, int32_t) {}
+    static void outputDone(void*, wl_output*) {}
+    static void outputScale(void*, wl_output*, int32_t) {}
+#ifdef WL_OUTPUT_NAME_SINCE_VERSION
+    static void outputName(void* data, wl_output*, const char* name) {
+        static_cast<Output*>(data)->name = name;
+    }
+    static void outputDescription(void*, wl_output*, const char*) {}
+#endif
+
+    static void powerMode(void* data, zwlr_output_power_v1*, uint32_t mode) {
+        auto* output = static_cast<Output*>(data);
+        output->mode = mode == ZWLR_OUTPUT_POWER_V1_MODE_ON ? 1 : 0;
+        output->owner->m_modeChanged = true;
+    }
+    
+    static void powerFailed(void* data, zwlr_output_power_v1* power) {
+        // Unsupported output or another client holds it; retried on the next switch
+        auto* output = static_cast<Output*>(data);
+        LOG_WARNING("DISPLAY", "Compositor refused power control of " << output->name);
+        zwlr_output_power_v1_destroy(power);
+        output->power = nullptr;
+        output->mode = -1;
+    }
+    
+    static const wl_registry_listener registryListener;
+    static const wl_output_listener outputListener;
+    static const zwlr_output_power_v1_listener powerListener;
+};
+
+const wl_registry_listener WaylandListeners::registryListener = {
+    WaylandListeners::global,
+    WaylandListeners::globalRemove
+};
+
+const wl_output_listener WaylandListeners::outputListener = {
+    WaylandListeners::outputGeometry,
+    WaylandListeners::outputMode,
+    WaylandListeners::outputDone,
+    WaylandListeners::outputScale,
+#ifdef WL_OUTPUT_NAME_SINCE_VERSION
+    WaylandListeners::outputName,
+    WaylandListeners::outputDescription
+#endif
+};
+
+const zwlr_output_power_v1_listener WaylandListeners::powerListener = {
+    WaylandListeners::powerMode,
+    WaylandListeners::powerFailed
+};
+
+bool WaylandOutputPowerBackend::ensureConnection() {
+    if (m_display && wl_display_get_error(m_display) != 0) {
+        LOG_WARNING("DISPLAY", "Lost the Wayland connection, reconnecting");
+        closeConnection();
+    }
+    if (m_display) {
+        return true;
+    }
+    
+    // Only talk to a compositor the session actually points at
+    if (!getenv("WAYLAND_DISPLAY") && !getenv("WAYLAND_SOCKET")) {
+        return false;
+    }
+    
+    m_display = wl_display_connect(nullptr);
+    if (!m_display) {
+        return false;
+    }
+    
+    m_registry = wl_display_get_registry(m_display);
+    wl_registry_add_listener(m_registry, &WaylandListeners::registryListener, this);
+    
+    // First round trip announces the globals, the second delivers the output
+    // names and the initial power modes of the objects bound meanwhile
+    if (wl_display_roundtrip(m_display) < 0 || wl_display_roundtrip(m_display) < 0 || !m_manager) {
+        closeConnection();
+        return false;
+    }
+    
+    m_modeChanged = true;
+    return true;
+}
+
+void WaylandOutputPowerBackend::closeConnection() {
+    for (auto& output : m_outputs) {
+        if (output->power) {
+            zwlr_output_power_v1_destroy(output->power);
+        }
+        wl_output_destroy(output->output);
+    }
+    m_outputs.clear();
+    
+    if (m_manager) {
+        zwlr_output_power_manager_v1_destroy(m_manager);
+        m_manager = nullptr;
+    }
+    if (m_registry) {
+        wl_registry_destroy(m_registry);
+        m_registry = nullptr;
+    }
+    if (m_display) {
+        wl_display_disconnect(m_display);
+        m_display = nullptr;
+    }
+}
+
+void WaylandOutputPowerBackend::bindPower(Output& output) {
+    if (!m_manager || output.power) {
+        return;
+    }
+    output.power = zwlr_output_power_manager_v1_get_output_power(m_manager, output.output);
+    zwlr_output_power_v1_add_listener(output.power, &WaylandListeners::powerListener, &output);
+}
+
+bool WaylandOutputPowerBackend::isAvailable() {
+    return ensureConnection() && !m_outputs.empty();
+}
+
+bool WaylandOutputPowerBackend::switchOutputs(const std::vector<Output*>& outputs, bool on) {
+    if (outputs.empty()) {
+        return false;
+    }
+    
+    for (Output* output : outputs) {
+        bindPower(*output);
+        zwlr_output_power_v1_set_mode(output->power, on ? ZWLR_OUTPUT_POWER_V1_MODE_ON
+                                                         : ZWLR_OUTPUT_POWER_V1_MODE_OFF);
+    }
+    
+    // The compositor answers every set_mode with a mode (or failed) event
+    // before the round trip completes
+    if (wl_display_roundtrip(m_display) < 0) {
+        LOG_WARNING("DISPLAY", "Wayland round trip failed: " << strerror(errno));
+        return false;
+    }
+    
+    const int wanted = on ? 1 : 0;
+    for (auto& output : m_outputs) {
+        if (std::find(outputs.begin(), outputs.end(), output.get()) != outputs.end() && output->mode != wanted) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WaylandOutputPowerBackend::setPower(bool on) {
+    if (!ensureConnection()) {
+        return false;
+    }
+    
+    std::vector<Output*> outputs;
+    for (auto& output : m_outputs) {
+        outputs.push_back(output.get());
+    }
+    return switchOutputs(outputs, on);
+}
+
+bool WaylandOutputPowerBackend::supportsOutputs() {
+    return ensureConnection();
+}
+
+bool WaylandOutputPowerBackend::setOutputPower(const std::vector<std::string>& names, bool on) {
+    if (!ensureConnection()) {
+        return false;
+    }
+    
+    std::vector<Output*> outputs;
+    for (const std::string& name : names) {
+        auto match = std::find_if(m_outputs.begin(), m_outputs.end(),
+                                  [&name](const std::unique_ptr<Output>& output) { return output->name == name; });
+        if (match == m_outputs.end()) {
+            LOG_WARNING("DISPLAY", "Unknown Wayland output: " << name);
+            return false;
+        }
+        outputs.push_back(match->get());
+    }
+    return switchOutputs(outputs, on);
+}
+
+bool WaylandOutputPowerBackend::aggregatePower(bool& on) const {
+    // The display counts as on while any output is lit
+    bool known = false;
+    on = false;
+    for (const auto& output : m_outputs) {
+        if (output->mode >= 0) {
+            known = true;
+            on = on || output->mode == 1;
+        }
+    }
+    return known;
+}
+
+bool WaylandOutputPowerBackend::queryPower(bool& on) {
+    if (!ensureConnection() || wl_display_roundtrip(m_display) < 0) {
+        return false;
+    }
+    return aggregatePower(on);
+}
+
+int WaylandOutputPowerBackend::notificationFd() {
+    // A broken connection stays readable until the next request reconnects
+    if (!m_display || wl_display_get_error(m_display) != 0) {
+        return -1;
+    }
+    return wl_display_get_fd(m_display);
+}
+
+bool WaylandOutputPowerBackend::reportsAllChanges() const {
+    return m_display != nullptr && m_manager != nullptr;
+}
+
+bool WaylandOutputPowerBackend::readNotifications(bool& on) {
+    if (!m_display) {
+        return false;
+    }
+    
+    // Non-blocking read of whatever the compositor sent, then dispatch
+    while (wl_display_prepare_read(m_display) != 0) {
+        wl_display_dispatch_pending(m_display);
+    }
+    wl_display_flush(m_display);
+    
+    pollfd fd = {wl_display_get_fd(m_display), POLLIN, 0};
+    if (poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN)) {
+        wl_display_read_events(m_display);
+    } else {
+        wl_display_cancel_read(m_display);
+    }
+    wl_display_dispatch_pending(m_display);
+    
+    if (wl_display_get_error(m_display) != 0 || !m_modeChanged) {
+        return false;
+    }
+    m_modeChanged = false;
+    return aggregatePower(on);
+}
+
+#else
+
+// Built without wayland-client: never available
+void WaylandOutputPowerBackend::closeConnection() {
+}
+
+bool WaylandOutputPowerBackend::isAvailable() {
+    return false;
+}
+
+bool WaylandOutputPowerBackend::setPower(bool on) {
+    (void)on;
+    return false;
+}
+
+bool WaylandOutputPowerBackend::queryPower(bool& on) {
+    (void)on;
+    return false;
+}
+
+int WaylandOutputPowerBackend::notificationFd() {
+    return -1;
+}
+
+bool WaylandOutputPowerBackend::reportsAllChanges() const {
+    return false;
+}
+
+bool WaylandOutputPowerBackend::readNotifications(bool& on) {
+    (void)on;
+    return false;
+}
+
+bool WaylandOutputPowerBackend::supportsOutputs() {
+    return false;
+}
+
+bool WaylandOutputPowerBackend::setOutputPower(const std::vector<std::string>& outputs, bool on) {
+    (void)outputs;
+    (void)on;
+    return false;
+}
+
+#endif // HAVE_WAYLAND
@@ -0,0 +1,156 @@
+#include "display_command_executor.h"
+#include "core/logger.h"
+#include <vector>
+
+const char* displayCommandResultName(DisplayCommandResult result) {
+    switch (result) {
+        case DisplayCommandResult::Completed: return "completed";
+        case DisplayCommandResult::Failed: return "failed";
+        case DisplayCommandResult::TimedOut: return "timed out";
+        case DisplayCommandResult::Collapsed: return "collapsed";
+        case DisplayCommandResult::Rejected: return "rejected";
+    }
+    return "unknown";
+}
+
+bool DisplayCommandExecutor::Completion::complete(DisplayCommandResult result) {
+    if (done.exchange(true)) {
+        return false;
+    }
+    
+    // Callback first: a caller blocked on the future sees its side effects
+    if (callback) {
+        callback(result);
+    }
+    promise.set_value(result);
+    return true;
+}
+
+DisplayCommandExecutor::DisplayCommandExecutor(std::shared_ptr<TimerScheduler> scheduler)
+    : m_lastOn(true), m_stopping(false), m_scheduler(scheduler) {
+}
+
+DisplayCommandExecutor::~DisplayCommandExecutor() {
+    stop();
+}
+
+void DisplayCommandExecutor::setScheduler(std::shared_ptr<TimerScheduler> scheduler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_scheduler = scheduler;
+}
+
+std::future<DisplayCommandResult> DisplayCommandExecutor::submit(bool on, Command command,
+                                                                 Clock::duration timeout, Callback callback) {
+    auto completion = std::make_shared<Completion>();
+    completion->callback = std::move(callback);
+    std::future<DisplayCommandResult> future = completion->promise.get_future();
+    
+    // Outcomes are reported outside the lock: callbacks may submit again
+    std::vector<std::shared_ptr<Completion>> collapsed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        // A waiting command that already timed out no longer counts
+        if (m_waiting && !m_waiting->completion->done) {
+            collapsed.push_back(m_waiting->completion);
+            if (m_scheduler) {
+                m_scheduler->cancel(m_waiting->timeout);
+            }
+            if (m_waiting->on != on && m_waiting->on != m_lastOn) {
+                // Off then on (or on then off) before either ran, and the
+                // display is already where the newer command wants it
+                collapsed.push_back(completion);
+            }
+        }
+        m_waiting.reset();
+        
+        if (collapsed.size() < 2) {
+            Request request{on, std::move(command), completion, TimerScheduler::Token()};
+            if (m_scheduler) {
+                std::weak_ptr<Completion> expiring = completion;
+                request.timeout = m_scheduler->schedule(timeout, [expiring]() {
+                    auto pending = expiring.lock();
+                    if (pending && pending->complete(DisplayCommandResult::TimedOut)) {
+                        LOG_WARNING("DISPLAY", "Display command timed out");
+                    }
+                });
+            }
+            m_waiting = std::move(request);
+            
+            if (!m_thread.joinable()) {
+                m_stopping = false;
+                m_thread = std::thread(&DisplayCommandExecutor::run, this);
+            }
+        }
+    }
+    m_wake.notify_one();
+    
+    for (auto& entry : collapsed) {
+        entry->complete(DisplayCommandResult::Collapsed);
+    }
+    return future;
+}
+
+void DisplayCommandExecutor::stop() {
+    std::optional<Request> dropped;
+    std::shared_ptr<TimerScheduler> scheduler;
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        dropped.swap(m_waiting);
+        scheduler = m_scheduler;
+        
+        // A callback cannot join its own thread; dropping the queue is all it gets
+        if (m_thread.get_id() != std::this_thread::get_id()) {
+            m_stopping = true;
+            thread = std::move(m_thread);
+        }
+    }
+    m_wake.notify_one();
+    
+    if (dropped) {
+        if (scheduler) {
+            scheduler->cancel(dropped->timeout);
+        }
+        dropped->completion->complete(DisplayCommandResult::Rejected);
+    }
+    
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool DisplayCommandExecutor::hasPending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_waiting && !m_waiting->completion->done;
+}
+
+void DisplayCommandExecutor::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    while (!m_stopping) {
+        if (!m_waiting) {
+            m_wake.wait(lock);
+            continue;
+        }
+        
+        Request request = std::move(*m_waiting);
+        m_waiting.reset();
+        if (request.completion->done) {
+            continue; // Expired while waiting: never start a stale command
+        }
+        std::shared_ptr<TimerScheduler> scheduler = m_scheduler;
+        m_lastOn = request.on;
+        
+        lock.unlock();
+        bool success = request.command();
+        if (scheduler) {
+            scheduler->cancel(request.timeout);
+        }
+        if (!request.completion->complete(success ? DisplayCommandResult::Completed
+                                                  : DisplayCommandResult::Failed)) {
+            LOG_WARNING("DISPLAY", "Display command finished after its timeout");
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef DISPLAY_COMMAND_EXECUTOR_H
+#define DISPLAY_COMMAND_EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "core/timer_scheduler.h"
+
+/**
+ * Outcome of one queued display command
+ */
+enum class DisplayCommandResult {
+    Completed,  // the command ran and reported success
+    Failed,     // the command ran and reported failure
+    TimedOut,   // no outcome within the timeout; it may still complete later
+    Collapsed,  // dropped before running, superseded by a later command
+    Rejected    // the executor was stopped before the command ran
+};
+
+const char* displayCommandResultName(DisplayCommandResult result);
+
+/**
+ * Runs display power commands on a dedicated thread so the thread raising
+ * them (USB monitor, UI, timers) never waits on the display server
+ *
+ * Commands run one at a time. Waiting commands collapse last-writer-wins: a
+ * command replaces a waiting one. It cancels a waiting one of the opposite
+ * kind together with itself only when the waiting one would undo the command
+ * running or last run, since the display is then already where the newer
+ * command wants it. The queue is therefore bounded to one waiting command
+ * behind the running one. Each command has a deadline
+ * counted from submission; when it passes, the caller is told the command
+ * timed out, and a command still waiting is never started. A command that
+ * hangs keeps the thread busy (display backends cannot be called
+ * concurrently), so later commands time out instead of piling up.
+ */
+class DisplayCommandExecutor {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Command = std::function<bool()>;
+    using Callback = std::function<void(DisplayCommandResult)>;
+    
+    /**
+     * @param scheduler timer thread used to expire deadlines
+     */
+    explicit DisplayCommandExecutor(std::shared_ptr<TimerScheduler> scheduler);
+    ~DisplayCommandExecutor();
+    
+    DisplayCommandExecutor(const DisplayCommandExecutor&) = delete;
+    DisplayCommandExecutor& operator=(const DisplayCommandExecutor&) = delete;
+    
+    void setScheduler(std::shared_ptr<TimerScheduler> scheduler);
+    
+    /**
+     * Queue a power command
+     * @param on kind of the command: true to turn the display on, false for off
+     * @param command work to run on the executor thread, returning success
+     * @param timeout time allowed from now until the command completes
+     * @param callback called once with the outcome, before the future is
+     *                 resolved; on the executor or timer thread, or inline
+     *                 when the command collapses on submission
+     * @return future resolved with the outcome
+     */
+    std::future<DisplayCommandResult> submit(bool on, Command command, Clock::duration timeout,
+                                             Callback callback = nullptr);
+    
+    /**
+     * Reject the waiting command and join the thread once the running
+     * command returns; later submit() calls restart it. From inside a
+     * callback, only the waiting command is rejected
+     */
+    void stop();
+    
+    /**
+     * @return true if a command is waiting to run
+     */
+    bool hasPending() const;
+
+private:
+    // Shared with the timeout timer, which may fire after the request left the queue
+    struct Completion {
+        std::atomic<bool> done{false};
+        Callback callback;
+        std::promise<DisplayCommandResult> promise;
+        
+        /**
+         * Report the outcome unless one was already reported
+         * @return false if the command had already completed or timed out
+         */
+        bool complete(DisplayCommandResult result);
+    };
+    
+    struct Request {
+        bool on;
+        Command command;
+        std::shared_ptr<Completion> completion;
+        TimerScheduler::Token timeout;
+    };
+    
+    void run();
+    
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::optional<Request> m_waiting;
+    bool m_lastOn;              // kind of the command running or last run
+    bool m_stopping;
+    std::thread m_thread;
+    std::shared_ptr<TimerScheduler> m_scheduler;
+};
+
+#endif // DISPLAY_COMMAND_EXECUTOR_H
@@ -6,13 +6,24 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include "config.h"
+#include "core/timer_scheduler.h"
+#include "display_command_executor.h"
 
 #ifdef _WIN32
     #include <windows.h>
 #elif defined(__linux__)
     // Include X11 headers after Qt headers in source file to avoid macro conflicts
+    class DisplayBackendRegistry;
 #elif defined(__APPLE__)
     #include <CoreGraphics/CoreGraphics.h>
 #endif
@@ -22,67 +33,162 @@
  */
 class DisplayService {
 public:
+    using CommandCallback = DisplayCommandExecutor::Callback;
+    
+    static constexpr std::chrono::milliseconds DefaultCommandTimeout{2000};
+    
+    // Time for a reconnect to be confirmed after an early wake, on top of
+    // the device debounce window
+    static constexpr std::chrono::milliseconds DefaultEarlyWakeTimeout{1500};
+    
     DisplayService();
     ~DisplayService();
-
+    
     /**
-     * Set a logging callback function for UI logging
-     * @param logCallback function to call for logging messages
+     * Pick how the display is controlled. On Linux the available backends are
+     * probed and the best working one is kept, unless the cached choice
+     * from a previous run is still available
+     * @param preferredBackend backend name cached from a previous run, empty to probe
+     * @return name of the backend in use, empty if display control is unavailable
      */
-    void setLogCallback(std::function<void(const std::string&)> logCallback);
-
+    std::string initialize(const std::string& preferredBackend = "");
+    
+    /**
+     * Allow falling back to external tools (xset, xdotool) when the native
+     * display power path is unavailable. Disabled by default, since every
+     * call forks a shell and a process. Takes effect at initialize().
+     * @param enabled true to allow external tools as a fallback
+     */
+    void setExternalToolFallback(bool enabled);
+    
     /**
      * Turn the display on
      * @return true if successful, false otherwise
      */
     bool turnOn();
-
+    
     /**
      * Turn the display off
      * @return true if successful, false otherwise
      */
     bool turnOff();
-
+    
+    /**
+     * Queue a power change on the display command thread and return at once.
+     * A waiting command of the opposite kind is cancelled along with this one
+     * when it would undo the command running or last run.
+     * @param on true to turn the display on, false to turn it off
+     * @param onDone called with the outcome, on the command or timer thread
+     * @param timeout time allowed until the display acknowledges the change
+     * @return future resolved with the outcome
+     */
+    std::future<DisplayCommandResult> requestPower(bool on, CommandCallback onDone = nullptr,
+                                                   std::chrono::milliseconds timeout = DefaultCommandTimeout);
+    
     /**
      * Get current display state
      * @return true if display is on, false if off
      */
     bool isDisplayOn();
-
+    
+    /**
+     * Restrict turnOff()/turnOn() to some outputs instead of the whole screen.
+     * Only honoured where a backend supports per-output control (XRandR on
+     * X11); elsewhere, or if switching the outputs fails, the whole screen is
+     * switched as before.
+     * @param outputs output names (e.g. "HDMI-1"), empty for the whole screen
+     */
+    void setTargetOutputs(const std::vector<std::string>& outputs);
+    
+    /**
+     * Share a timer thread with other components; by default the service
+     * owns one. Pending operations are cancelled.
+     * @param scheduler scheduler running the delayed turn-on
+     */
+    void setScheduler(std::shared_ptr<TimerScheduler> scheduler);
+    
     /**
      * Turn off display immediately and schedule it to turn back on after specified delay
      * Display will also turn back on immediately if onDeviceReconnected() is called
+     * Only queues the command: the caller never waits on the display server
      * @param delaySeconds delay in seconds before automatically turning display back on
      * @param onComplete callback to execute when operation completes (delay expires)
+     * @param onSwitched called with the outcome of the turn-off command
+     * @return future resolved with the outcome of the turn-off command
      */
-    void scheduleDisplayOff(int delaySeconds, std::function<void()> onComplete = nullptr);
-
+    std::future<DisplayCommandResult> scheduleDisplayOff(int delaySeconds, std::function<void()> onComplete = nullptr,
+                                                         CommandCallback onSwitched = nullptr);
+    
     /**
      * Cancel any scheduled display operations and turn display back on
      * This should be called when the monitored device reconnects
      */
     void cancelScheduledOperations();
-
+    
     /**
      * Handle device reconnection - turns display back on and cancels any pending operations
+     * A turn-off that has not run yet is cancelled instead
+     * @param onSwitched called with the outcome of the turn-on command
+     * @return future of the turn-on command, invalid if the display was not
+     *         turned off by scheduleDisplayOff()
      */
-    void onDeviceReconnected();
+    std::future<DisplayCommandResult> onDeviceReconnected(CommandCallback onSwitched = nullptr);
+    
+    /**
+     * Turn the display back on ahead of a reconnect that is about to be
+     * confirmed, e.g. on the first kernel event of the returning device.
+     * The delayed turn-on stays scheduled until onDeviceReconnected(), whose
+     * own turn-on then finds the display already on. Without that
+     * confirmation within the early wake timeout, the hint was wrong and the
+     * display is turned off again.
+     * @param onSwitched called with the outcome of the turn-on command
+     * @return future of the turn-on command, invalid if the display was not
+     *         turned off by scheduleDisplayOff()
+     */
+    std::future<DisplayCommandResult> onDeviceReturning(CommandCallback onSwitched = nullptr);
+    
+    /**
+     * Set how long an early wake waits for onDeviceReconnected()
+     * @param timeout the device debounce window plus delivery slack
+     */
+    void setEarlyWakeTimeout(std::chrono::milliseconds timeout);
 
 private:
     bool isDisplayActive();
-    void executeDelayedOperation(int delaySeconds, std::function<void()> operation);
     
-    // Helper method to log messages
-    void log(const std::string& message);
+    std::shared_ptr<TimerScheduler> m_scheduler;
+    std::unique_ptr<DisplayCommandExecutor> m_executor;  // runs every queued power change
+    TimerScheduler::Token m_scheduledTurnOn;  // pending delayed turn-on, if any
+    bool m_displayOffRequested;               // turned off by scheduleDisplayOff(), not yet back on
+    uint64_t m_offGeneration;                 // counts scheduleDisplayOff() calls
+    TimerScheduler::Token m_earlyWakeRevert;  // turns off again an unconfirmed early wake
+    std::atomic<long long> m_earlyWakeTimeoutMs;
+    std::mutex m_scheduleMutex;
+    std::atomic<bool> m_externalToolFallback;
+    std::vector<std::string> m_targetOutputs;
+    std::mutex m_targetOutputsMutex;
     
-#ifdef _WIN32
-    HANDLE m_scheduledTaskHandle;
-#else
-    void* m_scheduledTaskHandle;  // Placeholder for compatibility
-#endif
+#ifdef __linux__
+    // Display state cache, fed by our own transitions and backend notifications
+    enum DisplayState { StateUnknown = -1, StateOff = 0, StateOn = 1 };
+    bool isStateKnown(DisplayState state) const;
+    void setDisplayState(bool on);
+    std::vector<std::string> targetOutputs();
+    void readNotificationsLocked();
+    void followNotificationFdLocked();
+    void startStateWatcher();
+    void stopStateWatcher();
+    void watchDisplayState();
     
-    bool m_isTaskScheduled;
-    std::function<void(const std::string&)> m_logCallback;
+    std::unique_ptr<DisplayBackendRegistry> m_backends;
+    std::mutex m_backendMutex;  // backends are not thread-safe
+    std::atomic<int> m_displayState;
+    std::atomic<bool> m_stateTrusted;  // backend reports every change, cache is authoritative
+    std::thread m_stateWatcher;
+    int m_stateWatcherWakeFd;  // signalled on shutdown and when the notification fd moves
+    std::atomic<bool> m_stateWatcherStopping;
+    int m_watchedNotificationFd;  // descriptor the watcher sleeps on, under m_backendMutex
+#endif
 };
 
 #endif // DISPLAY_SERVICE_H
@@ -0,0 +1,180 @@
+#include "display_service.h"
+#include "core/logger.h"
+#include <chrono>
+
+// Scheduling shared by every platform; only the power control itself differs
+
+void DisplayService::setScheduler(std::shared_ptr<TimerScheduler> scheduler) {
+    cancelScheduledOperations();
+    
+    std::lock_guard<std::mutex> lock(m_scheduleMutex);
+    m_scheduler = scheduler ? scheduler : std::make_shared<TimerScheduler>();
+    m_executor->setScheduler(m_scheduler);
+}
+
+void DisplayService::setTargetOutputs(const std::vector<std::string>& outputs) {
+    std::lock_guard<std::mutex> lock(m_targetOutputsMutex);
+    m_targetOutputs = outputs;
+}
+
+std::future<DisplayCommandResult> DisplayService::requestPower(bool on, CommandCallback onDone,
+                                                              std::chrono::milliseconds timeout) {
+    return m_executor->submit(on, [this, on]() { return on ? turnOn() : turnOff(); }, timeout, std::move(onDone));
+}
+
+std::future<DisplayCommandResult> DisplayService::scheduleDisplayOff(int delaySeconds, std::function<void()> onComplete,
+                                                                     CommandCallback onSwitched) {
+    // Cancel any existing scheduled operations
+    cancelScheduledOperations();
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_scheduleMutex);
+        m_displayOffRequested = true;
+        generation = ++m_offGeneration;
+    }
+    
+    // Turn off the display immediately, on the command thread: a hung
+    // display server must not stall the thread delivering device events
+    return requestPower(false, [this, generation, delaySeconds, onComplete, onSwitched](DisplayCommandResult result) {
+        if (onSwitched) {
+            onSwitched(result);
+        }
+        
+        // A timed-out command may still blank the screen later, so the
+        // display counts as off and the turn-on is armed all the same.
+        // Collapsed is no failure: a reconnect cleared the request below, and
+        // an early wake keeps it so that its revert and the delayed turn-on
+        // still apply
+        if (result == DisplayCommandResult::TimedOut) {
+            LOG_WARNING("DISPLAY", "Turning off the display timed out; it may still go off");
+        } else if (result != DisplayCommandResult::Completed && result != DisplayCommandResult::Collapsed) {
+            LOG_ERROR("DISPLAY", "Failed to turn off display (" << displayCommandResultName(result) << ")");
+            {
+                std::lock_guard<std::mutex> lock(m_scheduleMutex);
+                if (generation == m_offGeneration) {
+                    m_displayOffRequested = false;
+                }
+            }
+            if (onComplete) onComplete();
+            return;
+        }
+        
+        // Reconnected before or while switching, or a later turn-off owns
+        // the delayed turn-on
+        std::lock_guard<std::mutex> lock(m_scheduleMutex);
+        if (!m_displayOffRequested || generation != m_offGeneration) {
+            return;
+        }
+        
+        if (result != DisplayCommandResult::Collapsed) {
+            LOG_DEBUG("DISPLAY", "Display turned off, will turn back on in " << delaySeconds << " seconds or when device reconnects");
+        }
+        
+        // The token identifies this timer only: cancelling it can never hit a
+        // later schedule, and a cancelled timer never fires
+        m_scheduledTurnOn = m_scheduler->schedule(std::chrono::seconds(delaySeconds), [this, generation, onComplete]() {
+            {
+                // Already running when a later turn-off failed to cancel it;
+                // that turn-off owns the display and the token now
+                std::lock_guard<std::mutex> lock(m_scheduleMutex);
+                if (!m_displayOffRequested || generation != m_offGeneration) {
+                    return;
+                }
+                m_displayOffRequested = false;
+                m_scheduledTurnOn = TimerScheduler::Token();
+            }
+            
+            // A turn-off scheduled from here on may be queued ahead of this
+            // command, so it checks again before waking the display
+            LOG_DEBUG("DISPLAY", "Delay expired, turning display back on");
+            m_executor->submit(true, [this, generation]() {
+                {
+                    std::lock_guard<std::mutex> lock(m_scheduleMutex);
+                    if (generation != m_offGeneration) {
+                        return true;
+                    }
+                }
+                return turnOn();
+            }, DefaultCommandTimeout, [this, generation, onComplete](DisplayCommandResult) {
+                {
+                    std::lock_guard<std::mutex> lock(m_scheduleMutex);
+                    if (generation != m_offGeneration) {
+                        return;
+                    }
+                }
+                if (onComplete) {
+                    onComplete();
+                }
+            });
+        });
+    });
+}
+
+void DisplayService::cancelScheduledOperations() {
+    std::lock_guard<std::mutex> lock(m_scheduleMutex);
+    
+    if (m_scheduler->cancel(m_scheduledTurnOn)) {
+        LOG_DEBUG("DISPLAY", "Cancelling scheduled display operations");
+    }
+    m_scheduler->cancel(m_earlyWakeRevert);
+    m_scheduledTurnOn = TimerScheduler::Token();
+    m_earlyWakeRevert = TimerScheduler::Token();
+    m_displayOffRequested = false;
+}
+
+std::future<DisplayCommandResult> DisplayService::onDeviceReconnected(CommandCallback onSwitched) {
+    bool wasTurnedOff;
+    {
+        std::lock_guard<std::mutex> lock(m_scheduleMutex);
+        wasTurnedOff = m_displayOffRequested;
+        m_displayOffRequested = false;
+        m_scheduler->cancel(m_scheduledTurnOn);
+        m_scheduler->cancel(m_earlyWakeRevert);
+        m_scheduledTurnOn = TimerScheduler::Token();
+        m_earlyWakeRevert = TimerScheduler::Token();
+    }
+    
+    if (!wasTurnedOff) {
+        return std::future<DisplayCommandResult>();
+    }
+    
+    // Collapses with the turn-off if that has not run yet
+    LOG_DEBUG("DISPLAY", "Device reconnected, turning display back on");
+    return requestPower(true, std::move(onSwitched));
+}
+
+std::future<DisplayCommandResult> DisplayService::onDeviceReturning(CommandCallback onSwitched) {
+    {
+        std::lock_guard<std::mutex> lock(m_scheduleMutex);
+        if (!m_displayOffRequested) {
+            return std::future<DisplayCommandResult>();
+        }
+        
+        // The hint only saw a device like the selected one; if the debounced
+        // reconnect does not follow, the display goes back off. The delayed
+        // turn-on stays armed either way
+        uint64_t generation = m_offGeneration;
+        m_scheduler->cancel(m_earlyWakeRevert);
+        m_earlyWakeRevert = m_scheduler->schedule(std::chrono::milliseconds(m_earlyWakeTimeoutMs.load()),
+                                                  [this, generation]() {
+            {
+                std::lock_guard<std::mutex> lock(m_scheduleMutex);
+                m_earlyWakeRevert = TimerScheduler::Token();
+                if (!m_displayOffRequested || generation != m_offGeneration) {
+                    return;
+                }
+            }
+            LOG_INFO("DISPLAY", "Returning device was not confirmed, turning display off again");
+            requestPower(false);
+        });
+    }
+    
+    // Straight to the backend resolved at startup; collapses with the
+    // turn-off if that has not run yet
+    LOG_DEBUG("DISPLAY", "Device returning, turning display on early");
+    return requestPower(true, std::move(onSwitched));
+}
+
+void DisplayService::setEarlyWakeTimeout(std::chrono::milliseconds timeout) {
+    m_earlyWakeTimeoutMs = timeout.count();
+}
@@ -1,176 +1,288 @@
 #include "display_service.h"
-#include <iostream>
+#include "display_backends_linux.h"
+#include "core/logger.h"
 #include <thread>
 #include <chrono>
+#include <cerrno>
 #include <cstdlib>
-
-#ifdef PLATFORM_LINUX
-#include <X11/Xlib.h>
-#include <X11/extensions/dpms.h>
-#ifdef None
-#undef None
-#endif
-#endif
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 DisplayService::DisplayService() 
-    : m_scheduledTaskHandle(nullptr), m_isTaskScheduled(false) {
+    : m_scheduler(std::make_shared<TimerScheduler>()),
+      m_executor(std::make_unique<DisplayCommandExecutor>(m_scheduler)),
+      m_displayOffRequested(false), m_offGeneration(0),
+      m_earlyWakeTimeoutMs(DefaultEarlyWakeTimeout.count()), m_externalToolFallback(false),
+      m_backends(std::make_unique<DisplayBackendRegistry>()), m_displayState(StateUnknown),
+      m_stateTrusted(false), m_stateWatcherWakeFd(-1), m_stateWatcherStopping(false),
+      m_watchedNotificationFd(-1) {
 }
 
 DisplayService::~DisplayService() {
     cancelScheduledOperations();
+    m_executor->stop();  // queued commands call back into this object
+    stopStateWatcher();
 }
 
-void DisplayService::setLogCallback(std::function<void(const std::string&)> callback) {
-    m_logCallback = callback;
+void DisplayService::setExternalToolFallback(bool enabled) {
+    m_externalToolFallback = enabled;
 }
 
-void DisplayService::log(const std::string& message) {
-    if (m_logCallback) {
-        m_logCallback(message);
+std::string DisplayService::initialize(const std::string& preferredBackend) {
+    stopStateWatcher();
+    std::lock_guard<std::mutex> lock(m_backendMutex);
+    
+    // Registration order is the fallback order when the chosen backend fails
+    m_backends = std::make_unique<DisplayBackendRegistry>();
+    const bool waylandSession = getenv("WAYLAND_DISPLAY") != nullptr;
+    if (waylandSession) {
+        // XWayland accepts DPMS requests and xset without blanking anything,
+        // so the X11 paths would probe as working and never be used here
+        m_backends->add(std::make_unique<WaylandOutputPowerBackend>());
+        m_backends->add(std::make_unique<GnomeDisplayConfigBackend>());
+        m_backends->add(std::make_unique<KdePowerDevilBackend>());
+    } else {
+        m_backends->add(std::make_unique<X11DpmsBackend>());
+    }
+    m_backends->add(std::make_unique<DrmDpmsBackend>());
+    m_backends->add(std::make_unique<SysfsBacklightBackend>());
+    if (m_externalToolFallback && !waylandSession) {
+        m_backends->add(std::make_unique<ExternalCommandBackend>());
+    }
+    
+    std::string backend = m_backends->select(preferredBackend);
+    if (backend.empty()) {
+        LOG_ERROR("DISPLAY", "No display control backend available");
+    } else {
+        LOG_INFO("DISPLAY", "Display control backend: " << backend);
     }
-    std::cout << message << std::endl;
+    
+    m_displayState = StateUnknown;
+    readNotificationsLocked();
+    
+    DisplayBackend* active = m_backends->active();
+    if (active && active->notificationFd() >= 0) {
+        startStateWatcher();
+    }
+    return backend;
 }
 
-bool DisplayService::turnOn() {
-#ifdef PLATFORM_LINUX
-    log("Turning display on...");
+bool DisplayService::isStateKnown(DisplayState state) const {
+    return m_stateTrusted && m_displayState == state;
+}
+
+void DisplayService::setDisplayState(bool on) {
+    int state = on ? StateOn : StateOff;
+    if (m_displayState.exchange(state) != state) {
+        LOG_DEBUG("DISPLAY", "Display is now " << (on ? "on" : "off"));
+    }
+}
+
+void DisplayService::readNotificationsLocked() {
+    DisplayBackend* backend = m_backends->active();
     
-    // Try multiple methods to wake the display
+    bool on;
+    if (backend && backend->readNotifications(on)) {
+        setDisplayState(on);
+    }
     
-    // Method 1: Use xset to turn on DPMS
-    if (system("xset dpms force on") == 0) {
-        log("Display turned on successfully (xset)");
-        return true;
+    // The active backend can change on fallback or lose its connection
+    m_stateTrusted = backend && backend->reportsAllChanges();
+    followNotificationFdLocked();
+}
+
+void DisplayService::followNotificationFdLocked() {
+    if (m_stateWatcherWakeFd < 0) {
+        return;
     }
     
-    // Method 2: Use X11 DPMS extension directly
-    Display* display = XOpenDisplay(nullptr);
-    if (display) {
-        int dummy;
-        if (DPMSQueryExtension(display, &dummy, &dummy)) {
-            DPMSForceLevel(display, DPMSModeOn);
-            XFlush(display);
+    // The watcher sleeps on the descriptor it last read; a reconnect or a
+    // fallback moves the notifications elsewhere, so send it to re-read
+    DisplayBackend* backend = m_backends->active();
+    int notificationFd = backend ? backend->notificationFd() : -1;
+    if (notificationFd != m_watchedNotificationFd) {
+        uint64_t one = 1;
+        if (write(m_stateWatcherWakeFd, &one, sizeof(one)) < 0) {
+            LOG_ERROR("DISPLAY", "Failed to wake state watcher");
         }
-        XCloseDisplay(display);
-        log("Display turned on successfully (X11 DPMS)");
+    }
+}
+
+std::vector<std::string> DisplayService::targetOutputs() {
+    std::lock_guard<std::mutex> lock(m_targetOutputsMutex);
+    return m_targetOutputs;
+}
+
+namespace {
+
+std::string joinOutputs(const std::vector<std::string>& outputs) {
+    std::string joined;
+    for (const std::string& output : outputs) {
+        joined += (joined.empty() ? "" : ", ") + output;
+    }
+    return joined;
+}
+
+} // namespace
+
+bool DisplayService::turnOn() {
+    // Restore switched-off outputs first; the whole-screen wake below is
+    // free when the cache knows the screen is on
+    std::vector<std::string> outputs = targetOutputs();
+    if (!outputs.empty()) {
+        std::lock_guard<std::mutex> lock(m_backendMutex);
+        if (m_backends->setOutputPower(outputs, true)) {
+            LOG_INFO("DISPLAY", "Outputs turned on successfully (" << joinOutputs(outputs) << ")");
+        }
+        followNotificationFdLocked();
+    }
+    
+    // Only skip when notifications guarantee the cache is current
+    if (isStateKnown(StateOn)) {
+        LOG_DEBUG("DISPLAY", "Display already on, skipping turn on");
         return true;
     }
     
-    // Method 3: Simulate user activity
-    system("xdotool mousemove_relative 1 1");
-    system("xdotool mousemove_relative -- -1 -1");
+    LOG_INFO("DISPLAY", "Turning display on...");
     
-    log("Display turned on successfully (mouse simulation)");
-    return true;
-#else
-    log("Display turn on not implemented for this platform");
+    std::lock_guard<std::mutex> lock(m_backendMutex);
+    if (m_backends->setPower(true)) {
+        // Events queued while syncing are consumed before the cache is set
+        readNotificationsLocked();
+        setDisplayState(true);
+        LOG_INFO("DISPLAY", "Display turned on successfully (" << m_backends->active()->name() << ")");
+        return true;
+    }
+    
+    followNotificationFdLocked();
+    LOG_ERROR("DISPLAY", "Failed to turn on display");
     return false;
-#endif
 }
 
 bool DisplayService::turnOff() {
-#ifdef PLATFORM_LINUX
-    log("Turning display off...");
+    std::vector<std::string> outputs = targetOutputs();
+    if (!outputs.empty()) {
+        LOG_INFO("DISPLAY", "Turning outputs off: " << joinOutputs(outputs) << "...");
+        
+        std::lock_guard<std::mutex> lock(m_backendMutex);
+        bool switched = m_backends->setOutputPower(outputs, false);
+        followNotificationFdLocked();
+        if (switched) {
+            LOG_INFO("DISPLAY", "Outputs turned off successfully");
+            return true;
+        }
+        LOG_INFO("DISPLAY", "Per-output control failed, turning the whole screen off");
+    }
     
-    // Method 1: Use xset to turn off display
-    if (system("xset dpms force off") == 0) {
-        log("Display turned off successfully (xset)");
+    if (isStateKnown(StateOff)) {
+        LOG_DEBUG("DISPLAY", "Display already off, skipping turn off");
         return true;
     }
     
-    // Method 2: Use X11 DPMS extension directly
-    Display* display = XOpenDisplay(nullptr);
-    if (display) {
-        int dummy;
-        if (DPMSQueryExtension(display, &dummy, &dummy)) {
-            DPMSForceLevel(display, DPMSModeOff);
-            XFlush(display);
-        }
-        XCloseDisplay(display);
-        log("Display turned off successfully (X11 DPMS)");
+    LOG_INFO("DISPLAY", "Turning display off...");
+    
+    std::lock_guard<std::mutex> lock(m_backendMutex);
+    if (m_backends->setPower(false)) {
+        readNotificationsLocked();
+        setDisplayState(false);
+        LOG_INFO("DISPLAY", "Display turned off successfully (" << m_backends->active()->name() << ")");
         return true;
     }
     
-    log("Failed to turn off display");
-    return false;
-#else
-    log("Display turn off not implemented for this platform");
+    followNotificationFdLocked();
+    LOG_ERROR("DISPLAY", "Failed to turn off display");
     return false;
-#endif
 }
 
 bool DisplayService::isDisplayOn() {
-#ifdef PLATFORM_LINUX
-    Display* display = XOpenDisplay(nullptr);
-    if (display) {
-        int dummy;
-        if (DPMSQueryExtension(display, &dummy, &dummy)) {
-            CARD16 state;
-            BOOL onoff;
-            if (DPMSInfo(display, &state, &onoff)) {
-                XCloseDisplay(display);
-                return onoff && (state == DPMSModeOn);
-            }
-        }
-        XCloseDisplay(display);
+    int state = m_displayState;
+    if (m_stateTrusted && state != StateUnknown) {
+        return state == StateOn;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_backendMutex);
+    
+    bool on;
+    bool queried = m_backends->queryPower(on);
+    followNotificationFdLocked();
+    if (queried) {
+        setDisplayState(on);
+        return on;
     }
     
     // Fallback: assume display is on
     return true;
-#else
-    return true;
-#endif
 }
 
-void DisplayService::scheduleDisplayOff(int delaySeconds, std::function<void()> onComplete) {
-    // Cancel any existing scheduled operations
-    cancelScheduledOperations();
-    
-    // Turn off the display immediately
-    if (!turnOff()) {
-        std::cerr << "[DISPLAY] Failed to turn off display" << std::endl;
-        if (onComplete) onComplete();
+void DisplayService::startStateWatcher() {
+    m_stateWatcherWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_stateWatcherWakeFd < 0) {
+        LOG_ERROR("DISPLAY", "Failed to create watcher wake descriptor");
         return;
     }
-    
-    std::cout << "[DISPLAY] Display turned off, will turn back on in " << delaySeconds << " seconds or when device reconnects" << std::endl;
-    
-    m_isTaskScheduled = true;
-    
-    // Schedule turning the display back on after the delay
-    std::thread([this, delaySeconds, onComplete]() {
-        std::this_thread::sleep_for(std::chrono::seconds(delaySeconds));
-        
-        // Only turn on if the task hasn't been cancelled (e.g., by device reconnection)
-        if (m_isTaskScheduled) {
-            std::cout << "[DISPLAY] Delay expired, turning display back on" << std::endl;
-            turnOn();
-            m_isTaskScheduled = false;
-            
-            if (onComplete) {
-                onComplete();
-            }
-        }
-    }).detach();
+    m_stateWatcherStopping = false;
+    m_stateWatcher = std::thread(&DisplayService::watchDisplayState, this);
 }
 
-void DisplayService::cancelScheduledOperations() {
-    if (m_isTaskScheduled) {
-        std::cout << "[DISPLAY] Cancelling scheduled display operations" << std::endl;
-        m_isTaskScheduled = false;
+void DisplayService::stopStateWatcher() {
+    if (m_stateWatcher.joinable()) {
+        m_stateWatcherStopping = true;
+        uint64_t one = 1;
+        if (write(m_stateWatcherWakeFd, &one, sizeof(one)) < 0) {
+            LOG_ERROR("DISPLAY", "Failed to wake state watcher");
+        }
+        m_stateWatcher.join();
     }
     
-    if (m_scheduledTaskHandle) {
-        // Platform-specific cleanup if needed
-        m_scheduledTaskHandle = nullptr;
+    if (m_stateWatcherWakeFd >= 0) {
+        close(m_stateWatcherWakeFd);
+        m_stateWatcherWakeFd = -1;
     }
 }
 
-void DisplayService::onDeviceReconnected() {
-    if (m_isTaskScheduled) {
-        std::cout << "[DISPLAY] Device reconnected, turning display back on" << std::endl;
-        cancelScheduledOperations();
-        turnOn();
+void DisplayService::watchDisplayState() {
+    while (true) {
+        int notificationFd;
+        {
+            std::lock_guard<std::mutex> lock(m_backendMutex);
+            DisplayBackend* backend = m_backends->active();
+            notificationFd = backend ? backend->notificationFd() : -1;
+            m_watchedNotificationFd = notificationFd;
+        }
+        
+        // Sleeps until an event arrives or the wake descriptor reports either
+        // shutdown or a new notification descriptor (reconnect, fallback)
+        pollfd fds[2] = {
+            {m_stateWatcherWakeFd, POLLIN, 0},
+            {notificationFd, POLLIN, 0}
+        };
+        int ready = poll(fds, notificationFd >= 0 ? 2 : 1, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("DISPLAY", "State watcher poll failed");
+            return;
+        }
+        
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            if (read(m_stateWatcherWakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                LOG_ERROR("DISPLAY", "Failed to read state watcher wakeup");
+            }
+            if (m_stateWatcherStopping) {
+                return;
+            }
+            continue;
+        }
+        
+        if (notificationFd >= 0 && fds[1].revents) {
+            // A lost connection reports no descriptor until it reconnects,
+            // so a hung up socket is not polled again
+            std::lock_guard<std::mutex> lock(m_backendMutex);
+            readNotificationsLocked();
+        }
     }
 }
 
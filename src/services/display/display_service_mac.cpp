@@ -1,5 +1,5 @@
 #include "display_service.h"
-#include <iostream>
+#include "core/logger.h"
 #include <thread>
 #include <chrono>
 #include <cstdlib>
@@ -12,35 +12,36 @@
 #endif
 
 DisplayService::DisplayService() 
-    : m_scheduledTaskHandle(nullptr), m_isTaskScheduled(false) {
+    : m_scheduler(std::make_shared<TimerScheduler>()),
+      m_executor(std::make_unique<DisplayCommandExecutor>(m_scheduler)),
+      m_displayOffRequested(false), m_offGeneration(0),
+      m_earlyWakeTimeoutMs(DefaultEarlyWakeTimeout.count()), m_externalToolFallback(false) {
 }
 
 DisplayService::~DisplayService() {
     cancelScheduledOperations();
+    m_executor->stop();  // queued commands call back into this object
 }
 
-void DisplayService::setLogCallback(std::function<void(const std::string&)> logCallback) {
-    m_logCallback = logCallback;
+std::string DisplayService::initialize(const std::string& preferredBackend) {
+    // Single native path on this platform, nothing to probe
+    (void)preferredBackend;
+    return "macos-pmset";
 }
 
-void DisplayService::log(const std::string& message) {
-    // Always log to console
-    std::cout << "[DISPLAY] " << message << std::endl;
-    
-    // Also log to UI if callback is set
-    if (m_logCallback) {
-        m_logCallback(message);
-    }
+void DisplayService::setExternalToolFallback(bool enabled) {
+    // Only the X11 backend distinguishes native and external-tool paths
+    m_externalToolFallback = enabled;
 }
 
 bool DisplayService::turnOn() {
 #ifdef PLATFORM_MACOS
-    log("Turning display on...");
+    LOG_INFO("DISPLAY", "Turning display on...");
     
     // Method 1: Use caffeinate to wake the display
     int result = system("caffeinate -u -t 1");
     if (result == 0) {
-        log("Display turned on successfully (caffeinate)");
+        LOG_INFO("DISPLAY", "Display turned on successfully (caffeinate)");
         return true;
     }
     
@@ -66,32 +67,32 @@ bool DisplayService::turnOn() {
             CFRelease(moveEvent);
         }
         
-        log("Display turned on successfully (mouse simulation)");
+        LOG_INFO("DISPLAY", "Display turned on successfully (mouse simulation)");
         return true;
     }
     
     // Method 3: Fallback - try pressing a modifier key
     result = system("osascript -e 'tell application \"System Events\" to key code 63'");
     if (result == 0) {
-        log("Display turned on successfully (key simulation)");
+        LOG_INFO("DISPLAY", "Display turned on successfully (key simulation)");
     } else {
-        log("Failed to turn on display");
+        LOG_ERROR("DISPLAY", "Failed to turn on display");
     }
     return (result == 0);
 #else
-    std::cout << "Display turn on not implemented for this platform" << std::endl;
+    LOG_WARNING("DISPLAY", "Display turn on not implemented for this platform");
     return false;
 #endif
 }
 
 bool DisplayService::turnOff() {
 #ifdef PLATFORM_MACOS
-    log("Turning display off...");
+    LOG_INFO("DISPLAY", "Turning display off...");
     
     // Method 1: Use pmset to put display to sleep
     int result = system("pmset displaysleepnow");
     if (result == 0) {
-        log("Display turned off successfully (pmset)");
+        LOG_INFO("DISPLAY", "Display turned off successfully (pmset)");
         return true;
     }
     
@@ -101,20 +102,20 @@ bool DisplayService::turnOff() {
     if (r != MACH_PORT_NULL) {
         IORegistryEntrySetCFProperty(r, CFSTR("IORequestIdle"), kCFBooleanTrue);
         IOObjectRelease(r);
-        log("Display turned off successfully (IODisplayWrangler)");
+        LOG_INFO("DISPLAY", "Display turned off successfully (IODisplayWrangler)");
         return true;
     }
     
     // Method 3: Fallback - use AppleScript to trigger screensaver
     result = system("osascript -e 'tell application \"System Events\" to start current screen saver'");
     if (result == 0) {
-        log("Display turned off successfully (screensaver)");
+        LOG_INFO("DISPLAY", "Display turned off successfully (screensaver)");
     } else {
-        log("Failed to turn off display");
+        LOG_ERROR("DISPLAY", "Failed to turn off display");
     }
     return (result == 0);
 #else
-    std::cout << "Display turn off not implemented for this platform" << std::endl;
+    LOG_WARNING("DISPLAY", "Display turn off not implemented for this platform");
     return false;
 #endif
 }
@@ -128,58 +129,6 @@ bool DisplayService::isDisplayOn() {
 #endif
 }
 
-void DisplayService::scheduleDisplayOff(int delaySeconds, std::function<void()> onComplete) {
-    // Cancel any existing scheduled operations
-    cancelScheduledOperations();
-    
-    // Turn off the display immediately
-    if (!turnOff()) {
-        std::cerr << "[DISPLAY] Failed to turn off display" << std::endl;
-        if (onComplete) onComplete();
-        return;
-    }
-    
-    std::cout << "[DISPLAY] Display turned off, will turn back on in " << delaySeconds << " seconds or when device reconnects" << std::endl;
-    
-    m_isTaskScheduled = true;
-    
-    // Schedule turning the display back on after the delay
-    std::thread([this, delaySeconds, onComplete]() {
-        std::this_thread::sleep_for(std::chrono::seconds(delaySeconds));
-        
-        // Only turn on if the task hasn't been cancelled (e.g., by device reconnection)
-        if (m_isTaskScheduled) {
-            std::cout << "[DISPLAY] Delay expired, turning display back on" << std::endl;
-            turnOn();
-            m_isTaskScheduled = false;
-            
-            if (onComplete) {
-                onComplete();
-            }
-        }
-    }).detach();
-}
-
-void DisplayService::cancelScheduledOperations() {
-    if (m_isTaskScheduled) {
-        std::cout << "[DISPLAY] Cancelling scheduled display operations" << std::endl;
-        m_isTaskScheduled = false;
-    }
-    
-    if (m_scheduledTaskHandle) {
-        // Platform-specific cleanup if needed
-        m_scheduledTaskHandle = nullptr;
-    }
-}
-
-void DisplayService::onDeviceReconnected() {
-    if (m_isTaskScheduled) {
-        std::cout << "[DISPLAY] Device reconnected, turning display back on" << std::endl;
-        cancelScheduledOperations();
-        turnOn();
-    }
-}
-
 bool DisplayService::isDisplayActive() {
     return isDisplayOn();
 }
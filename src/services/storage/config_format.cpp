@@ -0,0 +1,564 @@
+#include "config_format.h"
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/**
+ * One [settings] key, bound to the AppConfig member it holds
+ * Exactly one of the member pointers is set.
+ */
+struct SettingField {
+    const char* name;
+    bool AppConfig::* flag;
+    int AppConfig::* number;
+    std::string AppConfig::* text;
+};
+
+// Written in this order; also the lookup table of the parser
+const SettingField SETTING_FIELDS[] = {
+    {"startOnBoot", &AppConfig::startOnBoot, nullptr, nullptr},
+    {"startMinimized", &AppConfig::startMinimized, nullptr, nullptr},
+    {"selectedDeviceId", nullptr, nullptr, &AppConfig::selectedDeviceId},
+    {"screenOffDelay", nullptr, &AppConfig::screenOffDelay, nullptr},
+    {"deviceDebounceMs", nullptr, &AppConfig::deviceDebounceMs, nullptr},
+    {"deviceMatchPolicy", nullptr, nullptr, &AppConfig::deviceMatchPolicy},
+    {"displayToolFallback", &AppConfig::displayToolFallback, nullptr, nullptr},
+    {"displayBackend", nullptr, nullptr, &AppConfig::displayBackend},
+};
+
+const SettingField* findSetting(const std::string& name) {
+    static const std::unordered_map<std::string, const SettingField*> index = [] {
+        std::unordered_map<std::string, const SettingField*> fields;
+        for (const SettingField& field : SETTING_FIELDS) {
+            fields[field.name] = &field;
+        }
+        return fields;
+    }();
+    
+    auto it = index.find(name);
+    return it != index.end() ? it->second : nullptr;
+}
+
+void appendString(std::string& out, const std::string& value) {
+    out += '"';
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            default:
+                if (c < 0x20 || c == 0x7f) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    out += '"';
+}
+
+void appendStringArray(std::string& out, const std::vector<std::string>& values) {
+    out += '[';
+    for (size_t i = 0; i < values.size(); ++i) {
+        out += i ? ", " : "";
+        appendString(out, values[i]);
+    }
+    out += ']';
+}
+
+/**
+ * Value on the right of "key =", as far as the format goes
+ */
+struct Value {
+    enum Type { String, Integer, Boolean, Array } type = String;
+    std::string text;
+    long long integer = 0;
+    bool flag = false;
+    std::vector<std::string> items;
+};
+
+/**
+ * Single pass over the document; the cursor only moves back to skip a
+ * value it could not read
+ */
+class Parser {
+public:
+    Parser(std::string_view text, std::vector<std::string>* knownDevices, std::vector<std::string>* warnings)
+        : m_text(text), m_pos(0), m_line(1), m_unsupported(false), m_knownDevices(knownDevices),
+          m_warnings(warnings) {}
+    
+    bool parse(AppConfig& config, std::string& error) {
+        std::string table;
+        while (true) {
+            skipBlank();
+            if (m_pos >= m_text.size()) {
+                return true;
+            }
+            
+            if (m_text[m_pos] == '[') {
+                ++m_pos;
+                skipSpace();
+                if (!parseKey(table)) {
+                    return fail(error, "invalid table name");
+                }
+                skipSpace();
+                if (!consume(']') || !endOfLine()) {
+                    return fail(error, "expected ] at the end of the table header");
+                }
+                continue;
+            }
+            
+            std::string key;
+            Value value;
+            int keyLine = m_line;
+            if (!parseKey(key)) {
+                return fail(error, "expected a key");
+            }
+            skipSpace();
+            if (!consume('=')) {
+                return fail(error, "expected = after " + key);
+            }
+            skipSpace();
+            size_t valueStart = m_pos;
+            m_unsupported = false;
+            if (!parseValue(value)) {
+                if (!m_unsupported) {
+                    return fail(error, m_message.empty() ? "invalid value for " + key : m_message);
+                }
+                
+                // Valid TOML this build has no use for (a float, a date, an
+                // inline table): skipped, whatever the key
+                m_pos = valueStart;
+                m_line = keyLine;
+                m_message.clear();
+                if (!skipValue()) {
+                    m_line = keyLine;
+                    return fail(error, m_message.empty() ? "invalid value for " + key : m_message);
+                }
+                if (!endOfLine()) {
+                    return fail(error, "unexpected text after the value of " + key);
+                }
+                warn(keyLine, "cannot read the value of " + key + ", skipped");
+                continue;
+            }
+            if (!endOfLine()) {
+                return fail(error, "unexpected text after the value of " + key);
+            }
+            
+            // A mistyped setting keeps its current value; the rest of the
+            // file still counts
+            if (!apply(table, key, value, config)) {
+                warn(keyLine, m_message + ", ignored");
+            }
+        }
+    }
+
+private:
+    bool fail(std::string& error, const std::string& message) {
+        error = "line " + std::to_string(m_line) + ": " + message;
+        return false;
+    }
+    
+    void warn(int line, const std::string& message) {
+        if (m_warnings) {
+            m_warnings->push_back("line " + std::to_string(line) + ": " + message);
+        }
+    }
+    
+    // Characters that may follow a value on its line, or an item in an array
+    bool atValueEnd() const {
+        if (m_pos >= m_text.size()) {
+            return true;
+        }
+        char c = m_text[m_pos];
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#' || c == ',' || c == ']';
+    }
+    
+    bool consume(char c) {
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+    
+    void skipSpace() {
+        while (m_pos < m_text.size() && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t')) {
+            ++m_pos;
+        }
+    }
+    
+    void skipComment() {
+        if (m_pos < m_text.size() && m_text[m_pos] == '#') {
+            while (m_pos < m_text.size() && m_text[m_pos] != '\n') {
+                ++m_pos;
+            }
+        }
+    }
+    
+    // Whitespace, newlines and comments, e.g. between the items of an array
+    void skipBlank() {
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos];
+            if (c == '\n') {
+                ++m_line;
+                ++m_pos;
+            } else if (c == ' ' || c == '\t' || c == '\r') {
+                ++m_pos;
+            } else if (c == '#') {
+                skipComment();
+            } else {
+                break;
+            }
+        }
+    }
+    
+    bool endOfLine() {
+        skipSpace();
+        skipComment();
+        consume('\r');
+        if (m_pos >= m_text.size()) {
+            return true;
+        }
+        if (consume('\n')) {
+            ++m_line;
+            return true;
+        }
+        return false;
+    }
+    
+    bool parseKey(std::string& key) {
+        if (m_pos < m_text.size() && m_text[m_pos] == '"') {
+            return parseString(key);
+        }
+        
+        size_t start = m_pos;
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos];
+            if (!(isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-')) {
+                break;
+            }
+            ++m_pos;
+        }
+        key.assign(m_text.substr(start, m_pos - start));
+        return !key.empty();
+    }
+    
+    bool parseString(std::string& out) {
+        out.clear();
+        if (!consume('"')) {
+            return false;
+        }
+        
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c == '\n') {
+                m_message = "unterminated string";
+                return false;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            
+            if (m_pos >= m_text.size()) {
+                break;
+            }
+            switch (m_text[m_pos++]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (!parseUnicodeEscape(out)) {
+                        m_message = "invalid \\u escape";
+                        return false;
+                    }
+                    break;
+                }
+                default:
+                    m_message = "unknown escape sequence";
+                    return false;
+            }
+        }
+        m_message = "unterminated string";
+        return false;
+    }
+    
+    // \uXXXX, stored as UTF-8
+    bool parseUnicodeEscape(std::string& out) {
+        if (m_pos + 4 > m_text.size()) {
+            return false;
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = m_text[m_pos++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else return false;
+        }
+        
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        return true;
+    }
+    
+    bool parseValue(Value& value) {
+        if (m_pos >= m_text.size()) {
+            return false;
+        }
+        
+        char c = m_text[m_pos];
+        if (m_text.compare(m_pos, 3, "\"\"\"") == 0) {
+            m_unsupported = true;  // multi-line string
+            return false;
+        }
+        if (c == '"') {
+            value.type = Value::String;
+            return parseString(value.text);
+        }
+        if (c == '[') {
+            value.type = Value::Array;
+            return parseArray(value.items);
+        }
+        if (m_text.compare(m_pos, 4, "true") == 0 || m_text.compare(m_pos, 5, "false") == 0) {
+            value.type = Value::Boolean;
+            value.flag = c == 't';
+            m_pos += value.flag ? 4 : 5;
+            m_unsupported = !atValueEnd();
+            return !m_unsupported;
+        }
+        
+        value.type = Value::Integer;
+        size_t start = m_pos;
+        if (c == '-' || c == '+') {
+            ++m_pos;
+        }
+        size_t digits = m_pos;
+        while (m_pos < m_text.size() && isdigit(static_cast<unsigned char>(m_text[m_pos]))) {
+            ++m_pos;
+        }
+        
+        // Floats, dates, hexadecimal, inf and the like
+        if (m_pos == digits || !atValueEnd()) {
+            m_unsupported = true;
+            return false;
+        }
+        if (m_pos - digits > 18) {
+            m_unsupported = true;
+            return false;
+        }
+        value.integer = std::stoll(std::string(m_text.substr(start, m_pos - start)));
+        return true;
+    }
+    
+    /**
+     * Step over a value without interpreting it: brackets and braces must
+     * balance and strings must be closed
+     */
+    bool skipValue() {
+        size_t start = m_pos;
+        int depth = 0;
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos];
+            if (c == '"' || c == '\'') {
+                if (!skipQuoted()) {
+                    return false;
+                }
+                continue;
+            }
+            if (depth == 0 && (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#')) {
+                break;
+            }
+            
+            if (c == '[' || c == '{') {
+                ++depth;
+            } else if (c == ']' || c == '}') {
+                if (--depth < 0) {
+                    return false;
+                }
+            } else if (c == '#') {
+                skipComment();
+                continue;
+            } else if (c == '\n') {
+                ++m_line;
+            }
+            ++m_pos;
+        }
+        if (depth != 0) {
+            m_message = "unterminated array or table";
+            return false;
+        }
+        return m_pos > start;
+    }
+    
+    bool skipQuoted() {
+        char quote = m_text[m_pos];
+        bool multiLine = m_text.compare(m_pos, 3, std::string(3, quote)) == 0;
+        m_pos += multiLine ? 3 : 1;
+        
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos];
+            if (multiLine && m_text.compare(m_pos, 3, std::string(3, quote)) == 0) {
+                m_pos += 3;
+                return true;
+            }
+            if (!multiLine && c == quote) {
+                ++m_pos;
+                return true;
+            }
+            if (c == '\n') {
+                if (!multiLine) {
+                    break;
+                }
+                ++m_line;
+            }
+            // Literal strings ('...') have no escapes
+            m_pos += c == '\\' && quote == '"' ? 2 : 1;
+        }
+        m_message = "unterminated string";
+        return false;
+    }
+    
+    bool parseArray(std::vector<std::string>& items) {
+        consume('[');
+        while (true) {
+            skipBlank();
+            if (consume(']')) {
+                return true;
+            }
+            
+            std::string item;
+            if (m_pos < m_text.size() && m_text[m_pos] != '"') {
+                m_unsupported = true;  // numbers, tables, nested arrays
+                return false;
+            }
+            if (!parseString(item)) {
+                return false;
+            }
+            items.push_back(std::move(item));
+            
+            skipBlank();
+            if (consume(']')) {
+                return true;
+            }
+            if (!consume(',')) {
+                m_message = "expected , or ] in array";
+                return false;
+            }
+        }
+    }
+    
+    bool apply(const std::string& table, const std::string& key, const Value& value, AppConfig& config) {
+        if (table.empty() && key == "version") {
+            if (value.type != Value::Integer || value.integer < 1) {
+                m_message = "version must be a positive integer";
+                return false;
+            }
+            return true;
+        }
+        
+        if (table == "settings") {
+            const SettingField* field = findSetting(key);
+            if (!field) {
+                return true; // Written by a newer version, or misspelt
+            }
+            if (field->flag && value.type == Value::Boolean) {
+                config.*field->flag = value.flag;
+            } else if (field->number && value.type == Value::Integer
+                       && value.integer >= INT_MIN && value.integer <= INT_MAX) {
+                config.*field->number = static_cast<int>(value.integer);
+            } else if (field->text && value.type == Value::String) {
+                config.*field->text = value.text;
+            } else {
+                m_message = key + " expects " + (field->flag ? "true or false" : field->number ? "an integer" : "a string");
+                return false;
+            }
+            return true;
+        }
+        
+        if (table == "outputs" || (table == "devices" && key == "known")) {
+            if (value.type != Value::Array) {
+                m_message = key + " expects an array of strings";
+                return false;
+            }
+            if (table == "outputs") {
+                config.deviceOutputs[key] = value.items;
+            } else if (m_knownDevices) {
+                *m_knownDevices = value.items;
+            }
+        }
+        return true;
+    }
+    
+    std::string_view m_text;
+    size_t m_pos;
+    int m_line;
+    std::string m_message;  // detail of the last value error
+    bool m_unsupported;     // the last value is valid TOML of a kind not read here
+    std::vector<std::string>* m_knownDevices;
+    std::vector<std::string>* m_warnings;
+};
+
+} // namespace
+
+std::string serializeConfig(const AppConfig& config) {
+    std::string out;
+    out.reserve(512);
+    
+    out += "# MonitorSwitch configuration\n";
+    out += "version = " + std::to_string(CONFIG_FORMAT_VERSION) + "\n\n";
+    
+    out += "[settings]\n";
+    for (const SettingField& field : SETTING_FIELDS) {
+        out += field.name;
+        out += " = ";
+        if (field.flag) {
+            out += config.*field.flag ? "true" : "false";
+        } else if (field.number) {
+            out += std::to_string(config.*field.number);
+        } else {
+            appendString(out, config.*field.text);
+        }
+        out += '\n';
+    }
+    
+    // Device ID -> outputs to switch when that device disconnects
+    out += "\n[outputs]\n";
+    for (const auto& entry : config.deviceOutputs) {
+        appendString(out, entry.first);
+        out += " = ";
+        appendStringArray(out, entry.second);
+        out += '\n';
+    }
+    return out;
+}
+
+bool parseConfig(std::string_view text, AppConfig& config, std::string& error,
+                 std::vector<std::string>* knownDevices, std::vector<std::string>* warnings) {
+    return Parser(text, knownDevices, warnings).parse(config, error);
+}
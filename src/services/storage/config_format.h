@@ -0,0 +1,51 @@
+#ifndef CONFIG_FORMAT_H
+#define CONFIG_FORMAT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "storage_service.h"
+
+/**
+ * Version written to the "version" key of config.toml
+ * Files with a newer version are still read; keys this build does not
+ * know are skipped.
+ */
+const int CONFIG_FORMAT_VERSION = 1;
+
+/**
+ * Serialise the configuration as one versioned document in a small subset
+ * of TOML:
+ *
+ *   version = 1
+ *   [settings]    one key per AppConfig field
+ *   [outputs]     "<device ID>" = ["HDMI-1", "DP-2"]
+ *
+ * Known devices are kept by KnownDeviceRegistry, in a journal of their own.
+ *
+ * @param config configuration to write
+ * @return file content
+ */
+std::string serializeConfig(const AppConfig& config);
+
+/**
+ * Parse a document written by serializeConfig(), or edited by hand
+ * Supported: tables, bare and quoted keys, basic strings with escapes,
+ * integers, booleans, arrays of strings (which may span lines) and
+ * comments. Unknown tables and keys are skipped, and so are values of
+ * other kinds (floats, dates, inline tables...) wherever they appear.
+ * A setting with a value of the wrong type keeps its current value.
+ * @param text file content
+ * @param config receives the values found; others keep their value
+ * @param error receives "line N: reason" when parsing fails
+ * @param knownDevices receives the [devices] known list of files written
+ *        before the device registry, if not null
+ * @param warnings receives "line N: reason" for every value skipped or
+ *        ignored, if not null
+ * @return false if the document is malformed
+ */
+bool parseConfig(std::string_view text, AppConfig& config, std::string& error,
+                 std::vector<std::string>* knownDevices = nullptr,
+                 std::vector<std::string>* warnings = nullptr);
+
+#endif // CONFIG_FORMAT_H
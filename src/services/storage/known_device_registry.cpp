@@ -0,0 +1,278 @@
+#include "known_device_registry.h"
+#include "core/logger.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+const char* const JOURNAL_HEADER = "# MonitorSwitch known devices\n";
+
+// Journal lines are tab-separated; ids and names may contain anything
+std::string escapeField(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string unescapeField(const std::string& value) {
+    std::string plain;
+    plain.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] != '\\' || i + 1 == value.size()) {
+            plain += value[i];
+            continue;
+        }
+        switch (value[++i]) {
+            case 't': plain += '\t'; break;
+            case 'n': plain += '\n'; break;
+            case 'r': plain += '\r'; break;
+            default: plain += value[i];
+        }
+    }
+    return plain;
+}
+
+std::vector<std::string> splitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos) {
+            return fields;
+        }
+        start = tab + 1;
+    }
+}
+
+long long toSeconds(KnownDeviceRegistry::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+KnownDeviceRegistry::Clock::time_point fromSeconds(long long seconds) {
+    return KnownDeviceRegistry::Clock::time_point(std::chrono::seconds(seconds));
+}
+
+} // namespace
+
+KnownDeviceRegistry::KnownDeviceRegistry(FileWriter writeFile)
+    : m_writeFile(std::move(writeFile)), m_records(0) {
+}
+
+KnownDeviceRegistry::~KnownDeviceRegistry() {
+    close();
+}
+
+bool KnownDeviceRegistry::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_journal.close();
+    m_devices.clear();
+    m_records = 0;
+    m_path = path;
+    
+    std::string content;
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (file.is_open()) {
+            std::ostringstream buffer;
+            buffer << file.rdbuf();
+            content = buffer.str();
+        }
+    }
+    
+    size_t start = 0;
+    size_t end;
+    while ((end = content.find('\n', start)) != std::string::npos) {
+        applyRecord(content.substr(start, end - start));
+        start = end + 1;
+    }
+    
+    // A torn last line must not run into the next append; rewriting drops it
+    bool torn = start < content.size();
+    if (content.empty() || torn || needsCompactionLocked()) {
+        if (torn) {
+            LOG_WARNING("CONFIG", "Dropping incomplete last entry of " << path);
+        }
+        return compactLocked();
+    }
+    return openJournalLocked();
+}
+
+void KnownDeviceRegistry::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_journal.close();
+}
+
+bool KnownDeviceRegistry::contains(const std::string& deviceId) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_devices.count(deviceId) != 0;
+}
+
+std::optional<KnownDeviceRegistry::Device> KnownDeviceRegistry::find(const std::string& deviceId) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_devices.find(deviceId);
+    if (it == m_devices.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+size_t KnownDeviceRegistry::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_devices.size();
+}
+
+std::vector<KnownDeviceRegistry::Device> KnownDeviceRegistry::devices() const {
+    std::vector<Device> devices;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        devices.reserve(m_devices.size());
+        for (const auto& entry : m_devices) {
+            devices.push_back(entry.second);
+        }
+    }
+    
+    std::sort(devices.begin(), devices.end(), [](const Device& a, const Device& b) {
+        return a.firstSeen != b.firstSeen ? a.firstSeen < b.firstSeen : a.id < b.id;
+    });
+    return devices;
+}
+
+bool KnownDeviceRegistry::touch(const std::string& deviceId, const std::string& friendlyName,
+                                Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto it = m_devices.find(deviceId);
+    if (it == m_devices.end()) {
+        Device device{deviceId, friendlyName, now, now};
+        it = m_devices.emplace(deviceId, device).first;
+        return appendLocked(deviceRecord(it->second));
+    }
+    
+    // Repeated sightings (a KVM switching back and forth) stay in memory
+    // until the stored last-seen time is more than the granularity old
+    Device& device = it->second;
+    bool renamed = !friendlyName.empty() && friendlyName != device.friendlyName;
+    bool stale = now - device.lastSeen >= TouchGranularity;
+    if (renamed) {
+        device.friendlyName = friendlyName;
+    }
+    if (!renamed && !stale) {
+        return true;
+    }
+    device.lastSeen = std::max(device.lastSeen, now);
+    return appendLocked(deviceRecord(device));
+}
+
+bool KnownDeviceRegistry::remove(const std::string& deviceId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_devices.erase(deviceId) == 0) {
+        return true;
+    }
+    return appendLocked("-\t" + escapeField(deviceId) + "\n");
+}
+
+bool KnownDeviceRegistry::compact() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return compactLocked();
+}
+
+size_t KnownDeviceRegistry::journalRecords() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_records;
+}
+
+bool KnownDeviceRegistry::appendLocked(const std::string& record) {
+    if (!m_journal.is_open()) {
+        return false;
+    }
+    
+    m_journal << record;
+    m_journal.flush();
+    if (!m_journal) {
+        LOG_ERROR("CONFIG", "Failed to append to " << m_path);
+        return false;
+    }
+    
+    ++m_records;
+    return needsCompactionLocked() ? compactLocked() : true;
+}
+
+bool KnownDeviceRegistry::needsCompactionLocked() const {
+    // Every device has one live line; rewrite once stale ones dominate
+    return m_records > 2 * m_devices.size() + 16;
+}
+
+bool KnownDeviceRegistry::compactLocked() {
+    std::vector<const Device*> devices;
+    devices.reserve(m_devices.size());
+    for (const auto& entry : m_devices) {
+        devices.push_back(&entry.second);
+    }
+    std::sort(devices.begin(), devices.end(), [](const Device* a, const Device* b) {
+        return a->firstSeen != b->firstSeen ? a->firstSeen < b->firstSeen : a->id < b->id;
+    });
+    
+    std::string content = JOURNAL_HEADER;
+    for (const Device* device : devices) {
+        content += deviceRecord(*device);
+    }
+    
+    // The file is replaced under the journal stream, which must not keep
+    // appending to the old one
+    m_journal.close();
+    bool written = m_writeFile(m_path, content);
+    if (written) {
+        m_records = devices.size();
+    } else {
+        LOG_ERROR("CONFIG", "Failed to compact " << m_path);
+    }
+    return openJournalLocked() && written;
+}
+
+bool KnownDeviceRegistry::openJournalLocked() {
+    m_journal.open(m_path, std::ios::binary | std::ios::app);
+    if (!m_journal.is_open()) {
+        LOG_ERROR("CONFIG", "Cannot open " << m_path << " for appending");
+        return false;
+    }
+    return true;
+}
+
+void KnownDeviceRegistry::applyRecord(const std::string& line) {
+    if (line.empty() || line[0] == '#') {
+        return;
+    }
+    
+    std::vector<std::string> fields = splitFields(line);
+    if (fields[0] == "-" && fields.size() == 2) {
+        m_devices.erase(unescapeField(fields[1]));
+        ++m_records;
+    } else if (fields[0] == "+" && fields.size() == 5) {
+        Device device;
+        device.id = unescapeField(fields[1]);
+        try {
+            device.firstSeen = fromSeconds(std::stoll(fields[2]));
+            device.lastSeen = fromSeconds(std::stoll(fields[3]));
+        } catch (const std::exception&) {
+            return; // Damaged line, skipped
+        }
+        device.friendlyName = unescapeField(fields[4]);
+        m_devices[device.id] = device;
+        ++m_records;
+    }
+}
+
+std::string KnownDeviceRegistry::deviceRecord(const Device& device) {
+    return "+\t" + escapeField(device.id) + "\t" + std::to_string(toSeconds(device.firstSeen)) + "\t"
+        + std::to_string(toSeconds(device.lastSeen)) + "\t" + escapeField(device.friendlyName) + "\n";
+}
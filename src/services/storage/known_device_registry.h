@@ -0,0 +1,106 @@
+#ifndef KNOWN_DEVICE_REGISTRY_H
+#define KNOWN_DEVICE_REGISTRY_H
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Devices MonitorSwitch has seen, with when and under which name
+ * Held in a hash map; on disk every change is one line appended to a
+ * journal, which is rewritten in compact form once stale lines outnumber
+ * the devices. All methods are thread-safe.
+ */
+class KnownDeviceRegistry {
+public:
+    using Clock = std::chrono::system_clock;
+    using FileWriter = std::function<bool(const std::string& path, const std::string& content)>;
+    
+    struct Device {
+        std::string id;
+        std::string friendlyName;
+        Clock::time_point firstSeen;
+        Clock::time_point lastSeen;
+    };
+    
+    // A device seen again within this time keeps its stored last-seen time
+    // and costs no write
+    static constexpr std::chrono::seconds TouchGranularity{60};
+    
+    /**
+     * @param writeFile replaces a whole file atomically, used for compaction
+     */
+    explicit KnownDeviceRegistry(FileWriter writeFile);
+    ~KnownDeviceRegistry();
+    
+    /**
+     * Load the journal and keep it open for appending
+     * A missing journal is created; a line cut short by a crash is ignored.
+     * @param path journal file
+     * @return false if the journal cannot be written
+     */
+    bool open(const std::string& path);
+    
+    /**
+     * Close the journal; the devices stay available in memory
+     */
+    void close();
+    
+    bool contains(const std::string& deviceId) const;
+    std::optional<Device> find(const std::string& deviceId) const;
+    size_t size() const;
+    
+    /**
+     * @return all devices, oldest first
+     */
+    std::vector<Device> devices() const;
+    
+    /**
+     * Record that a device was seen, adding it if it is new
+     * @param friendlyName name to keep, empty to keep the current one
+     * @param now time of the sighting
+     * @return false if the change could not be written
+     */
+    bool touch(const std::string& deviceId, const std::string& friendlyName = "",
+               Clock::time_point now = Clock::now());
+    
+    /**
+     * Forget a device
+     * @return false if the change could not be written
+     */
+    bool remove(const std::string& deviceId);
+    
+    /**
+     * Rewrite the journal with one line per device
+     * @return false if the journal could not be replaced
+     */
+    bool compact();
+    
+    /**
+     * Number of lines in the journal, for compaction decisions and tests
+     */
+    size_t journalRecords() const;
+
+private:
+    bool appendLocked(const std::string& record);
+    bool compactLocked();
+    bool needsCompactionLocked() const;
+    bool openJournalLocked();
+    void applyRecord(const std::string& line);
+    static std::string deviceRecord(const Device& device);
+    
+    FileWriter m_writeFile;
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Device> m_devices;
+    std::string m_path;
+    std::ofstream m_journal;
+    size_t m_records;   // device lines in the journal, live or stale
+};
+
+#endif // KNOWN_DEVICE_REGISTRY_H
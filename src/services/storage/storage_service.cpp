@@ -1,101 +1,34 @@
 #include "storage_service.h"
 #include "config.h"
+#include "core/logger.h"
 #include <windows.h>
 #include <shlobj.h>
-#include <fstream>
 #include <filesystem>
-#include <iostream>
-#include <sstream>
 
-const std::string StorageService::CONFIG_FILENAME = "config.ini";
+const std::string StorageService::CONFIG_FILENAME = "config.toml";
+const std::string StorageService::LEGACY_CONFIG_FILENAME = "config.ini";
 const std::string StorageService::DEVICE_LIST_FILENAME = "devices.txt";
+const std::string StorageService::KNOWN_DEVICES_FILENAME = "devices.log";
 
-StorageService::StorageService() {
+StorageService::StorageService()
+    : m_knownDevices(&StorageService::writeFileAtomic),
+      m_saveDelay(DefaultSaveDelay), m_writerStopping(false), m_fileHash(0), m_configHash(0),
+      m_watching(false) {
 }
 
 StorageService::~StorageService() {
-}
-
-void StorageService::setLogCallback(std::function<void(const std::string&)> logCallback) {
-    m_logCallback = logCallback;
+    shutdown();
 }
 
 bool StorageService::initialize() {
     m_appDataPath = getAppDataPath();
-    return ensureAppDataDirectory();
-}
-
-AppConfig StorageService::loadConfig() {
-    AppConfig config;
-    
-    std::string configPath = getConfigFilePath();
-    if (!fileExists(configPath)) {
-        // Return default configuration if file doesn't exist
-        return config;
-    }
-    
-    try {
-        std::ifstream file(configPath);
-        if (!file.is_open()) {
-            return config;
-        }
-        
-        std::string line;
-        while (std::getline(file, line)) {
-            if (line.empty() || line[0] == '#') continue;
-            
-            size_t pos = line.find('=');
-            if (pos != std::string::npos) {
-                std::string key = line.substr(0, pos);
-                std::string value = line.substr(pos + 1);
-                
-                if (key == "startOnBoot") {
-                    config.startOnBoot = (value == "true" || value == "1");
-                } else if (key == "startMinimized") {
-                    config.startMinimized = (value == "true" || value == "1");
-                } else if (key == "selectedDeviceId") {
-                    config.selectedDeviceId = value;
-                } else if (key == "screenOffDelay") {
-                    config.screenOffDelay = std::stoi(value);
-                }
-            }
-        }
-        
-        // Load known devices
-        config.knownDevices = loadDeviceList();
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error loading config: " << e.what() << std::endl;
-        // Return default config on error
-    }
-    
-    return config;
-}
-
-bool StorageService::saveConfig(const AppConfig& config) {
-    try {
-        std::ofstream file(getConfigFilePath());
-        if (!file.is_open()) {
-            return false;
-        }
-        
-        file << "# MonitorSwitch Configuration File\n";
-        file << "# Generated automatically - do not edit manually\n\n";
-        
-        file << "startOnBoot=" << (config.startOnBoot ? "true" : "false") << "\n";
-        file << "startMinimized=" << (config.startMinimized ? "true" : "false") << "\n";
-        file << "selectedDeviceId=" << config.selectedDeviceId << "\n";
-        file << "screenOffDelay=" << config.screenOffDelay << "\n";
-        
-        file.close();
-        
-        // Save device list separately
-        return saveDeviceList(config.knownDevices);
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving config: " << e.what() << std::endl;
+    if (!ensureAppDataDirectory()) {
         return false;
     }
+    
+    // Without its journal the registry still works, for this run only
+    m_knownDevices.open(getKnownDevicesFilePath());
+    return true;
 }
 
 std::string StorageService::getAppDataPath() {
@@ -112,78 +45,6 @@ std::string StorageService::getAppDataPath() {
     return m_appDataPath;
 }
 
-bool StorageService::saveDeviceList(const std::vector<std::string>& devices) {
-    try {
-        std::ofstream file(getDeviceListFilePath());
-        if (!file.is_open()) {
-            return false;
-        }
-        
-        file << "# Known USB Devices\n";
-        for (const auto& device : devices) {
-            file << device << "\n";
-        }
-        
-        return true;
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving device list: " << e.what() << std::endl;
-        return false;
-    }
-}
-
-std::vector<std::string> StorageService::loadDeviceList() {
-    std::vector<std::string> devices;
-    
-    std::string deviceListPath = getDeviceListFilePath();
-    if (!fileExists(deviceListPath)) {
-        return devices;
-    }
-    
-    try {
-        std::ifstream file(deviceListPath);
-        if (!file.is_open()) {
-            return devices;
-        }
-        
-        std::string line;
-        while (std::getline(file, line)) {
-            if (!line.empty() && line[0] != '#') {
-                devices.push_back(line);
-            }
-        }
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error loading device list: " << e.what() << std::endl;
-    }
-    
-    return devices;
-}
-
-bool StorageService::addKnownDevice(const std::string& deviceId) {
-    auto devices = loadDeviceList();
-    
-    // Check if device already exists
-    if (std::find(devices.begin(), devices.end(), deviceId) != devices.end()) {
-        return true; // Already exists
-    }
-    
-    devices.push_back(deviceId);
-    return saveDeviceList(devices);
-}
-
-bool StorageService::removeKnownDevice(const std::string& deviceId) {
-    auto devices = loadDeviceList();
-    
-    auto it = std::find(devices.begin(), devices.end(), deviceId);
-    if (it != devices.end()) {
-        devices.erase(it);
-        return saveDeviceList(devices);
-    }
-    
-    return true; // Device wasn't in list anyway
-}
-
 bool StorageService::ensureAppDataDirectory() {
     std::string appDataPath = getAppDataPath();
     if (appDataPath.empty()) {
@@ -217,16 +78,24 @@ std::string StorageService::getConfigFilePath() {
     return getAppDataPath() + "\\" + CONFIG_FILENAME;
 }
 
+std::string StorageService::getLegacyConfigFilePath() {
+    return getAppDataPath() + "\\" + LEGACY_CONFIG_FILENAME;
+}
+
 std::string StorageService::getDeviceListFilePath() {
     return getAppDataPath() + "\\" + DEVICE_LIST_FILENAME;
 }
 
+std::string StorageService::getKnownDevicesFilePath() {
+    return getAppDataPath() + "\\" + KNOWN_DEVICES_FILENAME;
+}
+
 bool StorageService::createDirectoryRecursive(const std::string& path) {
     try {
         std::filesystem::create_directories(path);
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Error creating directory: " << e.what() << std::endl;
+        LOG_ERROR("CONFIG", "Cannot create directory: " << e.what());
         return false;
     }
 }
@@ -235,12 +104,40 @@ bool StorageService::fileExists(const std::string& filePath) {
     return std::filesystem::exists(filePath);
 }
 
-void StorageService::log(const std::string& message) {
-    // Always log to console
-    std::cout << "[CONFIG] " << message << std::endl;
+bool StorageService::writeFileAtomic(const std::string& path, const std::string& content) {
+    // One temporary name per target: writers of the same file take turns
+    static std::mutex writeMutex;
+    std::lock_guard<std::mutex> lock(writeMutex);
     
-    // Also log to UI if callback is set
-    if (m_logCallback) {
-        m_logCallback(message);
+    const std::string tempPath = path + ".tmp";
+    HANDLE file = CreateFileA(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("CONFIG", "Cannot create " << tempPath << " (error " << GetLastError() << ")");
+        return false;
     }
+    
+    // The data must be on disk before the rename can expose it
+    DWORD written = 0;
+    bool success = WriteFile(file, content.data(), static_cast<DWORD>(content.size()), &written, nullptr)
+        && written == content.size()
+        && FlushFileBuffers(file);
+    CloseHandle(file);
+    
+    if (!success || !MoveFileExA(tempPath.c_str(), path.c_str(),
+                                 MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        LOG_ERROR("CONFIG", "Failed to write " << path << " (error " << GetLastError() << ")");
+        DeleteFileA(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// No file watching on Windows yet: edits are picked up at the next start
+
+bool StorageService::startWatching(ConfigChangedCallback) {
+    return false;
+}
+
+void StorageService::stopWatching() {
 }
@@ -1,11 +1,18 @@
 #ifndef STORAGE_SERVICE_H
 #define STORAGE_SERVICE_H
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
 #include <functional>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "known_device_registry.h"
 
 /**
  * Configuration data structure
@@ -15,9 +22,14 @@ struct AppConfig {
     bool startMinimized;
     std::string selectedDeviceId;
     int screenOffDelay;
-    std::vector<std::string> knownDevices;
+    int deviceDebounceMs;   // hysteresis window for flapping USB devices
+    std::string deviceMatchPolicy;  // "exact", "vidpid" or "port"
+    bool displayToolFallback;       // allow xset/xdotool when native display control fails
+    std::string displayBackend;     // display backend chosen by the last probe, empty to re-probe
+    std::map<std::string, std::vector<std::string>> deviceOutputs;  // device ID -> outputs to switch (XRandR names)
     
-    AppConfig() : startOnBoot(true), startMinimized(false), screenOffDelay(10) {}
+    AppConfig() : startOnBoot(true), startMinimized(false), screenOffDelay(10), deviceDebounceMs(300),
+                  deviceMatchPolicy("exact"), displayToolFallback(false) {}
 };
 
 /**
@@ -25,67 +37,112 @@ struct AppConfig {
  */
 class StorageService {
 public:
+    using ConfigChangedCallback = std::function<void(const AppConfig& config)>;
+    
+    static constexpr std::chrono::milliseconds DefaultSaveDelay{500};
+    
     StorageService();
     ~StorageService();
-
-    /**
-     * Set a logging callback function for UI logging
-     * @param logCallback function to call for logging messages
-     */
-    void setLogCallback(std::function<void(const std::string&)> logCallback);
-
+    
     /**
      * Initialize the storage service and create necessary directories
      * @return true if successful, false otherwise
      */
     bool initialize();
-
+    
     /**
      * Load configuration from storage
+     * Settings come from one file, read and parsed once. On first run after
+     * an upgrade the legacy config.ini and devices.txt are converted, to it
+     * and to the known-device registry, and kept as .bak files.
      * @return loaded configuration or default values if not found
      */
     AppConfig loadConfig();
-
+    
     /**
      * Save configuration to storage
+     * The file is left untouched when it already holds these settings, so
+     * an edited file keeps its layout and comments.
      * @param config configuration to save
      * @return true if successful, false otherwise
      */
     bool saveConfig(const AppConfig& config);
-
+    
+    /**
+     * Watch the configuration file for edits made outside the application
+     * The file is parsed again only when its content changed; the service's
+     * own saves are recognised and ignored. A file that does not parse is
+     * reported and left as it is. Saves still pending when an edit arrives
+     * are dropped, the edited file wins.
+     * Only available on Linux (inotify).
+     * @param onChanged called on the watcher thread with the new configuration
+     * @return true if the file is being watched
+     */
+    bool startWatching(ConfigChangedCallback onChanged);
+    
+    /**
+     * Stop watching the configuration file
+     */
+    void stopWatching();
+    
+    /**
+     * Save configuration in the background
+     * Changes are coalesced: the files are written once, with the latest
+     * configuration, when the save delay has passed since the first unsaved
+     * change. Call flush() or shutdown() to write them sooner.
+     * @param config configuration to save
+     */
+    void saveConfigDeferred(const AppConfig& config);
+    
+    /**
+     * Write the deferred configuration now, on the calling thread
+     * @return true if nothing was pending or it was saved successfully
+     */
+    bool flush();
+    
+    /**
+     * Write the deferred configuration and stop the background writer
+     */
+    void shutdown();
+    
+    /**
+     * Set how long changes are collected before a deferred save
+     * @param delay coalescing window, counted from the first unsaved change
+     */
+    void setSaveDelay(std::chrono::milliseconds delay);
+    
     /**
      * Get the application data directory path
      * @return full path to app data directory
      */
     std::string getAppDataPath();
-
+    
     /**
-     * Save device list to storage
-     * @param devices list of device IDs to save
-     * @return true if successful, false otherwise
+     * Devices seen so far, loaded by initialize()
      */
-    bool saveDeviceList(const std::vector<std::string>& devices);
-
+    KnownDeviceRegistry& knownDevices();
+    
     /**
      * Load device list from storage
-     * @return list of saved device IDs
+     * @return IDs of the known devices, oldest first
      */
     std::vector<std::string> loadDeviceList();
-
+    
     /**
-     * Add a device to the known devices list
+     * Add a device to the known devices list, or record that it was seen
      * @param deviceId device ID to add
+     * @param friendlyName name to show for it, empty to keep the current one
      * @return true if successful, false otherwise
      */
-    bool addKnownDevice(const std::string& deviceId);
-
+    bool addKnownDevice(const std::string& deviceId, const std::string& friendlyName = "");
+    
     /**
      * Remove a device from the known devices list
      * @param deviceId device ID to remove
      * @return true if successful, false otherwise
      */
     bool removeKnownDevice(const std::string& deviceId);
-
+    
     /**
      * Check if application data directory exists, create if not
      * @return true if directory exists or was created successfully
@@ -96,17 +153,75 @@ private:
     std::string getLocalAppDataPath();
     std::string getPlatformAppDataPath();  // Cross-platform method
     std::string getConfigFilePath();
+    std::string getLegacyConfigFilePath();
     std::string getDeviceListFilePath();
+    std::string getKnownDevicesFilePath();
     bool createDirectoryRecursive(const std::string& path);
     bool fileExists(const std::string& filePath);
+    static std::vector<std::string> splitList(const std::string& value);
+    static bool readFile(const std::string& path, std::string& content);
     
-    // Helper method to log both to console and UI
-    void log(const std::string& message);
+    /**
+     * Read config.ini and devices.txt as written by earlier versions
+     * @param config receives the values found
+     * @param knownDevices receives the device list
+     * @return true if the legacy files were read
+     */
+    bool loadLegacyConfig(AppConfig& config, std::vector<std::string>& knownDevices);
+    void importKnownDevices(const std::vector<std::string>& deviceIds);
+    
+    /**
+     * Replace a file so that readers and crashes only ever see the old or
+     * the new content: it is written to a temporary file next to the target,
+     * synced to disk, then renamed over it
+     * @return true if the new content is in place
+     */
+    static bool writeFileAtomic(const std::string& path, const std::string& content);
+    
+    void writerLoop();
+    bool writePending();
+    
+    /**
+     * Parse the configuration file if its content changed since it was
+     * last loaded or saved, and report it to the watch callback
+     */
+    void reloadIfChanged();
+    bool writeConfigFile(const AppConfig& config);
+    static size_t contentHash(const std::string& content);
     
     std::string m_appDataPath;
-    std::function<void(const std::string&)> m_logCallback;
+    KnownDeviceRegistry m_knownDevices;
+    
+    // Deferred saves, written by m_writerThread
+    std::mutex m_saveMutex;
+    std::condition_variable m_saveWake;
+    std::optional<AppConfig> m_pendingConfig;
+    std::chrono::steady_clock::time_point m_saveDeadline;
+    std::chrono::milliseconds m_saveDelay;
+    bool m_writerStopping;
+    std::thread m_writerThread;
+    std::mutex m_writeMutex;    // writes land in the order their configs were taken
+    
+    // What the configuration file holds, as far as this process knows;
+    // 0 when unknown
+    std::mutex m_fileStateMutex;
+    size_t m_fileHash;          // raw content, to skip events that changed nothing
+    size_t m_configHash;        // serialized settings, to skip saves that change nothing
+    ConfigChangedCallback m_onConfigChanged;
+    std::atomic<bool> m_watching;
+    
+#ifdef PLATFORM_LINUX
+    void watchLoop();
+    
+    std::thread m_watchThread;
+    int m_inotifyFd;
+    int m_watchWakeFd;          // eventfd used to stop the watch loop
+#endif
+    
     static const std::string CONFIG_FILENAME;
-    static const std::string DEVICE_LIST_FILENAME;
+    static const std::string LEGACY_CONFIG_FILENAME;
+    static const std::string DEVICE_LIST_FILENAME;  // legacy known-device list
+    static const std::string KNOWN_DEVICES_FILENAME;
 };
 
 #endif // STORAGE_SERVICE_H
@@ -0,0 +1,369 @@
+#include "storage_service.h"
+#include "config_format.h"
+#include "core/logger.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// Configuration file handling and write-behind persistence shared by all
+// platforms; only paths and the file writes differ
+
+void StorageService::setSaveDelay(std::chrono::milliseconds delay) {
+    std::lock_guard<std::mutex> lock(m_saveMutex);
+    m_saveDelay = delay;
+}
+
+void StorageService::saveConfigDeferred(const AppConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(m_saveMutex);
+        
+        // The window opens with the first unsaved change: a burst of edits
+        // (a spinbox being dragged) ends in one write, no later than the delay
+        if (!m_pendingConfig) {
+            m_saveDeadline = std::chrono::steady_clock::now() + m_saveDelay;
+        }
+        m_pendingConfig = config;
+        
+        if (!m_writerThread.joinable()) {
+            m_writerStopping = false;
+            m_writerThread = std::thread(&StorageService::writerLoop, this);
+        }
+    }
+    m_saveWake.notify_one();
+}
+
+bool StorageService::flush() {
+    return writePending();
+}
+
+void StorageService::shutdown() {
+    stopWatching();
+    
+    {
+        std::lock_guard<std::mutex> lock(m_saveMutex);
+        m_writerStopping = true;
+    }
+    m_saveWake.notify_one();
+    
+    if (m_writerThread.joinable()) {
+        m_writerThread.join();
+    }
+    
+    // Nothing is left unless a save raced with the writer exiting
+    writePending();
+}
+
+bool StorageService::writePending() {
+    // Taking the configuration under the write lock keeps an older one
+    // from being written after a newer one
+    std::lock_guard<std::mutex> writeLock(m_writeMutex);
+    
+    std::optional<AppConfig> config;
+    {
+        std::lock_guard<std::mutex> lock(m_saveMutex);
+        config.swap(m_pendingConfig);
+    }
+    if (!config) {
+        return true;
+    }
+    
+    if (!saveConfig(*config)) {
+        LOG_ERROR("CONFIG", "Failed to save configuration");
+        return false;
+    }
+    return true;
+}
+
+void StorageService::writerLoop() {
+    std::unique_lock<std::mutex> lock(m_saveMutex);
+    while (true) {
+        if (!m_pendingConfig) {
+            if (m_writerStopping) {
+                break;
+            }
+            m_saveWake.wait(lock);
+            continue;
+        }
+        
+        // Stopping writes at once; otherwise wait out the coalescing window
+        if (!m_writerStopping && std::chrono::steady_clock::now() < m_saveDeadline) {
+            m_saveWake.wait_until(lock, m_saveDeadline);
+            continue;
+        }
+        
+        lock.unlock();
+        writePending();
+        lock.lock();
+    }
+}
+
+AppConfig StorageService::loadConfig() {
+    AppConfig config;
+    std::string configPath = getConfigFilePath();
+    LOG_DEBUG("CONFIG", "Loading configuration from: " << configPath);
+    
+    std::string content;
+    std::vector<std::string> knownDevices;
+    if (readFile(configPath, content)) {
+        std::string error;
+        std::vector<std::string> warnings;
+        bool parsed = parseConfig(content, config, error, &knownDevices, &warnings);
+        for (const std::string& warning : warnings) {
+            LOG_WARNING("CONFIG", CONFIG_FILENAME << " " << warning);
+        }
+        if (!parsed) {
+            // Keep the broken file for the user to repair rather than
+            // overwriting it with the next save
+            LOG_WARNING("CONFIG", "Invalid configuration file (" << error << "), using default values");
+            std::error_code ec;
+            std::filesystem::rename(configPath, configPath + ".invalid", ec);
+            return AppConfig();
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(m_fileStateMutex);
+            m_fileHash = contentHash(content);
+            m_configHash = contentHash(serializeConfig(config));
+        }
+        
+        // Files from before the registry list the devices themselves
+        if (!knownDevices.empty()) {
+            importKnownDevices(knownDevices);
+            writeConfigFile(config);
+        }
+        LOG_INFO("CONFIG", "Configuration loaded with " << m_knownDevices.size() << " known devices");
+        return config;
+    }
+    
+    if (!loadLegacyConfig(config, knownDevices)) {
+        // Written out so that there is a file to edit
+        LOG_INFO("CONFIG", "Configuration file does not exist, using default values");
+        saveConfig(config);
+        return config;
+    }
+    
+    // One-time conversion; the legacy files stay around as backups
+    LOG_INFO("CONFIG", "Migrating " << LEGACY_CONFIG_FILENAME << " and " << DEVICE_LIST_FILENAME << " to " << CONFIG_FILENAME);
+    importKnownDevices(knownDevices);
+    if (saveConfig(config)) {
+        for (const std::string& legacyPath : {getLegacyConfigFilePath(), getDeviceListFilePath()}) {
+            std::error_code ec;
+            std::filesystem::rename(legacyPath, legacyPath + ".bak", ec);
+        }
+    }
+    return config;
+}
+
+bool StorageService::saveConfig(const AppConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(m_fileStateMutex);
+        if (m_configHash != 0 && m_configHash == contentHash(serializeConfig(config))) {
+            return true;
+        }
+    }
+    return writeConfigFile(config);
+}
+
+bool StorageService::writeConfigFile(const AppConfig& config) {
+    std::string content = serializeConfig(config);
+    size_t hash = contentHash(content);
+    
+    // An edit the watcher has not read yet (it waits for the file to
+    // settle) must not be renamed over; reloadIfChanged() applies it and
+    // drops this save. Deferred saves get here with m_writeMutex held, which
+    // keeps the watcher from reading in between
+    std::string onDisk;
+    bool checkEdits = m_watching && readFile(getConfigFilePath(), onDisk);
+    
+    // Recorded before the rename, which the watcher may see at once
+    {
+        std::lock_guard<std::mutex> lock(m_fileStateMutex);
+        if (checkEdits && m_fileHash != 0 && contentHash(onDisk) != m_fileHash) {
+            LOG_INFO("CONFIG", "Configuration file was edited, not overwriting it");
+            return true;
+        }
+        m_fileHash = hash;
+        m_configHash = hash;
+    }
+    
+    if (!writeFileAtomic(getConfigFilePath(), content)) {
+        LOG_ERROR("CONFIG", "Failed to write configuration file");
+        std::lock_guard<std::mutex> lock(m_fileStateMutex);
+        m_fileHash = 0;
+        m_configHash = 0;
+        return false;
+    }
+    return true;
+}
+
+void StorageService::reloadIfChanged() {
+    AppConfig config;
+    {
+        // No deferred save may land between reading the edit and dropping
+        // the saves it overrides
+        std::lock_guard<std::mutex> writeLock(m_writeMutex);
+        
+        std::string content;
+        if (!readFile(getConfigFilePath(), content)) {
+            return; // Deleted or being replaced; the next event tells
+        }
+        
+        size_t hash = contentHash(content);
+        {
+            std::lock_guard<std::mutex> lock(m_fileStateMutex);
+            if (hash == m_fileHash) {
+                return; // Our own save, or a write that changed nothing
+            }
+            m_fileHash = hash;
+        }
+        
+        std::vector<std::string> knownDevices;
+        std::vector<std::string> warnings;
+        std::string error;
+        bool parsed = parseConfig(content, config, error, &knownDevices, &warnings);
+        for (const std::string& warning : warnings) {
+            LOG_WARNING("CONFIG", CONFIG_FILENAME << " " << warning);
+        }
+        if (!parsed) {
+            // Likely still being edited; the running settings stay
+            LOG_WARNING("CONFIG", "Ignoring edited configuration file (" << error << ")");
+            return;
+        }
+        importKnownDevices(knownDevices);
+        
+        {
+            std::lock_guard<std::mutex> lock(m_fileStateMutex);
+            m_configHash = contentHash(serializeConfig(config));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_saveMutex);
+            if (m_pendingConfig) {
+                LOG_INFO("CONFIG", "Unsaved settings replaced by the edited configuration file");
+                m_pendingConfig.reset();
+            }
+        }
+    }
+    
+    LOG_INFO("CONFIG", "Configuration file changed, applying it");
+    if (m_onConfigChanged) {
+        m_onConfigChanged(config);
+    }
+}
+
+size_t StorageService::contentHash(const std::string& content) {
+    // 0 stands for unknown content
+    size_t hash = std::hash<std::string>()(content);
+    return hash != 0 ? hash : 1;
+}
+
+bool StorageService::loadLegacyConfig(AppConfig& config, std::vector<std::string>& knownDevices) {
+    std::string content;
+    bool found = false;
+    
+    if (readFile(getLegacyConfigFilePath(), content)) {
+        found = true;
+        std::istringstream file(content);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            
+            size_t pos = line.find('=');
+            if (pos == std::string::npos) continue;
+            std::string key = line.substr(0, pos);
+            std::string value = line.substr(pos + 1);
+            
+            try {
+                if (key == "startOnBoot") {
+                    config.startOnBoot = (value == "true" || value == "1");
+                } else if (key == "startMinimized") {
+                    config.startMinimized = (value == "true" || value == "1");
+                } else if (key == "selectedDeviceId") {
+                    config.selectedDeviceId = value;
+                } else if (key == "screenOffDelay") {
+                    config.screenOffDelay = std::stoi(value);
+                } else if (key == "deviceDebounceMs") {
+                    config.deviceDebounceMs = std::stoi(value);
+                } else if (key == "deviceMatchPolicy") {
+                    config.deviceMatchPolicy = value;
+                } else if (key == "displayToolFallback") {
+                    config.displayToolFallback = (value == "true" || value == "1");
+                } else if (key == "displayBackend") {
+                    config.displayBackend = value;
+                } else if (key.compare(0, 7, "output.") == 0) {
+                    config.deviceOutputs[key.substr(7)] = splitList(value);
+                }
+            } catch (const std::exception& e) {
+                LOG_WARNING("CONFIG", "Ignoring invalid legacy setting " << key << ": " << e.what());
+            }
+        }
+    }
+    
+    if (readFile(getDeviceListFilePath(), content)) {
+        found = true;
+        std::istringstream file(content);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line[0] != '#') {
+                knownDevices.push_back(line);
+            }
+        }
+    }
+    
+    return found;
+}
+
+void StorageService::importKnownDevices(const std::vector<std::string>& deviceIds) {
+    for (const std::string& deviceId : deviceIds) {
+        if (!m_knownDevices.contains(deviceId)) {
+            m_knownDevices.touch(deviceId);
+        }
+    }
+}
+
+KnownDeviceRegistry& StorageService::knownDevices() {
+    return m_knownDevices;
+}
+
+std::vector<std::string> StorageService::loadDeviceList() {
+    std::vector<std::string> deviceIds;
+    for (const KnownDeviceRegistry::Device& device : m_knownDevices.devices()) {
+        deviceIds.push_back(device.id);
+    }
+    return deviceIds;
+}
+
+bool StorageService::addKnownDevice(const std::string& deviceId, const std::string& friendlyName) {
+    return m_knownDevices.touch(deviceId, friendlyName);
+}
+
+bool StorageService::removeKnownDevice(const std::string& deviceId) {
+    return m_knownDevices.remove(deviceId);
+}
+
+bool StorageService::readFile(const std::string& path, std::string& content) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    // One read of the whole file
+    std::streamoff size = file.tellg();
+    if (size < 0) {
+        return false;
+    }
+    content.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return static_cast<bool>(file.read(&content[0], size));
+}
+
+std::vector<std::string> StorageService::splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::istringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
@@ -1,168 +1,58 @@
 #include "storage_service.h"
 #include "config.h"
-#include <fstream>
+#include "core/logger.h"
 #include <filesystem>
-#include <iostream>
-#include <algorithm>
-#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
 #ifdef PLATFORM_MACOS
     #include <pwd.h>
-    #include <unistd.h>
 #elif defined(PLATFORM_LINUX)
     #include <pwd.h>
-    #include <unistd.h>
+    #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <sys/inotify.h>
 #endif
 
-const std::string StorageService::CONFIG_FILENAME = "config.ini";
+const std::string StorageService::CONFIG_FILENAME = "config.toml";
+const std::string StorageService::LEGACY_CONFIG_FILENAME = "config.ini";
 const std::string StorageService::DEVICE_LIST_FILENAME = "devices.txt";
+const std::string StorageService::KNOWN_DEVICES_FILENAME = "devices.log";
 
-StorageService::StorageService() {
+StorageService::StorageService()
+    : m_knownDevices(&StorageService::writeFileAtomic),
+      m_saveDelay(DefaultSaveDelay), m_writerStopping(false), m_fileHash(0), m_configHash(0),
+      m_watching(false)
+#ifdef PLATFORM_LINUX
+      , m_inotifyFd(-1), m_watchWakeFd(-1)
+#endif
+{
 }
 
 StorageService::~StorageService() {
-}
-
-void StorageService::setLogCallback(std::function<void(const std::string&)> logCallback) {
-    m_logCallback = logCallback;
-}
-
-void StorageService::log(const std::string& message) {
-    // Always log to console
-    std::cout << "[CONFIG] " << message << std::endl;
-    
-    // Also log to UI if callback is set
-    if (m_logCallback) {
-        m_logCallback(message);
-    }
+    shutdown();
 }
 
 bool StorageService::initialize() {
-    log("Initializing storage service...");
+    LOG_DEBUG("CONFIG", "Initializing storage service...");
     
     m_appDataPath = getAppDataPath();
-    log("App data path: " + m_appDataPath);
+    LOG_INFO("CONFIG", "App data path: " << m_appDataPath);
     
     bool success = ensureAppDataDirectory();
     if (success) {
-        log("Storage service initialized successfully");
+        // Without its journal the registry still works, for this run only
+        m_knownDevices.open(getKnownDevicesFilePath());
+        LOG_DEBUG("CONFIG", "Storage service initialized successfully");
     } else {
-        log("Failed to initialize storage service");
+        LOG_ERROR("CONFIG", "Failed to initialize storage service");
     }
     
     return success;
 }
 
-AppConfig StorageService::loadConfig() {
-    log("Loading configuration file...");
-    AppConfig config;
-    
-    std::string configPath = getConfigFilePath();
-    log("Loading configuration from: " + configPath);
-    
-    if (!fileExists(configPath)) {
-        log("Configuration file does not exist, using default values");
-        return config;
-    }
-    
-    try {
-        std::ifstream file(configPath);
-        if (!file.is_open()) {
-            log("Failed to open configuration file for reading");
-            return config;
-        }
-        
-        log("Successfully opened configuration file");
-        
-        std::string line;
-        int lineNumber = 0;
-        while (std::getline(file, line)) {
-            lineNumber++;
-            if (line.empty() || line[0] == '#') continue;
-            
-            size_t pos = line.find('=');
-            if (pos != std::string::npos) {
-                std::string key = line.substr(0, pos);
-                std::string value = line.substr(pos + 1);
-                
-                log("Line " + std::to_string(lineNumber) + ": " + key + " = " + value);
-                
-                if (key == "startOnBoot") {
-                    config.startOnBoot = (value == "true" || value == "1");
-                    log("Set startOnBoot to: " + std::string(config.startOnBoot ? "true" : "false"));
-                } else if (key == "startMinimized") {
-                    config.startMinimized = (value == "true" || value == "1");
-                    log("Set startMinimized to: " + std::string(config.startMinimized ? "true" : "false"));
-                } else if (key == "selectedDeviceId") {
-                    config.selectedDeviceId = value;
-                    log("Set selectedDeviceId to: " + config.selectedDeviceId);
-                } else if (key == "screenOffDelay") {
-                    config.screenOffDelay = std::stoi(value);
-                    log("Set screenOffDelay to: " + std::to_string(config.screenOffDelay) + " seconds");
-                }
-            }
-        }
-        
-        log("Loading device list...");
-        config.knownDevices = loadDeviceList();
-        log("Loaded " + std::to_string(config.knownDevices.size()) + " known devices");
-        
-    } catch (const std::exception& e) {
-        log("Error loading config: " + std::string(e.what()));
-    }
-    
-    log("Configuration loading completed");
-    return config;
-}
-
-bool StorageService::saveConfig(const AppConfig& config) {
-    log("Saving configuration file...");
-    std::string configPath = getConfigFilePath();
-    log("Saving configuration to: " + configPath);
-    
-    try {
-        std::ofstream file(configPath);
-        if (!file.is_open()) {
-            log("Failed to open configuration file for writing");
-            return false;
-        }
-        
-        log("Writing configuration values...");
-        
-        file << "# MonitorSwitch Configuration File\n";
-        file << "# Generated automatically - do not edit manually\n\n";
-        
-        file << "startOnBoot=" << (config.startOnBoot ? "true" : "false") << "\n";
-        log("Written startOnBoot: " + std::string(config.startOnBoot ? "true" : "false"));
-        
-        file << "startMinimized=" << (config.startMinimized ? "true" : "false") << "\n";
-        log("Written startMinimized: " + std::string(config.startMinimized ? "true" : "false"));
-        
-        file << "selectedDeviceId=" << config.selectedDeviceId << "\n";
-        log("Written selectedDeviceId: " + config.selectedDeviceId);
-        
-        file << "screenOffDelay=" << config.screenOffDelay << "\n";
-        log("Written screenOffDelay: " + std::to_string(config.screenOffDelay));
-        
-        file.close();
-        
-        log("Saving device list...");
-        bool deviceListSaved = saveDeviceList(config.knownDevices);
-        
-        if (deviceListSaved) {
-            log("Configuration saved successfully");
-        } else {
-            log("Failed to save device list");
-        }
-        
-        return deviceListSaved;
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving config: " << e.what() << std::endl;
-        return false;
-    }
-}
-
 std::string StorageService::getAppDataPath() {
     if (!m_appDataPath.empty()) {
         return m_appDataPath;
@@ -177,88 +67,6 @@ std::string StorageService::getAppDataPath() {
     return m_appDataPath;
 }
 
-bool StorageService::saveDeviceList(const std::vector<std::string>& devices) {
-    try {
-        std::ofstream file(getDeviceListFilePath());
-        if (!file.is_open()) {
-            return false;
-        }
-        
-        file << "# Known USB Devices\n";
-        for (const auto& device : devices) {
-            file << device << "\n";
-        }
-        
-        return true;
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving device list: " << e.what() << std::endl;
-        return false;
-    }
-}
-
-std::vector<std::string> StorageService::loadDeviceList() {
-    std::vector<std::string> devices;
-    
-    std::string deviceListPath = getDeviceListFilePath();
-    log("Loading device list from: " + deviceListPath);
-    
-    if (!fileExists(deviceListPath)) {
-        log("Device list file does not exist");
-        return devices;
-    }
-    
-    try {
-        std::ifstream file(deviceListPath);
-        if (!file.is_open()) {
-            log("Failed to open device list file for reading");
-            return devices;
-        }
-        
-        log("Successfully opened device list file");
-        
-        std::string line;
-        int deviceCount = 0;
-        while (std::getline(file, line)) {
-            if (!line.empty() && line[0] != '#') {
-                devices.push_back(line);
-                deviceCount++;
-                log("Device " + std::to_string(deviceCount) + ": " + line);
-            }
-        }
-        
-        log("Total devices loaded: " + std::to_string(devices.size()));
-        
-    } catch (const std::exception& e) {
-        log("Error loading device list: " + std::string(e.what()));
-    }
-    
-    return devices;
-}
-
-bool StorageService::addKnownDevice(const std::string& deviceId) {
-    auto devices = loadDeviceList();
-    
-    if (std::find(devices.begin(), devices.end(), deviceId) != devices.end()) {
-        return true; // Already exists
-    }
-    
-    devices.push_back(deviceId);
-    return saveDeviceList(devices);
-}
-
-bool StorageService::removeKnownDevice(const std::string& deviceId) {
-    auto devices = loadDeviceList();
-    
-    auto it = std::find(devices.begin(), devices.end(), deviceId);
-    if (it != devices.end()) {
-        devices.erase(it);
-        return saveDeviceList(devices);
-    }
-    
-    return true;
-}
-
 bool StorageService::ensureAppDataDirectory() {
     std::string appDataPath = getAppDataPath();
     if (appDataPath.empty()) {
@@ -315,16 +123,24 @@ std::string StorageService::getConfigFilePath() {
     return getAppDataPath() + "/" + CONFIG_FILENAME;
 }
 
+std::string StorageService::getLegacyConfigFilePath() {
+    return getAppDataPath() + "/" + LEGACY_CONFIG_FILENAME;
+}
+
 std::string StorageService::getDeviceListFilePath() {
     return getAppDataPath() + "/" + DEVICE_LIST_FILENAME;
 }
 
+std::string StorageService::getKnownDevicesFilePath() {
+    return getAppDataPath() + "/" + KNOWN_DEVICES_FILENAME;
+}
+
 bool StorageService::createDirectoryRecursive(const std::string& path) {
     try {
         std::filesystem::create_directories(path);
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Error creating directory: " << e.what() << std::endl;
+        LOG_ERROR("CONFIG", "Cannot create directory: " << e.what());
         return false;
     }
 }
@@ -332,3 +148,148 @@ bool StorageService::createDirectoryRecursive(const std::string& path) {
 bool StorageService::fileExists(const std::string& filePath) {
     return std::filesystem::exists(filePath);
 }
+
+bool StorageService::writeFileAtomic(const std::string& path, const std::string& content) {
+    // One temporary name per target: writers of the same file take turns
+    static std::mutex writeMutex;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    
+    const std::string tempPath = path + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("CONFIG", "Cannot create " << tempPath << ": " << strerror(errno));
+        return false;
+    }
+    
+    const char* data = content.data();
+    size_t remaining = content.size();
+    bool written = true;
+    while (remaining > 0) {
+        ssize_t count = write(fd, data, remaining);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            written = false;
+            break;
+        }
+        data += count;
+        remaining -= static_cast<size_t>(count);
+    }
+    
+    // The data must be on disk before the rename can expose it
+    written = written && fsync(fd) == 0;
+    written = close(fd) == 0 && written;
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("CONFIG", "Failed to write " << path << ": " << strerror(errno));
+        unlink(tempPath.c_str());
+        return false;
+    }
+    
+    // Make the rename itself durable
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int dirFd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
+
+#ifdef PLATFORM_LINUX
+
+bool StorageService::startWatching(ConfigChangedCallback onChanged) {
+    if (m_watchThread.joinable()) {
+        return true;
+    }
+    
+    m_inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    m_watchWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    
+    // The directory is watched, not the file: saves and most editors
+    // replace the file by renaming another one over it
+    if (m_inotifyFd < 0 || m_watchWakeFd < 0
+        || inotify_add_watch(m_inotifyFd, getAppDataPath().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        LOG_WARNING("CONFIG", "Cannot watch " << getAppDataPath() << ": " << strerror(errno));
+        stopWatching();
+        return false;
+    }
+    
+    m_onConfigChanged = std::move(onChanged);
+    m_watchThread = std::thread(&StorageService::watchLoop, this);
+    m_watching = true;
+    LOG_DEBUG("CONFIG", "Watching " << getConfigFilePath() << " for changes");
+    return true;
+}
+
+void StorageService::stopWatching() {
+    m_watching = false;
+    if (m_watchThread.joinable()) {
+        uint64_t one = 1;
+        if (write(m_watchWakeFd, &one, sizeof(one)) < 0) {
+            LOG_ERROR("CONFIG", "Cannot stop the configuration watcher: " << strerror(errno));
+        }
+        m_watchThread.join();
+    }
+    
+    for (int* fd : {&m_inotifyFd, &m_watchWakeFd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    m_onConfigChanged = nullptr;
+}
+
+void StorageService::watchLoop() {
+    // Tools that write in several steps get this long to finish before
+    // the file is read
+    const int settleMs = 100;
+    
+    struct pollfd fds[2] = {{m_inotifyFd, POLLIN, 0}, {m_watchWakeFd, POLLIN, 0}};
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+    
+    while (true) {
+        fds[0].revents = 0;
+        fds[1].revents = 0;
+        int ready = poll(fds, 2, changed ? settleMs : -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("CONFIG", "Configuration watcher failed: " << strerror(errno));
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+        
+        if (ready == 0) {
+            // Quiet since the last change
+            changed = false;
+            reloadIfChanged();
+            continue;
+        }
+        
+        ssize_t length;
+        while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* entry = buffer; entry < buffer + length; ) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(entry);
+                if (event->len > 0 && CONFIG_FILENAME == event->name) {
+                    changed = true;
+                }
+                entry += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+#else
+
+// No file watching on this platform: edits are picked up at the next start
+
+bool StorageService::startWatching(ConfigChangedCallback) {
+    return false;
+}
+
+void StorageService::stopWatching() {
+}
+
+#endif // PLATFORM_LINUX
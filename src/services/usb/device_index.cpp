@@ -0,0 +1,97 @@
+#include "device_index.h"
+
+void DeviceIndex::rebuild(const std::vector<UsbDevice>& devices) {
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    size_t capacity = 16;
+    while (capacity < devices.size() * 2) {
+        capacity <<= 1;
+    }
+    
+    m_slots.assign(capacity, 0);
+    m_mask = capacity - 1;
+    
+    for (size_t i = 0; i < devices.size(); ++i) {
+        size_t slot = devices[i].identityHash & m_mask;
+        while (m_slots[slot] != 0) {
+            slot = (slot + 1) & m_mask;
+        }
+        m_slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+size_t DeviceIndex::find(const std::vector<UsbDevice>& devices, const UsbDevice& device) const {
+    if (m_slots.empty()) {
+        return npos;
+    }
+    
+    size_t slot = device.identityHash & m_mask;
+    while (m_slots[slot] != 0) {
+        size_t position = m_slots[slot] - 1;
+        if (position < devices.size() && devices[position].sameIdentity(device)) {
+            return position;
+        }
+        slot = (slot + 1) & m_mask;
+    }
+    
+    return npos;
+}
+
+size_t DeviceIndex::find(const std::vector<UsbDevice>& devices, const UsbDeviceKey& key) const {
+    if (m_slots.empty()) {
+        return npos;
+    }
+    
+    const uint64_t hash = key.hash();
+    size_t slot = hash & m_mask;
+    while (m_slots[slot] != 0) {
+        size_t position = m_slots[slot] - 1;
+        if (position < devices.size() && devices[position].identityHash == hash
+            && devices[position].key == key) {
+            return position;
+        }
+        slot = (slot + 1) & m_mask;
+    }
+    
+    return npos;
+}
+
+const UsbDevice* DeviceSet::findMatch(const UsbDeviceKey& selector, DeviceMatchPolicy policy) const {
+    // A fully specified exact key is a hash lookup; wildcards need a scan,
+    // which stays cheap at the size of a USB bus
+    if (policy == DeviceMatchPolicy::Exact) {
+        if (const UsbDevice* device = find(selector)) {
+            return device;
+        }
+        if (selector.serialHash != 0 && selector.portPath != 0) {
+            return nullptr;  // nothing else can match every field
+        }
+    }
+    
+    for (const auto& device : devices) {
+        if (matchDeviceKey(selector, device.key, policy)) {
+            return &device;
+        }
+    }
+    return nullptr;
+}
+
+void computeDeviceDelta(const std::vector<UsbDevice>& previous, const DeviceIndex& previousIndex,
+                        const std::vector<UsbDevice>& current, const DeviceIndex& currentIndex,
+                        DeviceDelta& delta) {
+    delta.clear();
+    
+    // Newly connected devices
+    for (const auto& device : current) {
+        if (previousIndex.find(previous, device) == DeviceIndex::npos) {
+            delta.added.push_back(device);
+        }
+    }
+    
+    // Disconnected devices
+    for (const auto& cached : previous) {
+        if (currentIndex.find(current, cached) == DeviceIndex::npos) {
+            delta.removed.push_back(cached);
+            delta.removed.back().isConnected = false;
+        }
+    }
+}
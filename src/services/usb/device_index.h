@@ -0,0 +1,110 @@
+#ifndef DEVICE_INDEX_H
+#define DEVICE_INDEX_H
+
+#include "usb_device.h"
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * Result of comparing two device sets
+ */
+struct DeviceDelta {
+    std::vector<UsbDevice> added;
+    std::vector<UsbDevice> removed;
+    std::chrono::steady_clock::time_point detectedAt;  // when the kernel event (or poll) revealed the change
+    
+    bool empty() const { return added.empty() && removed.empty(); }
+    
+    void clear() {
+        added.clear();
+        removed.clear();
+        detectedAt = std::chrono::steady_clock::time_point();
+    }
+};
+
+/**
+ * Open-addressing hash index over a vector of devices, keyed on
+ * UsbDevice::identityHash. The index stores positions only, so it stays
+ * valid when the indexed vector is moved, and rebuilding reuses its storage.
+ */
+class DeviceIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /**
+     * Index all devices of a vector, replacing the previous content
+     * @param devices vector to index
+     */
+    void rebuild(const std::vector<UsbDevice>& devices);
+
+    /**
+     * Look up a device with the same identity
+     * @param devices vector the index was built from
+     * @param device device to look for
+     * @return position in devices, or npos if absent
+     */
+    size_t find(const std::vector<UsbDevice>& devices, const UsbDevice& device) const;
+
+    /**
+     * Look up a device by its identity key
+     * @param devices vector the index was built from
+     * @param key exact key to look for
+     * @return position in devices, or npos if absent
+     */
+    size_t find(const std::vector<UsbDevice>& devices, const UsbDeviceKey& key) const;
+
+    void swap(DeviceIndex& other) {
+        m_slots.swap(other.m_slots);
+        std::swap(m_mask, other.m_mask);
+    }
+
+private:
+    std::vector<uint32_t> m_slots;  // position + 1, 0 marks an empty slot
+    size_t m_mask = 0;
+};
+
+/**
+ * Immutable set of devices with its index, published as a snapshot
+ */
+struct DeviceSet {
+    std::vector<UsbDevice> devices;
+    DeviceIndex index;
+    
+    /**
+     * Find a device by exact identity in O(1)
+     * @return the device, or nullptr if it is not in the set
+     */
+    const UsbDevice* find(const UsbDeviceKey& key) const {
+        size_t position = index.find(devices, key);
+        return position == DeviceIndex::npos ? nullptr : &devices[position];
+    }
+    
+    const UsbDevice* find(const std::string& deviceId) const {
+        return find(parseDeviceKey(deviceId));
+    }
+    
+    /**
+     * Find the first device satisfying a configured key
+     * @param selector configured key, zero fields act as wildcards
+     * @param policy fields to compare, see matchDeviceKey()
+     * @return the device, or nullptr if none matches
+     */
+    const UsbDevice* findMatch(const UsbDeviceKey& selector, DeviceMatchPolicy policy) const;
+};
+
+/**
+ * Compute the add/remove delta between two indexed device sets in O(n)
+ * @param previous previously known devices
+ * @param previousIndex index built from previous
+ * @param current freshly enumerated devices
+ * @param currentIndex index built from current
+ * @param delta receives the changes (cleared first, capacity is reused)
+ */
+void computeDeviceDelta(const std::vector<UsbDevice>& previous, const DeviceIndex& previousIndex,
+                        const std::vector<UsbDevice>& current, const DeviceIndex& currentIndex,
+                        DeviceDelta& delta);
+
+#endif // DEVICE_INDEX_H
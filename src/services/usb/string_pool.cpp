@@ -0,0 +1,25 @@
+#include "string_pool.h"
+
+const std::string& StringPool::intern(std::string_view value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto it = m_strings.find(value);
+    if (it != m_strings.end()) {
+        return *it->second;
+    }
+    
+    auto owned = std::make_unique<std::string>(value);
+    const std::string& result = *owned;
+    m_strings.emplace(std::string_view(result), std::move(owned));
+    return result;
+}
+
+size_t StringPool::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_strings.size();
+}
+
+const std::string& StringPool::empty() {
+    static const std::string value;
+    return value;
+}
@@ -0,0 +1,45 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Thread-safe pool of immutable strings
+ * Each distinct value is stored once; the returned references stay valid
+ * for the lifetime of the pool. Looking up a value that is already pooled
+ * does not allocate.
+ */
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    /**
+     * Get the pooled copy of a string, adding it on first use
+     * @param value string to intern
+     * @return stable reference to the pooled string
+     */
+    const std::string& intern(std::string_view value);
+
+    /**
+     * Number of distinct strings held
+     */
+    size_t size() const;
+
+    /**
+     * Shared empty string, valid without any pool
+     */
+    static const std::string& empty();
+
+private:
+    mutable std::mutex m_mutex;
+    // Keys view the owned strings, which never move
+    std::unordered_map<std::string_view, std::unique_ptr<std::string>> m_strings;
+};
+
+#endif // STRING_POOL_H
@@ -0,0 +1,228 @@
+#ifndef USB_DEVICE_H
+#define USB_DEVICE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "string_pool.h"
+
+/**
+ * 64-bit FNV-1a hash used to index devices by identity
+ * @param data bytes to hash
+ * @param size number of bytes
+ * @param seed previous hash when hashing several fields
+ * @return hash value
+ */
+inline uint64_t hashIdentity(const char* data, size_t size,
+                             uint64_t seed = 14695981039346656037ULL) {
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline uint64_t hashIdentity(const std::string& value) {
+    return hashIdentity(value.data(), value.size());
+}
+
+/**
+ * 32-bit digest of a serial number string
+ * @return non-zero hash, 0 is reserved for "no serial"
+ */
+inline uint32_t hashSerial(const char* serial, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    uint64_t hash = hashIdentity(serial, size);
+    uint32_t folded = static_cast<uint32_t>(hash ^ (hash >> 32));
+    return folded != 0 ? folded : 1;
+}
+
+/**
+ * Fixed-size identity of a physical USB device
+ * Zero in serialHash or portPath means the platform could not provide it.
+ */
+struct UsbDeviceKey {
+    uint16_t vendorId = 0;
+    uint16_t productId = 0;
+    uint32_t serialHash = 0;  // hashSerial() of the serial number (or Windows instance ID)
+    uint64_t portPath = 0;    // bus number in the top byte, then one byte per hub port
+    
+    bool operator==(const UsbDeviceKey& other) const {
+        return vendorId == other.vendorId && productId == other.productId
+            && serialHash == other.serialHash && portPath == other.portPath;
+    }
+    bool operator!=(const UsbDeviceKey& other) const { return !(*this == other); }
+    
+    /**
+     * Well-mixed 64-bit hash of all fields, used to index devices
+     */
+    uint64_t hash() const {
+        auto mix = [](uint64_t x) {
+            x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+            x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        };
+        uint64_t ids = (static_cast<uint64_t>(vendorId) << 48)
+                     | (static_cast<uint64_t>(productId) << 32) | serialHash;
+        return mix(ids ^ mix(portPath));
+    }
+};
+
+/**
+ * Pack a bus number and hub port chain into UsbDeviceKey::portPath
+ * @param bus bus number
+ * @param ports port numbers from the root hub down, at most 7 are kept
+ * @param count number of ports
+ */
+inline uint64_t packPortPath(unsigned bus, const unsigned* ports, size_t count) {
+    uint64_t path = static_cast<uint64_t>(bus & 0xff) << 56;
+    for (size_t i = 0; i < count && i < 7; ++i) {
+        path |= static_cast<uint64_t>(ports[i] & 0xff) << (48 - 8 * i);
+    }
+    return path;
+}
+
+/**
+ * Build the device ID string used in configuration files and the UI
+ * e.g. USB_VID_046d&PID_c52b&SN_1a2b3c4d&PORT_0102030000000000
+ * @param buffer receives the ID, 64 bytes are always enough
+ * @return length of the ID
+ */
+inline size_t formatDeviceId(const UsbDeviceKey& key, char* buffer, size_t size) {
+    int length = snprintf(buffer, size, "USB_VID_%04x&PID_%04x", key.vendorId, key.productId);
+    if (key.serialHash != 0) {
+        length += snprintf(buffer + length, size - length, "&SN_%08x", key.serialHash);
+    }
+    if (key.portPath != 0) {
+        length += snprintf(buffer + length, size - length, "&PORT_%016llx",
+                           static_cast<unsigned long long>(key.portPath));
+    }
+    return static_cast<size_t>(length);
+}
+
+inline std::string formatDeviceId(const UsbDeviceKey& key) {
+    char buffer[64];
+    return std::string(buffer, formatDeviceId(key, buffer, sizeof(buffer)));
+}
+
+/**
+ * Recover the key from a device ID
+ * Accepts formatDeviceId() output, native Windows instance paths
+ * (USB\VID_046D&PID_C52B\<instance>) and legacy USB_VID_xxxx&PID_yyyy IDs,
+ * for which the serial and port stay unknown (zero).
+ */
+inline UsbDeviceKey parseDeviceKey(const std::string& deviceId) {
+    UsbDeviceKey key;
+    const char* id = deviceId.c_str();
+    
+    const char* vid = strstr(id, "VID_");
+    const char* pid = strstr(id, "PID_");
+    if (!vid || !pid) {
+        return key;
+    }
+    key.vendorId = static_cast<uint16_t>(strtoul(vid + 4, nullptr, 16));
+    key.productId = static_cast<uint16_t>(strtoul(pid + 4, nullptr, 16));
+    
+    if (const char* serial = strstr(pid, "&SN_")) {
+        key.serialHash = static_cast<uint32_t>(strtoul(serial + 4, nullptr, 16));
+    } else if (const char* instance = strchr(pid, '\\')) {
+        key.serialHash = hashSerial(instance + 1, strlen(instance + 1));
+    }
+    if (const char* port = strstr(pid, "&PORT_")) {
+        key.portPath = strtoull(port + 6, nullptr, 16);
+    }
+    return key;
+}
+
+/**
+ * How a configured device is recognised among the connected ones
+ */
+enum class DeviceMatchPolicy {
+    Exact,       // VID/PID plus serial and port when the configured ID has them
+    VidPidOnly,  // any device of the same model
+    PortOnly     // whatever is plugged into the configured port
+};
+
+inline DeviceMatchPolicy parseDeviceMatchPolicy(const std::string& name) {
+    if (name == "vidpid") return DeviceMatchPolicy::VidPidOnly;
+    if (name == "port") return DeviceMatchPolicy::PortOnly;
+    return DeviceMatchPolicy::Exact;
+}
+
+inline const char* deviceMatchPolicyName(DeviceMatchPolicy policy) {
+    switch (policy) {
+        case DeviceMatchPolicy::VidPidOnly: return "vidpid";
+        case DeviceMatchPolicy::PortOnly: return "port";
+        default: return "exact";
+    }
+}
+
+/**
+ * Check whether a connected device satisfies a configured one
+ * @param selector key of the configured device, zero fields act as wildcards
+ * @param device key of the connected device
+ * @param policy fields to compare
+ */
+inline bool matchDeviceKey(const UsbDeviceKey& selector, const UsbDeviceKey& device,
+                           DeviceMatchPolicy policy) {
+    const bool sameModel = selector.vendorId == device.vendorId && selector.productId == device.productId;
+    switch (policy) {
+        case DeviceMatchPolicy::VidPidOnly:
+            return sameModel;
+        case DeviceMatchPolicy::PortOnly:
+            // IDs saved without a port can only be matched by model
+            return selector.portPath != 0 ? selector.portPath == device.portPath : sameModel;
+        default:
+            return sameModel
+                && (selector.serialHash == 0 || selector.serialHash == device.serialHash)
+                && (selector.portPath == 0 || selector.portPath == device.portPath);
+    }
+}
+
+/**
+ * Structure representing a USB device
+ * Fixed-size and trivially copyable: the ID and friendly name point into the
+ * StringPool of the UsbService that enumerated the device, so they remain
+ * valid for as long as that service exists.
+ */
+struct UsbDevice {
+    UsbDeviceKey key;       // parsed from the device ID once, when first seen
+    uint64_t identityHash;  // key.hash()
+    const std::string* id;
+    const std::string* name;
+    bool isConnected;
+    
+    UsbDevice()
+        : identityHash(0), id(&StringPool::empty()), name(&StringPool::empty()), isConnected(false) {}
+    
+    /**
+     * @param pool pool owning the strings, must outlive the record
+     * @param deviceId platform device ID
+     * @param friendlyName human-readable name
+     */
+    UsbDevice(StringPool& pool, std::string_view deviceId, std::string_view friendlyName)
+        : id(&pool.intern(deviceId)), name(&pool.intern(friendlyName)), isConnected(true) {
+        key = parseDeviceKey(*id);
+        identityHash = key.hash();
+    }
+    
+    const std::string& deviceId() const { return *id; }
+    const std::string& friendlyName() const { return *name; }
+    uint16_t vendorId() const { return key.vendorId; }
+    uint16_t productId() const { return key.productId; }
+    
+    /**
+     * Check whether two records describe the same physical device
+     */
+    bool sameIdentity(const UsbDevice& other) const {
+        return identityHash == other.identityHash && key == other.key;
+    }
+};
+
+#endif // USB_DEVICE_H
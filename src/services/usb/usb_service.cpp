@@ -7,7 +7,10 @@
 #pragma comment(lib, "setupapi.lib")
 
 UsbService::UsbService() 
-    : m_hiddenWindow(nullptr), m_deviceNotification(nullptr), m_isMonitoring(false) {
+    : m_hiddenWindow(nullptr), m_deviceNotification(nullptr), m_snapshotStale(false),
+      m_matchPolicy(DeviceMatchPolicy::Exact), m_isMonitoring(false),
+      m_eventQueue(EVENT_QUEUE_CAPACITY), m_dispatchPending(false),
+      m_resyncPending(false), m_resyncWatched(false), m_resyncWatchedBefore(false) {
 }
 
 UsbService::~UsbService() {
@@ -48,18 +51,6 @@ void UsbService::shutdown() {
     }
 }
 
-std::vector<UsbDevice> UsbService::getConnectedDevices() {
-    return enumerateUsbDevices();
-}
-
-bool UsbService::isDeviceConnected(const std::string& deviceId) {
-    auto devices = getConnectedDevices();
-    return std::any_of(devices.begin(), devices.end(),
-        [&deviceId](const UsbDevice& device) {
-            return device.deviceId == deviceId;
-        });
-}
-
 void UsbService::setOnDeviceConnected(DeviceCallback callback) {
     m_onDeviceConnected = callback;
 }
@@ -88,7 +79,7 @@ bool UsbService::startMonitoring() {
     }
     
     m_isMonitoring = true;
-    m_cachedDevices = getConnectedDevices();
+    refreshDeviceSet(false);
     
     return true;
 }
@@ -125,40 +116,12 @@ void UsbService::handleDeviceChange(WPARAM wParam, LPARAM lParam) {
     (void)lParam; // Suppress unused parameter warning
     
     if (wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE) {
-        auto currentDevices = getConnectedDevices();
-        
         // Compare with cached devices to find changes
-        for (const auto& device : currentDevices) {
-            auto it = std::find_if(m_cachedDevices.begin(), m_cachedDevices.end(),
-                [&device](const UsbDevice& cached) {
-                    return cached.deviceId == device.deviceId;
-                });
-            
-            if (it == m_cachedDevices.end() && m_onDeviceConnected) {
-                m_onDeviceConnected(device);
-            }
-        }
-        
-        for (const auto& cached : m_cachedDevices) {
-            auto it = std::find_if(currentDevices.begin(), currentDevices.end(),
-                [&cached](const UsbDevice& device) {
-                    return device.deviceId == cached.deviceId;
-                });
-            
-            if (it == currentDevices.end() && m_onDeviceDisconnected) {
-                UsbDevice disconnected = cached;
-                disconnected.isConnected = false;
-                m_onDeviceDisconnected(disconnected);
-            }
-        }
-        
-        m_cachedDevices = currentDevices;
+        refreshDeviceSet();
     }
 }
 
-std::vector<UsbDevice> UsbService::enumerateUsbDevices() {
-    std::vector<UsbDevice> devices;
-    
+void UsbService::enumerateUsbDevices(std::vector<UsbDevice>& devices) {
     // Get device information set for USB devices
     HDEVINFO deviceInfoSet = SetupDiGetClassDevs(
         nullptr, L"USB", nullptr,
@@ -166,7 +129,7 @@ std::vector<UsbDevice> UsbService::enumerateUsbDevices() {
     );
     
     if (deviceInfoSet == INVALID_HANDLE_VALUE) {
-        return devices;
+        return;
     }
     
     SP_DEVINFO_DATA deviceInfoData = {};
@@ -179,8 +142,7 @@ std::vector<UsbDevice> UsbService::enumerateUsbDevices() {
         // Get device instance ID
         if (SetupDiGetDeviceInstanceId(deviceInfoSet, &deviceInfoData, deviceId, sizeof(deviceId)/sizeof(wchar_t), nullptr)) {
             // Only process USB devices
-            std::wstring wDeviceId(deviceId);
-            if (wDeviceId.find(L"USB\\") != 0) {
+            if (wcsncmp(deviceId, L"USB\\", 4) != 0) {
                 continue; // Skip non-USB devices
             }
             
@@ -202,48 +164,32 @@ std::vector<UsbDevice> UsbService::enumerateUsbDevices() {
                     sizeof(friendlyName), &requiredSize);
             }
             
-            // Convert to string and create device object
-            std::wstring wFriendlyName(friendlyName);
-            
-            // Proper Unicode to UTF-8 conversion
-            std::string deviceIdStr;
-            std::string friendlyNameStr;
-            
-            // Convert device ID
-            int deviceIdLen = WideCharToMultiByte(CP_UTF8, 0, wDeviceId.c_str(), -1, nullptr, 0, nullptr, nullptr);
-            if (deviceIdLen > 0) {
-                deviceIdStr.resize(deviceIdLen - 1);
-                WideCharToMultiByte(CP_UTF8, 0, wDeviceId.c_str(), -1, &deviceIdStr[0], deviceIdLen, nullptr, nullptr);
-            }
+            // Proper Unicode to UTF-8 conversion, into stack buffers so that
+            // devices whose strings are already pooled cost no allocation
+            char deviceIdUtf8[1024];
+            char friendlyNameUtf8[1024];
             
-            // Convert friendly name
-            int nameLen = WideCharToMultiByte(CP_UTF8, 0, wFriendlyName.c_str(), -1, nullptr, 0, nullptr, nullptr);
-            if (nameLen > 0) {
-                friendlyNameStr.resize(nameLen - 1);
-                WideCharToMultiByte(CP_UTF8, 0, wFriendlyName.c_str(), -1, &friendlyNameStr[0], nameLen, nullptr, nullptr);
+            int deviceIdLen = WideCharToMultiByte(CP_UTF8, 0, deviceId, -1, deviceIdUtf8,
+                                                  sizeof(deviceIdUtf8), nullptr, nullptr);
+            if (deviceIdLen <= 1) {
+                continue;
             }
             
-            // Use device ID as name if friendly name is empty
-            if (friendlyNameStr.empty()) {
-                friendlyNameStr = deviceIdStr;
-            }
+            int nameLen = WideCharToMultiByte(CP_UTF8, 0, friendlyName, -1, friendlyNameUtf8,
+                                              sizeof(friendlyNameUtf8), nullptr, nullptr);
             
-            // Extract VID and PID from device ID (format: USB\VID_XXXX&PID_XXXX\...)
-            std::string vid, pid;
-            size_t vidPos = deviceIdStr.find("VID_");
-            size_t pidPos = deviceIdStr.find("PID_");
+            std::string_view deviceIdView(deviceIdUtf8, deviceIdLen - 1);
             
-            if (vidPos != std::string::npos && pidPos != std::string::npos) {
-                vid = deviceIdStr.substr(vidPos + 4, 4);
-                pid = deviceIdStr.substr(pidPos + 4, 4);
-            }
+            // Use device ID as name if friendly name is empty
+            std::string_view nameView = nameLen > 1
+                ? std::string_view(friendlyNameUtf8, nameLen - 1) : deviceIdView;
             
-            devices.emplace_back(deviceIdStr, friendlyNameStr, vid, pid);
+            // VID/PID and instance are parsed from the ID (USB\VID_XXXX&PID_XXXX\...)
+            devices.emplace_back(m_stringPool, deviceIdView, nameView);
         }
     }
     
     SetupDiDestroyDeviceInfoList(deviceInfoSet);
-    return devices;
 }
 
 UsbDevice UsbService::getDeviceInfo(const std::string& devicePath) {
@@ -12,27 +12,26 @@
 #endif
 
 #include "config.h"
+#include "usb_device.h"
+#include "device_index.h"
+#include "string_pool.h"
+#include "core/spsc_queue.h"
 #include <vector>
 #include <string>
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
 
-/**
- * Structure representing a USB device
- */
-struct UsbDevice {
-    std::string deviceId;
-    std::string friendlyName;
-    std::string vendorId;
-    std::string productId;
-    bool isConnected;
-    
-    UsbDevice() : isConnected(false) {}
-    
-    UsbDevice(const std::string& id, const std::string& name, 
-              const std::string& vid, const std::string& pid)
-        : deviceId(id), friendlyName(name), vendorId(vid), productId(pid), isConnected(true) {}
-};
+#ifdef PLATFORM_LINUX
+struct udev;
+struct udev_monitor;
+#endif
 
 /**
  * Service responsible for USB device detection and monitoring
@@ -40,6 +39,10 @@ struct UsbDevice {
 class UsbService {
 public:
     using DeviceCallback = std::function<void(const UsbDevice&)>;
+    using DeviceDeltaCallback = std::function<void(const DeviceDelta&)>;
+    using DeviceSnapshot = std::shared_ptr<const DeviceSet>;
+    using EventNotifier = std::function<void()>;
+    using WakeHintCallback = std::function<void(std::chrono::steady_clock::time_point hintedAt)>;
     
     UsbService();
     ~UsbService();
@@ -57,17 +60,33 @@ public:
 
     /**
      * Get all currently connected USB devices
+     * Served from the last published snapshot; see rescan() to force a fresh enumeration
      * @return vector of connected USB devices
      */
     std::vector<UsbDevice> getConnectedDevices();
 
     /**
      * Check if a specific device is connected
+     * Served from the last published snapshot, matched with the current policy
      * @param deviceId the device ID to check
      * @return true if connected, false otherwise
      */
     bool isDeviceConnected(const std::string& deviceId);
 
+    /**
+     * Get the last known device set without touching the hardware
+     * The snapshot is immutable and stays valid for as long as it is held,
+     * even if the monitor publishes a newer one in the meantime
+     * @return current snapshot, never null
+     */
+    DeviceSnapshot snapshot() const;
+
+    /**
+     * Enumerate the hardware now, publish the result and notify listeners of changes
+     * @return the freshly published snapshot
+     */
+    DeviceSnapshot rescan();
+
     /**
      * Set callback for device connection events
      * @param callback function to call when device is connected
@@ -80,6 +99,73 @@ public:
      */
     void setOnDeviceDisconnected(DeviceCallback callback);
 
+    /**
+     * Set callback receiving all changes of one detection pass at once
+     * Called before the per-device callbacks
+     * @param callback function to call with the added/removed devices
+     */
+    void setOnDevicesChanged(DeviceDeltaCallback callback);
+
+    /**
+     * Restrict change notifications to a single device
+     * While a device is watched, connect/disconnect callbacks fire for that
+     * device only. On Linux, events for other devices are then dismissed
+     * after a constant-time VID/PID check instead of triggering a full
+     * enumeration; the snapshot is refreshed by the next rescan().
+     * @param deviceId device ID to watch, empty to notify for all devices again
+     */
+    void watchDevice(const std::string& deviceId);
+
+    /**
+     * Set callback for early signs of the watched device coming back
+     * On Linux, the kernel announces a USB device to the netlink "kernel"
+     * group before udev has processed it and before the debounce window
+     * starts. The callback runs on the monitor thread, at most once per
+     * absence of the watched device, on the first kernel "add" for its model
+     * or for a device on its last known port chain (e.g. the hub of a KVM
+     * switch). A hint is not a confirmation: the regular connect callback
+     * still follows once the device has settled. Must be set before
+     * startMonitoring(); without it the kernel group is not subscribed.
+     * @param callback function to call with the time the hint arrived
+     */
+    void setOnWakeHint(WakeHintCallback callback);
+
+    /**
+     * Set how configured device IDs are matched against connected devices
+     * Applies to isDeviceConnected() and watchDevice()
+     * @param policy exact identity, model only or port only
+     */
+    void setMatchPolicy(DeviceMatchPolicy policy);
+    
+    DeviceMatchPolicy matchPolicy() const { return m_matchPolicy; }
+
+    /**
+     * Deliver callbacks on the caller's thread instead of the monitor thread
+     * Changes detected by the monitor thread are then queued and the notifier
+     * is invoked (from the monitor thread) when the queue goes from idle to
+     * pending; it must arrange for dispatchPendingEvents() to run on the
+     * thread that installed it. Must be set before startMonitoring().
+     * @param notifier wake-up function, e.g. posting to an event loop
+     */
+    void setEventNotifier(EventNotifier notifier);
+
+    /**
+     * Run the callbacks for all queued changes, in detection order
+     * Changes that did not fit in the queue are reported afterwards as one
+     * delta computed from the device sets around the overflowed changes.
+     * Must be called on the thread that installed the event notifier
+     */
+    void dispatchPendingEvents();
+
+#ifdef PLATFORM_LINUX
+    /**
+     * Enumerate a directory laid out like /sys/bus/usb/devices instead of
+     * querying udev, e.g. a synthetic tree in benchmarks and tests
+     * @param path device tree root, empty to restore the default
+     */
+    void setSysfsRoot(const std::string& path);
+#endif
+
     /**
      * Start monitoring for device changes
      * @return true if successful, false otherwise
@@ -99,8 +185,128 @@ private:
     void handleDeviceChange(int wParam, long lParam);  // Compatibility method
     void checkForDeviceChanges();  // Cross-platform device change detection
 #endif
+
+#ifdef PLATFORM_LINUX
+    /**
+     * How device changes are detected, chosen once in initialize()
+     */
+    enum class MonitorMode {
+        Netlink,  // udev netlink events, no periodic wakeups
+        Polling   // 1 second re-enumeration (containers without udevd)
+    };
+
+    bool openNetlinkMonitor();
+    void openKernelMonitor();   // only when a wake hint callback is set
+    void closeKernelMonitor();
+    void closeNetlinkMonitor();
+    void netlinkLoop();
+    bool watchedDeviceUnchanged();  // constant-time sysfs check for the polling fallback
+    void handleWatchedEvent(bool added, const UsbDevice& device, const std::string& syspath,
+                            unsigned long devnum, std::chrono::steady_clock::time_point receivedAt);
     
-    std::vector<UsbDevice> enumerateUsbDevices();
+    /**
+     * Check a kernel "add" uevent against the absent watched device
+     * @return true if it is the first hint of the device since it went away
+     */
+    bool claimWakeHint(const char* sysname, const char* product);
+
+    /**
+     * Attributes read for one syspath, reused while the kernel keeps the
+     * same device number on that port
+     */
+    struct CachedDeviceEntry {
+        UsbDevice device;
+        std::string syspath;
+        unsigned long devnum;
+        uint64_t generation;
+    };
+#endif
+    
+    /**
+     * Enumerate the devices, publish a new snapshot if the set changed and
+     * notify listeners of the difference
+     * Enumeration reuses a scratch buffer, so a pass that finds nothing new
+     * does not allocate.
+     * @param notify false to only prime the cache (no callbacks)
+     * @param detectedAt when the triggering kernel event arrived; defaults to now
+     */
+    void refreshDeviceSet(bool notify = true,
+                          std::chrono::steady_clock::time_point detectedAt = std::chrono::steady_clock::time_point());
+    
+    /**
+     * Hand one delta to the listeners: queued when raised on the monitor
+     * thread with a notifier installed, delivered directly otherwise
+     * @param after snapshot published with the delta, null for watch deltas
+     */
+    void dispatchDelta(const DeviceDelta& delta, const DeviceSnapshot& after = nullptr);
+    
+    /**
+     * Invoke the device callbacks for one delta on the current thread
+     */
+    void deliverDelta(const DeviceDelta& delta);
+    
+    /**
+     * Fold a delta that cannot be queued into the pending resync, starting
+     * one (and recording what listeners knew before) if none is pending.
+     * Called with m_resyncMutex held
+     */
+    void foldIntoResyncLocked(const DeviceDelta& delta, const DeviceSnapshot& after);
+    
+    /**
+     * Report everything folded into the resync as one delta, see
+     * foldIntoResyncLocked()
+     */
+    void resyncListeners();
+    
+    /**
+     * Mark the calling thread as the monitor thread, see dispatchDelta()
+     */
+    static void enterMonitorThread();
+    
+    /**
+     * Sleep until the next poll is due or monitoring is stopped
+     * @return true if monitoring is still active
+     */
+    bool waitForNextPoll();
+    
+    /**
+     * Stop the monitor thread and wait for it to exit
+     */
+    void joinMonitorThread();
+    
+    /**
+     * Record the presence of the watched device, notifying on transitions only
+     * @param present whether the watched device is attached
+     * @param device its record when present (ignored otherwise)
+     * @param detectedAt when the change was seen, stamped on the delta
+     */
+    void reportWatchedPresence(bool present, const UsbDevice& device,
+                               std::chrono::steady_clock::time_point detectedAt);
+    
+    bool isWatchActive();
+    
+    /**
+     * State of the device selected with watchDevice()
+     */
+    struct WatchState {
+        bool active = false;
+        std::string deviceId;
+        UsbDeviceKey key;
+        bool present = false;
+        UsbDevice device;           // last known record, reported on disconnect
+#ifdef PLATFORM_LINUX
+        std::string syspath;        // where the device is attached while present
+        unsigned long devnum = 0;
+        std::string lastSysname;    // port it was last seen on, e.g. "3-1.4.2"
+        bool hinted = false;        // wake hint already raised for this absence
+#endif
+    };
+    
+    /**
+     * Append the currently attached devices
+     * @param devices output buffer, cleared by the caller
+     */
+    void enumerateUsbDevices(std::vector<UsbDevice>& devices);
     UsbDevice getDeviceInfo(const std::string& devicePath);
     
 #ifdef _WIN32    
@@ -113,8 +319,59 @@ private:
     
     DeviceCallback m_onDeviceConnected;
     DeviceCallback m_onDeviceDisconnected;
-    std::vector<UsbDevice> m_cachedDevices;
-    bool m_isMonitoring;
+    DeviceDeltaCallback m_onDevicesChanged;
+    WakeHintCallback m_onWakeHint;
+    
+    // Last known device set, replaced as a whole (RCU-style) and read with
+    // std::atomic_load so readers never wait for an enumeration
+    DeviceSnapshot m_snapshot;
+    std::mutex m_cacheMutex;    // serialises enumeration and writers of m_snapshot
+    StringPool m_stringPool;    // device IDs and names referenced by UsbDevice
+    std::vector<UsbDevice> m_scanBuffer;
+    DeviceIndex m_scratchIndex;
+    DeviceDelta m_delta;
+    
+    std::mutex m_watchMutex;
+    WatchState m_watch;
+    std::atomic<bool> m_snapshotStale;  // events were dismissed by the watch filter
+    std::atomic<DeviceMatchPolicy> m_matchPolicy;
+    std::atomic<bool> m_isMonitoring;
+    
+    // Monitor thread, joined by stopMonitoring(); polling loops sleep on
+    // m_monitorWake so they stop without waiting out the interval
+    std::thread m_monitorThread;
+    std::mutex m_monitorMutex;
+    std::condition_variable m_monitorWake;
+    
+    // Changes detected on the monitor thread, drained by dispatchPendingEvents()
+    static constexpr size_t EVENT_QUEUE_CAPACITY = 256;
+    EventNotifier m_eventNotifier;
+    std::thread::id m_eventThread;      // thread that installed the notifier
+    SpscQueue<DeviceDelta> m_eventQueue;
+    std::atomic<bool> m_dispatchPending;
+    
+    // Set when the queue overflowed, until dispatchPendingEvents() catches
+    // up; the flag only changes under m_resyncMutex, which also covers the
+    // pushes onto m_eventQueue and the fields below
+    std::atomic<bool> m_resyncPending;
+    std::mutex m_resyncMutex;
+    DeviceSnapshot m_resyncBase;     // set listeners knew of, null if only watch deltas were folded
+    DeviceSnapshot m_resyncHead;     // set published with the last folded delta
+    bool m_resyncWatched;            // a watch delta was folded
+    bool m_resyncWatchedBefore;      // watched presence listeners knew of
+    UsbDevice m_resyncWatchedDevice; // watched device as of the last folded watch delta
+
+#ifdef PLATFORM_LINUX
+    MonitorMode m_monitorMode;
+    std::mutex m_udevMutex;     // libudev objects are not thread-safe; also guards the cache
+    struct udev* m_udev;        // owned for the lifetime of the service
+    struct udev_monitor* m_udevMonitor;
+    struct udev_monitor* m_kernelMonitor;   // raw kernel uevents, for wake hints only
+    int m_wakeFd;               // eventfd used to interrupt the netlink loop
+    std::unordered_map<uint64_t, CachedDeviceEntry> m_attributeCache;  // keyed on syspath hash
+    uint64_t m_scanGeneration;
+    std::string m_sysfsRoot;    // overrides udev enumeration when set
+#endif
 };
 
 #endif // USB_SERVICE_H
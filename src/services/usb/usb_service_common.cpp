@@ -0,0 +1,330 @@
+#include "usb_service.h"
+#include "core/logger.h"
+
+// Platform-independent parts of UsbService, shared by all backends
+
+namespace {
+
+// Set on the thread running the platform monitor loop
+thread_local bool t_isMonitorThread = false;
+
+// The set a delta started from, rebuilt from the set published with it
+std::shared_ptr<DeviceSet> undoDelta(const DeviceSet& after, const DeviceDelta& delta) {
+    DeviceIndex addedIndex;
+    addedIndex.rebuild(delta.added);
+    
+    auto before = std::make_shared<DeviceSet>();
+    for (const auto& device : after.devices) {
+        if (addedIndex.find(delta.added, device) == DeviceIndex::npos) {
+            before->devices.push_back(device);
+        }
+    }
+    for (const auto& device : delta.removed) {
+        before->devices.push_back(device);
+        before->devices.back().isConnected = true;
+    }
+    before->index.rebuild(before->devices);
+    return before;
+}
+
+} // namespace
+
+std::vector<UsbDevice> UsbService::getConnectedDevices() {
+    // Nothing published yet when monitoring has not been started, or the
+    // watch filter dismissed events since the last scan
+    if (!std::atomic_load(&m_snapshot) || m_snapshotStale) {
+        return rescan()->devices;
+    }
+    return snapshot()->devices;
+}
+
+bool UsbService::isDeviceConnected(const std::string& deviceId) {
+    DeviceSnapshot current = std::atomic_load(&m_snapshot);
+    if (!current || m_snapshotStale) {
+        current = rescan();
+    }
+    return current->findMatch(parseDeviceKey(deviceId), m_matchPolicy) != nullptr;
+}
+
+UsbService::DeviceSnapshot UsbService::snapshot() const {
+    DeviceSnapshot current = std::atomic_load(&m_snapshot);
+    if (!current) {
+        static const DeviceSnapshot empty = std::make_shared<const DeviceSet>();
+        return empty;
+    }
+    return current;
+}
+
+UsbService::DeviceSnapshot UsbService::rescan() {
+    m_snapshotStale = false;
+    refreshDeviceSet();
+    return snapshot();
+}
+
+void UsbService::watchDevice(const std::string& deviceId) {
+    const bool present = !deviceId.empty() && isDeviceConnected(deviceId);
+    const UsbDeviceKey key = parseDeviceKey(deviceId);
+    DeviceSnapshot current = snapshot();
+    
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    m_watch = WatchState();
+    if (deviceId.empty()) {
+        return;
+    }
+    
+    m_watch.active = true;
+    m_watch.deviceId = deviceId;
+    m_watch.key = key;
+    m_watch.present = present;
+    if (const UsbDevice* device = current->findMatch(key, m_matchPolicy)) {
+        m_watch.device = *device;
+    }
+}
+
+void UsbService::setMatchPolicy(DeviceMatchPolicy policy) {
+    m_matchPolicy = policy;
+}
+
+bool UsbService::isWatchActive() {
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    return m_watch.active;
+}
+
+void UsbService::reportWatchedPresence(bool present, const UsbDevice& device,
+                                       std::chrono::steady_clock::time_point detectedAt) {
+    DeviceDelta delta;
+    delta.detectedAt = detectedAt;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_watchMutex);
+        if (!m_watch.active || m_watch.present == present) {
+            return;
+        }
+        
+        m_watch.present = present;
+        if (present) {
+            m_watch.device = device;
+        }
+        
+        UsbDevice reported = m_watch.device;
+        reported.isConnected = present;
+        (present ? delta.added : delta.removed).push_back(reported);
+    }
+    
+    dispatchDelta(delta);
+}
+
+void UsbService::setOnDevicesChanged(DeviceDeltaCallback callback) {
+    m_onDevicesChanged = callback;
+}
+
+void UsbService::setOnWakeHint(WakeHintCallback callback) {
+    m_onWakeHint = callback;
+}
+
+void UsbService::refreshDeviceSet(bool notify, std::chrono::steady_clock::time_point detectedAt) {
+    // Latency is measured from the kernel event, not from the end of the scan
+    if (detectedAt == std::chrono::steady_clock::time_point()) {
+        detectedAt = std::chrono::steady_clock::now();
+    }
+    
+    DeviceDelta delta;
+    DeviceSnapshot published;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        
+        // Scratch buffers keep their capacity between passes
+        m_scanBuffer.clear();
+        enumerateUsbDevices(m_scanBuffer);
+        
+        DeviceSnapshot current = std::atomic_load(&m_snapshot);
+        m_scratchIndex.rebuild(m_scanBuffer);
+        
+        if (current && notify) {
+            computeDeviceDelta(current->devices, current->index, m_scanBuffer, m_scratchIndex, m_delta);
+            if (m_delta.empty()) {
+                return; // Nothing changed, keep serving the current snapshot
+            }
+        } else {
+            m_delta.clear();
+        }
+        
+        // Publish a copy of the changed set (records are fixed-size, strings
+        // stay in the pool); the previous snapshot is released once its last
+        // reader drops it
+        auto next = std::make_shared<DeviceSet>();
+        next->devices = m_scanBuffer;
+        next->index.swap(m_scratchIndex);
+        published = std::move(next);
+        std::atomic_store(&m_snapshot, published);
+        
+        if (m_delta.empty()) {
+            return;
+        }
+        delta = m_delta;
+        delta.detectedAt = detectedAt;
+    }
+    
+    // With a watch active only the watched device is reported, and only
+    // when its presence actually changes
+    bool watching = false;
+    UsbDeviceKey watchedKey;
+    {
+        std::lock_guard<std::mutex> lock(m_watchMutex);
+        watching = m_watch.active;
+        watchedKey = m_watch.key;
+    }
+    if (watching) {
+        DeviceSnapshot current = snapshot();
+        const UsbDevice* watched = current->findMatch(watchedKey, m_matchPolicy);
+        reportWatchedPresence(watched != nullptr, watched ? *watched : UsbDevice(), detectedAt);
+        return;
+    }
+    
+    dispatchDelta(delta, published);
+}
+
+void UsbService::setEventNotifier(EventNotifier notifier) {
+    m_eventNotifier = notifier;
+    m_eventThread = std::this_thread::get_id();
+}
+
+void UsbService::dispatchPendingEvents() {
+    // Cleared before draining: a delta pushed after this point either gets
+    // popped below or re-arms the notifier
+    m_dispatchPending = false;
+    
+    DeviceDelta delta;
+    while (m_eventQueue.tryPop(delta)) {
+        deliverDelta(delta);
+    }
+    
+    if (m_resyncPending) {
+        resyncListeners();
+    }
+}
+
+void UsbService::foldIntoResyncLocked(const DeviceDelta& delta, const DeviceSnapshot& after) {
+    if (!m_resyncPending) {
+        LOG_WARNING("USB", "Event queue full, listeners will be resynchronised from the device snapshot");
+        m_resyncBase = nullptr;
+        m_resyncHead = nullptr;
+        m_resyncWatched = false;
+        m_resyncPending = true;
+    }
+    
+    if (after) {
+        if (!m_resyncBase) {
+            m_resyncBase = undoDelta(*after, delta);
+        }
+        m_resyncHead = after;
+    } else {
+        // Watch deltas carry the watched device alone, added or removed
+        if (!m_resyncWatched) {
+            m_resyncWatched = true;
+            m_resyncWatchedBefore = delta.added.empty();
+        }
+        m_resyncWatchedDevice = delta.added.empty() ? delta.removed.front() : delta.added.front();
+    }
+}
+
+void UsbService::resyncListeners() {
+    // Nothing is queued while a resync is pending, so once these are out the
+    // resync delta comes last, in detection order
+    DeviceDelta delta;
+    while (m_eventQueue.tryPop(delta)) {
+        deliverDelta(delta);
+    }
+    
+    // Computed from what was folded in, not from the live snapshot: a delta
+    // published meanwhile is queued after the flag clears and counted once
+    delta.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_resyncMutex);
+        if (m_resyncBase) {
+            computeDeviceDelta(m_resyncBase->devices, m_resyncBase->index,
+                               m_resyncHead->devices, m_resyncHead->index, delta);
+        }
+        if (m_resyncWatched && m_resyncWatchedDevice.isConnected != m_resyncWatchedBefore) {
+            (m_resyncWatchedDevice.isConnected ? delta.added : delta.removed).push_back(m_resyncWatchedDevice);
+        }
+        
+        m_resyncBase = nullptr;
+        m_resyncHead = nullptr;
+        m_resyncWatched = false;
+        m_resyncPending = false;
+    }
+    
+    if (!delta.empty()) {
+        delta.detectedAt = std::chrono::steady_clock::now();
+        deliverDelta(delta);
+    }
+}
+
+void UsbService::enterMonitorThread() {
+    t_isMonitorThread = true;
+}
+
+bool UsbService::waitForNextPoll() {
+    std::unique_lock<std::mutex> lock(m_monitorMutex);
+    m_monitorWake.wait_for(lock, std::chrono::seconds(1), [this]() { return !m_isMonitoring; });
+    return m_isMonitoring;
+}
+
+void UsbService::joinMonitorThread() {
+    {
+        std::lock_guard<std::mutex> lock(m_monitorMutex);
+        m_isMonitoring = false;
+    }
+    m_monitorWake.notify_all();
+    
+    if (m_monitorThread.joinable()) {
+        m_monitorThread.join();
+    }
+}
+
+void UsbService::dispatchDelta(const DeviceDelta& delta, const DeviceSnapshot& after) {
+    if (t_isMonitorThread && m_eventNotifier) {
+        {
+            // Once the receiving thread fell behind, later deltas join the
+            // pending resync too so that nothing overtakes it; the flag is
+            // tested and the delta queued or folded in one critical section
+            std::lock_guard<std::mutex> lock(m_resyncMutex);
+            DeviceDelta queued = delta;
+            if (m_resyncPending || !m_eventQueue.tryPush(std::move(queued))) {
+                foldIntoResyncLocked(delta, after);
+            }
+        }
+        if (!m_dispatchPending.exchange(true)) {
+            m_eventNotifier();
+        }
+        return;
+    }
+    
+    // Keep detection order when a rescan on the receiving thread overtakes
+    // monitor events that are still queued
+    if (m_eventNotifier && std::this_thread::get_id() == m_eventThread) {
+        dispatchPendingEvents();
+    }
+    deliverDelta(delta);
+}
+
+void UsbService::deliverDelta(const DeviceDelta& delta) {
+    // Listeners run outside the locks so they may read snapshots or rescan
+    if (m_onDevicesChanged) {
+        m_onDevicesChanged(delta);
+    }
+    
+    if (m_onDeviceConnected) {
+        for (const auto& device : delta.added) {
+            m_onDeviceConnected(device);
+        }
+    }
+    
+    if (m_onDeviceDisconnected) {
+        for (const auto& device : delta.removed) {
+            m_onDeviceDisconnected(device);
+        }
+    }
+}
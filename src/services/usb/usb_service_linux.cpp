@@ -1,17 +1,192 @@
 #include "usb_service.h"
-#include <iostream>
+#include "core/logger.h"
 #include <thread>
 #include <algorithm>
-#include <fstream>
-#include <sstream>
+#include <cstring>
 
 #ifdef PLATFORM_LINUX
 #include <libudev.h>
 #include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <climits>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#ifdef PLATFORM_LINUX
+namespace {
+
+/**
+ * Read a small sysfs attribute into a caller-provided buffer, trailing newline stripped
+ * @return true if the attribute exists and is non-empty
+ */
+bool readSysfsAttribute(const char* devicePath, const char* name, char* buffer, size_t size) {
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", devicePath, name) >= static_cast<int>(sizeof(path))) {
+        return false;
+    }
+    
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    
+    ssize_t length = read(fd, buffer, size - 1);
+    close(fd);
+    if (length <= 0) {
+        return false;
+    }
+    
+    while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == '\r')) {
+        --length;
+    }
+    buffer[length] = '\0';
+    return length > 0;
+}
+
+/**
+ * Format the display name into a caller-provided buffer
+ * @return view of the name inside buffer
+ */
+std::string_view makeFriendlyName(const char* manufacturer, const char* product, char* buffer, size_t size) {
+    int length;
+    if (manufacturer && product) {
+        length = snprintf(buffer, size, "%s %s", manufacturer, product);
+    } else if (product) {
+        length = snprintf(buffer, size, "%s", product);
+    } else {
+        length = snprintf(buffer, size, "Unknown USB Device");
+    }
+    return std::string_view(buffer, std::min(static_cast<size_t>(length), size - 1));
+}
+
+/**
+ * Decode the bus/port chain from a USB device sysname
+ * ("3-1.4.2" is bus 3, ports 1 then 4 then 2; root hubs are "usb3")
+ * @return packed port path, 0 if the name is not a USB device name
+ */
+uint64_t portPathFromSysname(const char* sysname) {
+    if (!sysname) {
+        return 0;
+    }
+    if (strncmp(sysname, "usb", 3) == 0) {
+        return packPortPath(strtoul(sysname + 3, nullptr, 10), nullptr, 0);
+    }
+    
+    char* end = nullptr;
+    unsigned bus = strtoul(sysname, &end, 10);
+    if (end == sysname || *end != '-') {
+        return 0;
+    }
+    
+    unsigned ports[7];
+    size_t count = 0;
+    const char* cursor = end + 1;
+    while (count < 7) {
+        ports[count++] = strtoul(cursor, &end, 10);
+        if (*end != '.') {
+            break;
+        }
+        cursor = end + 1;
+    }
+    return packPortPath(bus, ports, count);
+}
+
+/**
+ * Build a device record from raw attribute values
+ * @return record with isConnected false if VID/PID are missing
+ */
+UsbDevice makeDevice(StringPool& pool, const char* vid, const char* pid, const char* serial,
+                     const char* sysname, const char* manufacturer, const char* product) {
+    if (!vid || !pid) {
+        return UsbDevice();
+    }
+    
+    UsbDeviceKey key;
+    key.vendorId = static_cast<uint16_t>(strtoul(vid, nullptr, 16));
+    key.productId = static_cast<uint16_t>(strtoul(pid, nullptr, 16));
+    key.serialHash = serial ? hashSerial(serial, strlen(serial)) : 0;
+    key.portPath = portPathFromSysname(sysname);
+    
+    char deviceId[64];
+    char name[512];
+    return UsbDevice(pool, std::string_view(deviceId, formatDeviceId(key, deviceId, sizeof(deviceId))),
+                     makeFriendlyName(manufacturer, product, name, sizeof(name)));
+}
+
+/**
+ * Build a device record from the sysattrs of a udev device
+ * @return record with isConnected false if the node has no VID/PID
+ */
+UsbDevice makeDeviceFromUdev(StringPool& pool, struct udev_device* dev) {
+    return makeDevice(pool,
+                      udev_device_get_sysattr_value(dev, "idVendor"),
+                      udev_device_get_sysattr_value(dev, "idProduct"),
+                      udev_device_get_sysattr_value(dev, "serial"),
+                      udev_device_get_sysname(dev),
+                      udev_device_get_sysattr_value(dev, "manufacturer"),
+                      udev_device_get_sysattr_value(dev, "product"));
+}
+
+/**
+ * Parse the PRODUCT uevent property ("46d/c52b/1201"), present on add and remove
+ */
+bool parseProductProperty(const char* product, uint16_t& vendorId, uint16_t& productId) {
+    if (!product) {
+        return false;
+    }
+    
+    char* end = nullptr;
+    vendorId = static_cast<uint16_t>(strtoul(product, &end, 16));
+    if (!end || *end != '/') {
+        return false;
+    }
+    productId = static_cast<uint16_t>(strtoul(end + 1, nullptr, 16));
+    return true;
+}
+
+/**
+ * Check whether a device sits on the port chain leading to another one
+ * ("3-1.4" and "3-1" lead to "3-1.4.2", as does "3-1.4.2" itself)
+ */
+bool isOnPortChain(const std::string& target, const char* sysname) {
+    if (!sysname || target.empty() || strncmp(sysname, "usb", 3) == 0) {
+        return false;
+    }
+    size_t length = strlen(sysname);
+    return target.compare(0, length, sysname) == 0
+        && (target.size() == length || target[length] == '.');
+}
+
+/**
+ * Last component of a sysfs path
+ */
+std::string sysnameOf(const std::string& syspath) {
+    size_t slash = syspath.rfind('/');
+    return slash == std::string::npos ? syspath : syspath.substr(slash + 1);
+}
+
+/**
+ * Event for the watched device, collected under the udev lock and handled after it
+ */
+struct WatchedEvent {
+    bool added;
+    UsbDevice device;
+    std::string syspath;
+    unsigned long devnum;
+};
+
+} // namespace
 #endif
 
 UsbService::UsbService() 
-    : m_hiddenWindow(nullptr), m_deviceNotification(nullptr), m_isMonitoring(false) {
+    : m_hiddenWindow(nullptr), m_deviceNotification(nullptr), m_snapshotStale(false),
+      m_matchPolicy(DeviceMatchPolicy::Exact), m_isMonitoring(false),
+      m_eventQueue(EVENT_QUEUE_CAPACITY), m_dispatchPending(false),
+      m_resyncPending(false), m_resyncWatched(false), m_resyncWatchedBefore(false),
+      m_monitorMode(MonitorMode::Polling), m_udev(nullptr), m_udevMonitor(nullptr), m_kernelMonitor(nullptr), m_wakeFd(-1),
+      m_scanGeneration(0) {
 }
 
 UsbService::~UsbService() {
@@ -20,33 +195,42 @@ UsbService::~UsbService() {
 
 bool UsbService::initialize() {
 #ifdef PLATFORM_LINUX
+    // One udev context for the lifetime of the service, shared by enumeration
+    // and the netlink monitor; without it enumeration reads sysfs directly
+    if (!m_udev) {
+        m_udev = udev_new();
+    }
+    
+    // Prefer kernel/udev events; fall back to polling when netlink is unusable
+    // (typically inside containers where udevd is not running)
+    if (openNetlinkMonitor()) {
+        m_monitorMode = MonitorMode::Netlink;
+        LOG_INFO("USB", "Using udev netlink monitor for device events");
+    } else {
+        m_monitorMode = MonitorMode::Polling;
+        LOG_INFO("USB", "udev netlink unavailable, falling back to 1s polling");
+    }
     return true; // Initialization successful
 #else
-    std::cout << "USB service not implemented for this platform" << std::endl;
+    LOG_INFO("USB", "USB service not implemented for this platform");
     return false;
 #endif
 }
 
 void UsbService::shutdown() {
     stopMonitoring();
-}
-
-std::vector<UsbDevice> UsbService::getConnectedDevices() {
 #ifdef PLATFORM_LINUX
-    return enumerateUsbDevices();
-#else
-    return std::vector<UsbDevice>();
+    closeNetlinkMonitor();
+    
+    std::lock_guard<std::mutex> lock(m_udevMutex);
+    m_attributeCache.clear();
+    if (m_udev) {
+        udev_unref(m_udev);
+        m_udev = nullptr;
+    }
 #endif
 }
 
-bool UsbService::isDeviceConnected(const std::string& deviceId) {
-    auto devices = getConnectedDevices();
-    return std::any_of(devices.begin(), devices.end(),
-        [&deviceId](const UsbDevice& device) {
-            return device.deviceId == deviceId;
-        });
-}
-
 void UsbService::setOnDeviceConnected(DeviceCallback callback) {
     m_onDeviceConnected = callback;
 }
@@ -62,17 +246,27 @@ bool UsbService::startMonitoring() {
     
 #ifdef PLATFORM_LINUX
     m_isMonitoring = true;
-    m_cachedDevices = getConnectedDevices();
+    refreshDeviceSet(false);
+    
+    if (m_monitorMode == MonitorMode::Netlink) {
+        if (m_onWakeHint) {
+            openKernelMonitor();
+        }
+        
+        // Block on the monitor socket; the thread only wakes up for real events
+        m_monitorThread = std::thread(&UsbService::netlinkLoop, this);
+        return true;
+    }
     
-    // Start a polling thread for device changes
-    std::thread([this]() {
-        while (m_isMonitoring) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            if (m_isMonitoring) {
+    // Start a polling thread for device changes, joined by stopMonitoring()
+    m_monitorThread = std::thread([this]() {
+        enterMonitorThread();
+        while (waitForNextPoll()) {
+            if (!watchedDeviceUnchanged()) {
                 checkForDeviceChanges();
             }
         }
-    }).detach();
+    });
     
     return true;
 #else
@@ -82,134 +276,444 @@ bool UsbService::startMonitoring() {
 
 void UsbService::stopMonitoring() {
     m_isMonitoring = false;
+    
+#ifdef PLATFORM_LINUX
+    if (m_monitorThread.joinable() && m_wakeFd >= 0) {
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            LOG_WARNING("USB", "Failed to wake netlink monitor thread");
+        }
+    }
+    joinMonitorThread();
+    closeKernelMonitor();
+#else
+    joinMonitorThread();
+#endif
 }
 
-void UsbService::handleDeviceChange(int wParam, long lParam) {
-    // This method is Windows-specific, kept for compatibility
-    checkForDeviceChanges();
+#ifdef PLATFORM_LINUX
+bool UsbService::openNetlinkMonitor() {
+    // Without a running udevd the "udev" netlink group never receives anything,
+    // so an apparently successful monitor would silently miss every event
+    if (access("/run/udev/control", F_OK) != 0) {
+        return false;
+    }
+    
+    if (!m_udev) {
+        return false;
+    }
+    
+    m_udevMonitor = udev_monitor_new_from_netlink(m_udev, "udev");
+    if (!m_udevMonitor
+        || udev_monitor_filter_add_match_subsystem_devtype(m_udevMonitor, "usb", "usb_device") < 0
+        || udev_monitor_enable_receiving(m_udevMonitor) < 0) {
+        closeNetlinkMonitor();
+        return false;
+    }
+    
+    m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_wakeFd < 0) {
+        closeNetlinkMonitor();
+        return false;
+    }
+    
+    return true;
 }
 
-void UsbService::checkForDeviceChanges() {
-    auto currentDevices = getConnectedDevices();
-    
-    // Check for newly connected devices
-    for (const auto& device : currentDevices) {
-        auto it = std::find_if(m_cachedDevices.begin(), m_cachedDevices.end(),
-            [&device](const UsbDevice& cached) {
-                return cached.deviceId == device.deviceId;
-            });
-        
-        if (it == m_cachedDevices.end() && m_onDeviceConnected) {
-            m_onDeviceConnected(device);
-        }
+void UsbService::openKernelMonitor() {
+    if (m_kernelMonitor) {
+        return;
     }
     
-    // Check for disconnected devices
-    for (const auto& cached : m_cachedDevices) {
-        auto it = std::find_if(currentDevices.begin(), currentDevices.end(),
-            [&cached](const UsbDevice& device) {
-                return device.deviceId == cached.deviceId;
-            });
-        
-        if (it == currentDevices.end() && m_onDeviceDisconnected) {
-            UsbDevice disconnected = cached;
-            disconnected.isConnected = false;
-            m_onDeviceDisconnected(disconnected);
-        }
+    // Raw kernel uevents come before udev has run its rules; they only feed
+    // wake hints, so the monitor works without them. Every USB event in the
+    // system wakes this socket, hence it is only opened for a hint listener
+    m_kernelMonitor = udev_monitor_new_from_netlink(m_udev, "kernel");
+    if (m_kernelMonitor
+        && (udev_monitor_filter_add_match_subsystem_devtype(m_kernelMonitor, "usb", "usb_device") < 0
+            || udev_monitor_enable_receiving(m_kernelMonitor) < 0)) {
+        closeKernelMonitor();
+    }
+}
+
+void UsbService::closeKernelMonitor() {
+    if (m_kernelMonitor) {
+        udev_monitor_unref(m_kernelMonitor);
+        m_kernelMonitor = nullptr;
+    }
+}
+
+void UsbService::closeNetlinkMonitor() {
+    if (m_udevMonitor) {
+        udev_monitor_unref(m_udevMonitor);
+        m_udevMonitor = nullptr;
+    }
+    closeKernelMonitor();
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
     }
-    
-    m_cachedDevices = currentDevices;
 }
 
-std::vector<UsbDevice> UsbService::enumerateUsbDevices() {
-    std::vector<UsbDevice> devices;
+void UsbService::netlinkLoop() {
+    enterMonitorThread();
     
-#ifdef PLATFORM_LINUX
-    // Method 1: Use udev library (preferred)
-    struct udev* udev = udev_new();
-    if (udev) {
-        struct udev_enumerate* enumerate = udev_enumerate_new(udev);
-        udev_enumerate_add_match_subsystem(enumerate, "usb");
-        udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
-        udev_enumerate_scan_devices(enumerate);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        LOG_ERROR("USB", "epoll_create1 failed: " << strerror(errno));
+        return;
+    }
+    
+    const int monitorFd = udev_monitor_get_fd(m_udevMonitor);
+    const int kernelFd = m_kernelMonitor && m_onWakeHint ? udev_monitor_get_fd(m_kernelMonitor) : -1;
+    
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = monitorFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, monitorFd, &ev);
+    ev.data.fd = m_wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+    if (kernelFd >= 0) {
+        ev.data.fd = kernelFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, kernelFd, &ev);
+    }
+    
+    struct epoll_event events[3];
+    while (m_isMonitoring) {
+        int count = epoll_wait(epollFd, events, 3, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("USB", "epoll_wait failed: " << strerror(errno));
+            break;
+        }
         
-        struct udev_list_entry* dev_list_entry;
-        udev_list_entry_foreach(dev_list_entry, udev_enumerate_get_list_entry(enumerate)) {
-            const char* path = udev_list_entry_get_name(dev_list_entry);
-            struct udev_device* dev = udev_device_new_from_syspath(udev, path);
+        // Every stage of the switching latency is measured from here
+        const auto receivedAt = std::chrono::steady_clock::now();
+        bool changed = false;
+        bool wakeHint = false;
+        std::vector<WatchedEvent> watchedEvents;
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == kernelFd) {
+                // Only looked at for the absent watched device; udev reports
+                // the same devices again once they are ready
+                std::lock_guard<std::mutex> lock(m_udevMutex);
+                struct udev_device* dev;
+                while ((dev = udev_monitor_receive_device(m_kernelMonitor)) != nullptr) {
+                    const char* action = udev_device_get_action(dev);
+                    if (!wakeHint && action && strcmp(action, "add") == 0) {
+                        wakeHint = claimWakeHint(udev_device_get_sysname(dev),
+                                                 udev_device_get_property_value(dev, "PRODUCT"));
+                    }
+                    udev_device_unref(dev);
+                }
+                continue;
+            }
+            if (events[i].data.fd != monitorFd) {
+                // Wake-up request from stopMonitoring(); reset the counter so
+                // a later startMonitoring() does not see it again
+                uint64_t value;
+                if (read(m_wakeFd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    LOG_WARNING("USB", "Failed to reset wake event: " << strerror(errno));
+                }
+                continue;
+            }
+            
+            UsbDeviceKey watchedKey;
+            bool watching = false;
+            {
+                std::lock_guard<std::mutex> watchLock(m_watchMutex);
+                watching = m_watch.active;
+                watchedKey = m_watch.key;
+            }
+            const DeviceMatchPolicy policy = m_matchPolicy;
             
-            if (dev) {
-                const char* vid = udev_device_get_sysattr_value(dev, "idVendor");
-                const char* pid = udev_device_get_sysattr_value(dev, "idProduct");
-                const char* product = udev_device_get_sysattr_value(dev, "product");
-                const char* manufacturer = udev_device_get_sysattr_value(dev, "manufacturer");
+            // Drain everything queued on the socket so a burst of hub events
+            // results in a single re-enumeration
+            std::lock_guard<std::mutex> lock(m_udevMutex);
+            struct udev_device* dev;
+            while ((dev = udev_monitor_receive_device(m_udevMonitor)) != nullptr) {
+                const char* action = udev_device_get_action(dev);
+                const bool added = action && strcmp(action, "add") == 0;
+                const bool removed = action && strcmp(action, "remove") == 0;
                 
-                if (vid && pid) {
-                    std::string deviceId = "USB_VID_" + std::string(vid) + "&PID_" + std::string(pid);
-                    
-                    std::string friendlyName;
-                    if (manufacturer && product) {
-                        friendlyName = std::string(manufacturer) + " " + std::string(product);
-                    } else if (product) {
-                        friendlyName = std::string(product);
+                if (added || removed) {
+                    if (!watching) {
+                        changed = true;
                     } else {
-                        friendlyName = "Unknown USB Device";
+                        // Targeted mode: one property lookup per event, whatever
+                        // the number of devices on the bus
+                        UsbDeviceKey eventKey;
+                        UsbDevice device;
+                        bool matches = parseProductProperty(udev_device_get_property_value(dev, "PRODUCT"),
+                                                            eventKey.vendorId, eventKey.productId)
+                            && eventKey.vendorId == watchedKey.vendorId
+                            && eventKey.productId == watchedKey.productId;
+                        
+                        // Same model: tell identical devices apart by serial and port
+                        if (matches && added) {
+                            device = makeDeviceFromUdev(m_stringPool, dev);
+                            matches = matchDeviceKey(watchedKey, device.key, policy);
+                        } else if (matches) {
+                            // Sysattrs are gone on removal, only the port is known
+                            UsbDeviceKey selector = watchedKey;
+                            selector.serialHash = 0;
+                            eventKey.portPath = portPathFromSysname(udev_device_get_sysname(dev));
+                            matches = matchDeviceKey(selector, eventKey, policy);
+                        }
+                        
+                        if (matches) {
+                            const char* devnum = udev_device_get_property_value(dev, "DEVNUM");
+                            watchedEvents.push_back(WatchedEvent{
+                                added,
+                                std::move(device),
+                                udev_device_get_syspath(dev),
+                                devnum ? strtoul(devnum, nullptr, 10) : 0
+                            });
+                        } else {
+                            m_snapshotStale = true;
+                        }
                     }
-                    
-                    devices.emplace_back(deviceId, friendlyName, std::string(vid), std::string(pid));
                 }
-                
                 udev_device_unref(dev);
             }
         }
         
-        udev_enumerate_unref(enumerate);
-        udev_unref(udev);
+        // Before the udev events of the same wakeup: they are the later signal
+        if (wakeHint) {
+            m_onWakeHint(receivedAt);
+        }
+        
+        for (const auto& event : watchedEvents) {
+            handleWatchedEvent(event.added, event.device, event.syspath, event.devnum, receivedAt);
+        }
+        
+        if (changed && m_isMonitoring) {
+            refreshDeviceSet(true, receivedAt);
+        }
+    }
+    
+    close(epollFd);
+}
+
+void UsbService::setSysfsRoot(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_udevMutex);
+    m_sysfsRoot = path;
+    m_attributeCache.clear();
+}
+
+void UsbService::handleWatchedEvent(bool added, const UsbDevice& device, const std::string& syspath,
+                                    unsigned long devnum, std::chrono::steady_clock::time_point receivedAt) {
+    {
+        std::lock_guard<std::mutex> lock(m_watchMutex);
+        if (added) {
+            m_watch.syspath = syspath;
+            m_watch.devnum = devnum;
+        } else if (!m_watch.syspath.empty() && m_watch.syspath != syspath) {
+            return; // An identical device on another port went away
+        } else {
+            m_watch.syspath.clear();
+            m_watch.lastSysname = sysnameOf(syspath);
+            m_watch.hinted = false;
+        }
+    }
+    
+    // The published snapshot no longer matches the bus
+    m_snapshotStale = true;
+    
+    if (added && device.isConnected) {
+        reportWatchedPresence(true, device, receivedAt);
+    } else if (!added) {
+        reportWatchedPresence(false, UsbDevice(), receivedAt);
+    }
+}
+
+bool UsbService::claimWakeHint(const char* sysname, const char* product) {
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    if (!m_watch.active || m_watch.present || m_watch.hinted) {
+        return false;
+    }
+    
+    // The device itself, or a hub in front of it enumerating first
+    UsbDeviceKey eventKey;
+    bool matches = isOnPortChain(m_watch.lastSysname, sysname);
+    if (!matches && m_matchPolicy == DeviceMatchPolicy::PortOnly) {
+        matches = m_watch.key.portPath != 0 && portPathFromSysname(sysname) == m_watch.key.portPath;
+    } else if (!matches && parseProductProperty(product, eventKey.vendorId, eventKey.productId)) {
+        matches = eventKey.vendorId == m_watch.key.vendorId && eventKey.productId == m_watch.key.productId;
+    }
+    
+    m_watch.hinted = matches;
+    return matches;
+}
+
+bool UsbService::watchedDeviceUnchanged() {
+    std::string syspath;
+    unsigned long devnum = 0;
+    UsbDeviceKey key;
+    {
+        std::lock_guard<std::mutex> lock(m_watchMutex);
+        if (!m_watch.active || !m_watch.present) {
+            return false; // Not watching, or waiting for it to appear anywhere: full scan
+        }
+        syspath = m_watch.syspath;
+        devnum = m_watch.devnum;
+        key = m_watch.key;
+    }
+    
+    if (syspath.empty()) {
+        // Locate the port once from the attribute cache of the last scan
+        const DeviceMatchPolicy policy = m_matchPolicy;
+        std::lock_guard<std::mutex> lock(m_udevMutex);
+        for (const auto& entry : m_attributeCache) {
+            if (matchDeviceKey(key, entry.second.device.key, policy)) {
+                syspath = entry.second.syspath;
+                devnum = entry.second.devnum;
+                break;
+            }
+        }
+        if (syspath.empty()) {
+            return false;
+        }
+        
+        std::lock_guard<std::mutex> watchLock(m_watchMutex);
+        m_watch.syspath = syspath;
+        m_watch.devnum = devnum;
+    }
+    
+    // Same device number on the same port: still the same attachment
+    char devnumBuffer[16];
+    if (readSysfsAttribute(syspath.c_str(), "devnum", devnumBuffer, sizeof(devnumBuffer))
+        && strtoul(devnumBuffer, nullptr, 10) == devnum) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> watchLock(m_watchMutex);
+    m_watch.syspath.clear();
+    return false;
+}
+#endif
+
+void UsbService::handleDeviceChange(int wParam, long lParam) {
+    // This method is Windows-specific, kept for compatibility
+    checkForDeviceChanges();
+}
+
+void UsbService::checkForDeviceChanges() {
+    // Hashed O(n) diff against the cached set, see refreshDeviceSet()
+    refreshDeviceSet();
+}
+
+void UsbService::enumerateUsbDevices(std::vector<UsbDevice>& devices) {
+#ifdef PLATFORM_LINUX
+    std::lock_guard<std::mutex> lock(m_udevMutex);
+    const uint64_t generation = ++m_scanGeneration;
+    
+    // Serve a syspath from the cache while its devnum is unchanged; the kernel
+    // assigns a new number whenever a device (re)attaches to that port
+    auto collect = [this, &devices, generation](const char* syspath) {
+        char devnumBuffer[16];
+        if (!readSysfsAttribute(syspath, "devnum", devnumBuffer, sizeof(devnumBuffer))) {
+            return;
+        }
+        unsigned long devnum = strtoul(devnumBuffer, nullptr, 10);
+        
+        const uint64_t key = hashIdentity(syspath, strlen(syspath));
+        auto it = m_attributeCache.find(key);
+        if (it == m_attributeCache.end() || it->second.devnum != devnum) {
+            UsbDevice device = getDeviceInfo(syspath);
+            if (!device.isConnected) {
+                return;
+            }
+            it = m_attributeCache.insert_or_assign(key, CachedDeviceEntry{std::move(device), syspath, devnum, 0}).first;
+        }
+        
+        it->second.generation = generation;
+        devices.push_back(it->second.device);
+    };
+    
+    if (m_udev && m_sysfsRoot.empty()) {
+        // Method 1: Use udev library (preferred)
+        // A fresh enumerator per scan is required: libudev caches the scan
+        // result inside the enumerator, so rescanning a reused one returns
+        // stale data. It is cheap next to the per-device sysattr reads it
+        // replaces, which are now served from the cache.
+        struct udev_enumerate* enumerate = udev_enumerate_new(m_udev);
+        if (enumerate) {
+            udev_enumerate_add_match_subsystem(enumerate, "usb");
+            udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
+            udev_enumerate_scan_devices(enumerate);
+            
+            struct udev_list_entry* dev_list_entry;
+            udev_list_entry_foreach(dev_list_entry, udev_enumerate_get_list_entry(enumerate)) {
+                collect(udev_list_entry_get_name(dev_list_entry));
+            }
+            
+            udev_enumerate_unref(enumerate);
+        }
     } else {
-        // Method 2: Fallback to parsing /sys/bus/usb/devices
-        DIR* dir = opendir("/sys/bus/usb/devices");
+        // Method 2: Fallback to parsing /sys/bus/usb/devices (or the tree set
+        // with setSysfsRoot())
+        const char* root = m_sysfsRoot.empty() ? "/sys/bus/usb/devices" : m_sysfsRoot.c_str();
+        DIR* dir = opendir(root);
         if (dir) {
+            char devicePath[PATH_MAX];
             struct dirent* entry;
             while ((entry = readdir(dir)) != nullptr) {
                 if (entry->d_name[0] == '.') continue;
                 
-                std::string devicePath = "/sys/bus/usb/devices/" + std::string(entry->d_name);
-                
-                // Read vendor ID
-                std::ifstream vidFile(devicePath + "/idVendor");
-                std::string vid;
-                if (vidFile.is_open() && std::getline(vidFile, vid)) {
-                    vidFile.close();
-                    
-                    // Read product ID
-                    std::ifstream pidFile(devicePath + "/idProduct");
-                    std::string pid;
-                    if (pidFile.is_open() && std::getline(pidFile, pid)) {
-                        pidFile.close();
-                        
-                        std::string deviceId = "USB_VID_" + vid + "&PID_" + pid;
-                        
-                        // Try to read product name
-                        std::ifstream productFile(devicePath + "/product");
-                        std::string product;
-                        std::string friendlyName = "Unknown USB Device";
-                        if (productFile.is_open() && std::getline(productFile, product)) {
-                            friendlyName = product;
-                        }
-                        
-                        devices.emplace_back(deviceId, friendlyName, vid, pid);
-                    }
-                }
+                snprintf(devicePath, sizeof(devicePath), "%s/%s", root, entry->d_name);
+                collect(devicePath);
             }
             closedir(dir);
         }
     }
-#endif
     
-    return devices;
+    // Forget syspaths that disappeared since the previous scan
+    for (auto it = m_attributeCache.begin(); it != m_attributeCache.end();) {
+        if (it->second.generation != generation) {
+            it = m_attributeCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#endif
 }
 
 UsbDevice UsbService::getDeviceInfo(const std::string& devicePath) {
-    // Simplified implementation
+#ifdef PLATFORM_LINUX
+    // Caller holds m_udevMutex
+    if (m_udev && m_sysfsRoot.empty()) {
+        struct udev_device* dev = udev_device_new_from_syspath(m_udev, devicePath.c_str());
+        if (!dev) {
+            return UsbDevice();
+        }
+        
+        UsbDevice device = makeDeviceFromUdev(m_stringPool, dev);
+        udev_device_unref(dev);
+        return device;
+    }
+    
+    char vid[16];
+    char pid[16];
+    if (!readSysfsAttribute(devicePath.c_str(), "idVendor", vid, sizeof(vid))
+        || !readSysfsAttribute(devicePath.c_str(), "idProduct", pid, sizeof(pid))) {
+        return UsbDevice();
+    }
+    
+    char serial[256];
+    char manufacturer[256];
+    char product[256];
+    bool hasSerial = readSysfsAttribute(devicePath.c_str(), "serial", serial, sizeof(serial));
+    bool hasManufacturer = readSysfsAttribute(devicePath.c_str(), "manufacturer", manufacturer, sizeof(manufacturer));
+    bool hasProduct = readSysfsAttribute(devicePath.c_str(), "product", product, sizeof(product));
+    
+    size_t slash = devicePath.rfind('/');
+    const char* sysname = devicePath.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    
+    return makeDevice(m_stringPool, vid, pid, hasSerial ? serial : nullptr, sysname,
+                      hasManufacturer ? manufacturer : nullptr, hasProduct ? product : nullptr);
+#else
+    (void)devicePath;
     return UsbDevice();
+#endif
 }
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <thread>
 #include <algorithm>
+#include <cstring>
 
 #ifdef PLATFORM_MACOS
 #include <IOKit/IOKitLib.h>
@@ -11,7 +12,10 @@
 #endif
 
 UsbService::UsbService() 
-    : m_hiddenWindow(nullptr), m_deviceNotification(nullptr), m_isMonitoring(false) {
+    : m_hiddenWindow(nullptr), m_deviceNotification(nullptr), m_snapshotStale(false),
+      m_matchPolicy(DeviceMatchPolicy::Exact), m_isMonitoring(false),
+      m_eventQueue(EVENT_QUEUE_CAPACITY), m_dispatchPending(false),
+      m_resyncPending(false), m_resyncWatched(false), m_resyncWatchedBefore(false) {
 }
 
 UsbService::~UsbService() {
@@ -31,22 +35,6 @@ void UsbService::shutdown() {
     stopMonitoring();
 }
 
-std::vector<UsbDevice> UsbService::getConnectedDevices() {
-#ifdef PLATFORM_MACOS
-    return enumerateUsbDevices();
-#else
-    return std::vector<UsbDevice>();
-#endif
-}
-
-bool UsbService::isDeviceConnected(const std::string& deviceId) {
-    auto devices = getConnectedDevices();
-    return std::any_of(devices.begin(), devices.end(),
-        [&deviceId](const UsbDevice& device) {
-            return device.deviceId == deviceId;
-        });
-}
-
 void UsbService::setOnDeviceConnected(DeviceCallback callback) {
     m_onDeviceConnected = callback;
 }
@@ -62,17 +50,16 @@ bool UsbService::startMonitoring() {
     
 #ifdef PLATFORM_MACOS
     m_isMonitoring = true;
-    m_cachedDevices = getConnectedDevices();
+    refreshDeviceSet(false);
     
-    // Start a polling thread for device changes (simplified approach)
-    std::thread([this]() {
-        while (m_isMonitoring) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            if (m_isMonitoring) {
-                checkForDeviceChanges();
-            }
+    // Start a polling thread for device changes (simplified approach),
+    // joined by stopMonitoring()
+    m_monitorThread = std::thread([this]() {
+        enterMonitorThread();
+        while (waitForNextPoll()) {
+            checkForDeviceChanges();
         }
-    }).detach();
+    });
     
     return true;
 #else
@@ -81,7 +68,7 @@ bool UsbService::startMonitoring() {
 }
 
 void UsbService::stopMonitoring() {
-    m_isMonitoring = false;
+    joinMonitorThread();
 }
 
 void UsbService::handleDeviceChange(int wParam, long lParam) {
@@ -90,62 +77,40 @@ void UsbService::handleDeviceChange(int wParam, long lParam) {
 }
 
 void UsbService::checkForDeviceChanges() {
-    auto currentDevices = getConnectedDevices();
-    
-    // Check for newly connected devices
-    for (const auto& device : currentDevices) {
-        auto it = std::find_if(m_cachedDevices.begin(), m_cachedDevices.end(),
-            [&device](const UsbDevice& cached) {
-                return cached.deviceId == device.deviceId;
-            });
-        
-        if (it == m_cachedDevices.end() && m_onDeviceConnected) {
-            m_onDeviceConnected(device);
-        }
-    }
-    
-    // Check for disconnected devices
-    for (const auto& cached : m_cachedDevices) {
-        auto it = std::find_if(currentDevices.begin(), currentDevices.end(),
-            [&cached](const UsbDevice& device) {
-                return device.deviceId == cached.deviceId;
-            });
-        
-        if (it == currentDevices.end() && m_onDeviceDisconnected) {
-            UsbDevice disconnected = cached;
-            disconnected.isConnected = false;
-            m_onDeviceDisconnected(disconnected);
-        }
-    }
-    
-    m_cachedDevices = currentDevices;
+    // Hashed O(n) diff against the cached set, see refreshDeviceSet()
+    refreshDeviceSet();
 }
 
-std::vector<UsbDevice> UsbService::enumerateUsbDevices() {
-    std::vector<UsbDevice> devices;
-    
+void UsbService::enumerateUsbDevices(std::vector<UsbDevice>& devices) {
 #ifdef PLATFORM_MACOS
     CFMutableDictionaryRef matchingDict = IOServiceMatching(kIOUSBDeviceClassName);
     if (!matchingDict) {
-        return devices;
+        return;
     }
     
     io_iterator_t iterator;
     kern_return_t kr = IOServiceGetMatchingServices(kIOMasterPortDefault, matchingDict, &iterator);
     if (kr != KERN_SUCCESS) {
-        return devices;
+        return;
     }
     
     io_service_t usbDevice;
     while ((usbDevice = IOIteratorNext(iterator))) {
         CFStringRef deviceName = NULL;
+        CFStringRef serialNumber = NULL;
         CFNumberRef vendorID = NULL;
         CFNumberRef productID = NULL;
+        CFNumberRef locationID = NULL;
+        
+        // Location ID: bus number in the top byte, then one nibble per hub port
+        locationID = (CFNumberRef)IORegistryEntryCreateCFProperty(usbDevice,
+                                                                 CFSTR(kUSBDevicePropertyLocationID),
+                                                                 kCFAllocatorDefault, 0);
         
-    // Get device location ID (if needed, otherwise remove this line)
-    // IORegistryEntryGetCFProperty is not used for getting location ID; use IORegistryEntryCreateCFProperty if needed
-    // Example (uncomment if you need location ID):
-    // CFNumberRef locationID = (CFNumberRef)IORegistryEntryCreateCFProperty(usbDevice, CFSTR(kIOUSBDevicePropertyLocationID), kCFAllocatorDefault, 0);
+        // Serial number, absent on many keyboards and receivers
+        serialNumber = (CFStringRef)IORegistryEntryCreateCFProperty(usbDevice,
+                                                                   CFSTR(kUSBSerialNumberString),
+                                                                   kCFAllocatorDefault, 0);
         
         // Get vendor ID
         vendorID = (CFNumberRef)IORegistryEntryCreateCFProperty(usbDevice, 
@@ -167,25 +132,46 @@ std::vector<UsbDevice> UsbService::enumerateUsbDevices() {
             CFNumberGetValue(vendorID, kCFNumberSInt16Type, &vid);
             CFNumberGetValue(productID, kCFNumberSInt16Type, &pid);
             
-            char vidStr[8], pidStr[8];
-            snprintf(vidStr, sizeof(vidStr), "%04X", vid);
-            snprintf(pidStr, sizeof(pidStr), "%04X", pid);
+            UsbDeviceKey key;
+            key.vendorId = vid;
+            key.productId = pid;
             
-            std::string deviceId = "USB_VID_" + std::string(vidStr) + "&PID_" + std::string(pidStr);
+            if (serialNumber) {
+                char serialBuf[256];
+                if (CFStringGetCString(serialNumber, serialBuf, sizeof(serialBuf), kCFStringEncodingUTF8)) {
+                    key.serialHash = hashSerial(serialBuf, strlen(serialBuf));
+                }
+            }
             
-            std::string friendlyName = "Unknown USB Device";
-            if (deviceName) {
-                char nameBuf[256];
-                if (CFStringGetCString(deviceName, nameBuf, sizeof(nameBuf), kCFStringEncodingUTF8)) {
-                    friendlyName = std::string(nameBuf);
+            if (locationID) {
+                UInt32 location = 0;
+                CFNumberGetValue(locationID, kCFNumberSInt32Type, &location);
+                unsigned ports[6];
+                size_t count = 0;
+                for (int shift = 20; shift >= 0 && count < 6; shift -= 4) {
+                    unsigned port = (location >> shift) & 0xf;
+                    if (port == 0) break;
+                    ports[count++] = port;
                 }
+                key.portPath = packPortPath(location >> 24, ports, count);
+            }
+            
+            // Stack buffers only: names already in the pool are not copied again
+            char deviceId[64];
+            size_t deviceIdLength = formatDeviceId(key, deviceId, sizeof(deviceId));
+            
+            char nameBuf[256] = "Unknown USB Device";
+            if (deviceName && !CFStringGetCString(deviceName, nameBuf, sizeof(nameBuf), kCFStringEncodingUTF8)) {
+                snprintf(nameBuf, sizeof(nameBuf), "Unknown USB Device");
             }
             
-            devices.emplace_back(deviceId, friendlyName, std::string(vidStr), std::string(pidStr));
+            devices.emplace_back(m_stringPool, std::string_view(deviceId, deviceIdLength), nameBuf);
         }
         
         // Release CF objects
         if (deviceName) CFRelease(deviceName);
+        if (serialNumber) CFRelease(serialNumber);
+        if (locationID) CFRelease(locationID);
         if (vendorID) CFRelease(vendorID);
         if (productID) CFRelease(productID);
         
@@ -194,8 +180,6 @@ std::vector<UsbDevice> UsbService::enumerateUsbDevices() {
     
     IOObjectRelease(iterator);
 #endif
-    
-    return devices;
 }
 
 UsbDevice UsbService::getDeviceInfo(const std::string& devicePath) {
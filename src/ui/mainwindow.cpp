@@ -17,6 +17,8 @@
 #include <QEvent>
 #include <QSettings>
 #include <QMetaObject>
+#include <QFileDialog>
+#include <QFile>
 
 MainWindow::MainWindow(QWidget *parent) 
     : QMainWindow(parent), m_application(nullptr) {
@@ -51,7 +53,7 @@ MainWindow::~MainWindow() {
 void MainWindow::setApplication(Application* app) {
     m_application = app;
     
-    // Set up logging callback so storage service can log to UI
+    // Set up logging callback so the services can log to the UI
     if (m_application) {
         m_application->setLogCallback([this](const std::string& message) {
             logMessage(QString::fromStdString(message));
@@ -241,6 +243,19 @@ void MainWindow::createStatusTab() {
     
     layout->addWidget(statusGroup);
     
+    // Device event to display command latency, per stage
+    QGroupBox *latencyGroup = new QGroupBox("Switching Latency");
+    QVBoxLayout *latencyLayout = new QVBoxLayout(latencyGroup);
+    
+    m_latencySummary = new QLabel("No display switch recorded yet");
+    m_latencySummary->setTextFormat(Qt::RichText);
+    latencyLayout->addWidget(m_latencySummary);
+    
+    m_exportLatencyButton = new QPushButton("Export JSON...");
+    latencyLayout->addWidget(m_exportLatencyButton, 0, Qt::AlignRight);
+    
+    layout->addWidget(latencyGroup);
+    
     // Activity log
     QGroupBox *logGroup = new QGroupBox("Activity Log");
     QVBoxLayout *logLayout = new QVBoxLayout(logGroup);
@@ -277,6 +292,10 @@ void MainWindow::setupConnections() {
             this, &MainWindow::onScreenDelayChanged);
     connect(m_testScreenButton, &QPushButton::clicked, 
             this, &MainWindow::onTestScreenControlClicked);
+    
+    // Status connections
+    connect(m_exportLatencyButton, &QPushButton::clicked,
+            this, &MainWindow::onExportLatencyClicked);
 }
 
 void MainWindow::onDeviceSelectionChanged() {
@@ -330,6 +349,9 @@ void MainWindow::onScreenDelayChanged(int delay) {
 }
 
 void MainWindow::onRefreshDevicesClicked() {
+    if (m_application) {
+        m_application->rescanUsbDevices();
+    }
     updateDeviceList();
     logMessage("Device list refreshed");
 }
@@ -371,6 +393,7 @@ void MainWindow::updateDeviceList() {
 
 void MainWindow::updateStatus() {
     updateConnectionStatus();
+    updateLatencyStatus();
     
     // Update settings from application state
     if (m_application) {
@@ -397,13 +420,14 @@ void MainWindow::updateStatus() {
         if (selectedDeviceId.empty()) {
             m_selectedDeviceLabel->setText("No device selected");
         } else {
-            // Find the friendly name for the selected device
-            auto devices = m_application->getConnectedUsbDevices();
+            // Find the friendly name for the selected device (served from the
+            // monitor's snapshot, no hardware enumeration per tick)
+            auto devices = m_application->getUsbDeviceSnapshot();
             QString deviceName = QString::fromStdString(selectedDeviceId); // fallback to ID
             
-            for (const auto& device : devices) {
-                if (device.deviceId == selectedDeviceId) {
-                    deviceName = QString::fromStdString(device.friendlyName);
+            for (const auto& device : devices->devices) {
+                if (m_application->isSelectedDevice(device)) {
+                    deviceName = QString::fromStdString(device.friendlyName());
                     break;
                 }
             }
@@ -416,36 +440,33 @@ void MainWindow::updateStatus() {
 void MainWindow::populateDeviceList() {
     m_deviceList->clear();
     if (m_application) {
-        // Get the currently selected device
-        std::string selectedDeviceId = m_application->getSelectedDevice();
+        bool selectionShown = false;
         
         // Get real devices from USB service
-        auto devices = m_application->getConnectedUsbDevices();
+        auto snapshot = m_application->getUsbDeviceSnapshot();
+        const auto& devices = snapshot->devices;
         
-        // First pass: find the maximum width needed for device IDs
-        int maxIdWidth = 0;
-        for (const auto& device : devices) {
-            QString deviceIdPart = QString::fromStdString("VID_" + device.vendorId + "&PID_" + device.productId);
-            maxIdWidth = qMax(maxIdWidth, deviceIdPart.length());
-        }
+        // VID/PID are fixed-width 4-digit hex, so every ID part has the same length
+        const int idWidth = QStringLiteral("VID_0000&PID_0000").length() + 2;
         
-        // Add some padding
-        maxIdWidth += 2;
-        
-        // Second pass: create the list items with proper alignment
         for (const auto& device : devices) {
-            QString deviceIdPart = QString::fromStdString("VID_" + device.vendorId + "&PID_" + device.productId);
-            QString deviceName = QString::fromStdString(device.friendlyName);
+            QString deviceIdPart = QString("VID_%1&PID_%2")
+                .arg(device.vendorId(), 4, 16, QChar('0'))
+                .arg(device.productId(), 4, 16, QChar('0'));
+            QString deviceName = QString::fromStdString(device.friendlyName());
             
             // Create aligned format with calculated width
-            QString label = QString("%1 │ %2").arg(deviceIdPart, -maxIdWidth).arg(deviceName);
+            QString label = QString("%1 │ %2").arg(deviceIdPart, -idWidth).arg(deviceName);
             
             QListWidgetItem* item = new QListWidgetItem(label);
-            item->setData(Qt::UserRole, QString::fromStdString(device.deviceId));
+            QString deviceId = QString::fromStdString(device.deviceId());
+            item->setData(Qt::UserRole, deviceId);
+            item->setToolTip(deviceId);  // tells identical models apart
             m_deviceList->addItem(item);
             
-            // Highlight the selected device
-            if (device.deviceId == selectedDeviceId) {
+            // Highlight the selected device (the first one, if several match)
+            if (!selectionShown && m_application->isSelectedDevice(device)) {
+                selectionShown = true;
                 m_deviceList->setCurrentItem(item);
                 item->setSelected(true);
             }
@@ -509,6 +530,69 @@ void MainWindow::updateConnectionStatus() {
     }
 }
 
+void MainWindow::updateLatencyStatus() {
+    if (!m_application) {
+        return;
+    }
+    
+    using Tracker = TransitionLatencyTracker;
+    const Tracker& tracker = m_application->getTransitionLatency();
+    const Tracker::Direction directions[] = {Tracker::Direction::Off, Tracker::Direction::On,
+                                             Tracker::Direction::EarlyOn};
+    const Tracker::Stage stages[] = {Tracker::Stage::Delivery, Tracker::Stage::Dispatch,
+                                     Tracker::Stage::Command, Tracker::Stage::Total,
+                                     Tracker::Stage::Lead};
+    
+    auto ms = [](std::chrono::microseconds value) {
+        return QString::number(value.count() / 1000.0, 'f', 1);
+    };
+    
+    QString html = "<table cellspacing='0' cellpadding='3'>"
+                   "<tr><th align='left'>Switch</th><th align='left'>Stage</th><th>Count</th>"
+                   "<th>p50 (ms)</th><th>p90 (ms)</th><th>p99 (ms)</th><th>Max (ms)</th></tr>";
+    bool any = false;
+    for (Tracker::Direction direction : directions) {
+        for (Tracker::Stage stage : stages) {
+            LatencyHistogram histogram = tracker.histogram(direction, stage);
+            if (histogram.count() == 0) {
+                continue;
+            }
+            any = true;
+            html += QString("<tr><td>%1</td><td>%2</td><td align='right'>%3</td><td align='right'>%4</td>"
+                            "<td align='right'>%5</td><td align='right'>%6</td><td align='right'>%7</td></tr>")
+                        .arg(QString::fromLatin1(Tracker::directionName(direction)),
+                             QString::fromLatin1(Tracker::stageName(stage)))
+                        .arg(histogram.count())
+                        .arg(ms(histogram.percentile(50.0)), ms(histogram.percentile(90.0)),
+                             ms(histogram.percentile(99.0)), ms(histogram.max()));
+        }
+    }
+    html += "</table>";
+    
+    m_latencySummary->setText(any ? html : QString("No display switch recorded yet"));
+}
+
+void MainWindow::onExportLatencyClicked() {
+    if (!m_application) {
+        return;
+    }
+    
+    QString path = QFileDialog::getSaveFileName(this, "Export Switching Latency",
+                                                "monitorswitch-latency.json", "JSON files (*.json)");
+    if (path.isEmpty()) {
+        return;
+    }
+    
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, "Export Failed", "Could not write " + path + ": " + file.errorString());
+        return;
+    }
+    file.write(QByteArray::fromStdString(m_application->getTransitionLatency().toJson()));
+    file.close();
+    logMessage("Switching latency exported to " + path);
+}
+
 // Slot to filter the device list according to the search
 void MainWindow::onDeviceSearchTextChanged(const QString& text) {
     for (int i = 0; i < m_deviceList->count(); ++i) {
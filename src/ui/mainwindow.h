@@ -43,6 +43,7 @@ private slots:
     void onScreenDelayChanged(int delay);
     void onRefreshDevicesClicked();
     void onTestScreenControlClicked();
+    void onExportLatencyClicked();
 
 private slots:
     void onDeviceSearchTextChanged(const QString& text);
@@ -79,6 +80,8 @@ private:
     QWidget* m_statusTab;
     QTextEdit* m_statusLog;
     QLabel* m_connectionStatus;
+    QLabel* m_latencySummary;
+    QPushButton* m_exportLatencyButton;
     
     // Core application reference
     Application* m_application;
@@ -89,6 +92,7 @@ private:
     // Helper methods
     void logMessage(const QString& message);
     void updateConnectionStatus();
+    void updateLatencyStatus();
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef FAKE_DISPLAY_BACKEND_H
+#define FAKE_DISPLAY_BACKEND_H
+
+#include "services/display/display_backend.h"
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Scriptable display backend recording the requests it receives
+ */
+class FakeDisplayBackend : public DisplayBackend {
+public:
+    explicit FakeDisplayBackend(std::string name, std::chrono::milliseconds latency = std::chrono::milliseconds(0))
+        : m_name(std::move(name)), m_latency(latency) {}
+
+    const char* name() const override { return m_name.c_str(); }
+
+    bool isAvailable() override {
+        ++availabilityChecks;
+        return available;
+    }
+
+    bool setPower(bool on) override {
+        ++powerRequests;
+        if (m_latency.count() > 0) {
+            std::this_thread::sleep_for(m_latency);
+        }
+        if (!working) {
+            return false;
+        }
+        powerOn = on;
+        return true;
+    }
+
+    bool queryPower(bool& on) override {
+        on = powerOn;
+        return working;
+    }
+
+    bool coversAllOutputs() const override { return allOutputs; }
+
+    bool supportsOutputs() override { return outputsSupported; }
+
+    bool setOutputPower(const std::vector<std::string>& outputs, bool on) override {
+        if (!working) {
+            return false;
+        }
+        for (const std::string& output : outputs) {
+            if (on) {
+                outputsOff.erase(output);
+            } else {
+                outputsOff.insert(output);
+            }
+        }
+        return true;
+    }
+
+    bool available = true;
+    bool working = true;
+    bool powerOn = true;
+    int availabilityChecks = 0;
+    int powerRequests = 0;
+    bool allOutputs = true;
+    bool outputsSupported = false;
+    std::set<std::string> outputsOff;
+
+private:
+    std::string m_name;
+    std::chrono::milliseconds m_latency;
+};
+
+#endif // FAKE_DISPLAY_BACKEND_H
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "services/storage/config_format.h"
+#include <string>
+
+TEST(ConfigFormatTest, RoundTripsEveryField) {
+    AppConfig config;
+    config.startOnBoot = false;
+    config.startMinimized = true;
+    config.selectedDeviceId = "USB\\VID_046D&PID_C52B\\5&2a\"b";
+    config.screenOffDelay = 25;
+    config.deviceDebounceMs = -1;
+    config.deviceMatchPolicy = "port";
+    config.displayToolFallback = true;
+    config.displayBackend = "drm";
+    config.deviceOutputs["046d:c52b"] = {"HDMI-1", "DP-2"};
+    config.deviceOutputs["with space\ttab"] = {};
+    config.selectedDeviceId += std::string("\nctl\x01", 5);
+    
+    AppConfig parsed;
+    std::string error;
+    ASSERT_TRUE(parseConfig(serializeConfig(config), parsed, error)) << error;
+    
+    EXPECT_EQ(config.startOnBoot, parsed.startOnBoot);
+    EXPECT_EQ(config.startMinimized, parsed.startMinimized);
+    EXPECT_EQ(config.selectedDeviceId, parsed.selectedDeviceId);
+    EXPECT_EQ(config.screenOffDelay, parsed.screenOffDelay);
+    EXPECT_EQ(config.deviceDebounceMs, parsed.deviceDebounceMs);
+    EXPECT_EQ(config.deviceMatchPolicy, parsed.deviceMatchPolicy);
+    EXPECT_EQ(config.displayToolFallback, parsed.displayToolFallback);
+    EXPECT_EQ(config.displayBackend, parsed.displayBackend);
+    EXPECT_EQ(config.deviceOutputs, parsed.deviceOutputs);
+}
+
+TEST(ConfigFormatTest, ReadsHandEditedFiles) {
+    const char* text =
+        "# edited by hand\r\n"
+        "version = 1\n"
+        "\n"
+        "[ settings ]\n"
+        "screenOffDelay=5   # seconds\n"
+        "\"displayBackend\" = \"dpms\"\n"
+        "futureSetting = [\"ignored\"]\n"
+        "\n"
+        "[outputs]\n"
+        "\"1-2.3\" = [ \"HDMI-1\" ,\"caf\\u00e9\" ]\n"
+        "\n"
+        "[devices]\n"
+        "known = [\n"
+        "    \"a\",  # first\n"
+        "\n"
+        "    \"b\"\n"
+        "]\n"
+        "[unknown]\n"
+        "anything = 1\n";
+    
+    AppConfig config;
+    std::vector<std::string> knownDevices;
+    std::string error;
+    ASSERT_TRUE(parseConfig(text, config, error, &knownDevices)) << error;
+    EXPECT_EQ(5, config.screenOffDelay);
+    EXPECT_EQ("dpms", config.displayBackend);
+    EXPECT_TRUE(config.startOnBoot);  // absent keys keep their default
+    EXPECT_EQ((std::vector<std::string>{"HDMI-1", "caf\xc3\xa9"}), config.deviceOutputs["1-2.3"]);
+    EXPECT_EQ((std::vector<std::string>{"a", "b"}), knownDevices);
+}
+
+TEST(ConfigFormatTest, ReportsTheLineOfAnError) {
+    struct Case {
+        const char* text;
+        const char* error;
+    };
+    const Case cases[] = {
+        {"\n\n[devices]\nknown = [\n\"a\"\n\"b\"]\n", "line 6: expected , or ] in array"},
+        {"[settings\n", "line 1: expected ] at the end of the table header"},
+        {"[settings]\nselectedDeviceId = \"open\n", "line 2: unterminated string"},
+        {"[settings]\nscreenOffDelay = 1 2\n", "line 2: unexpected text after the value of screenOffDelay"},
+        {"[future]\nlimits = { low = [1, 2 }\n", "line 2: unterminated array or table"},
+        {"[future]\nnote = 'open\n", "line 2: unterminated string"},
+    };
+    
+    for (const Case& c : cases) {
+        AppConfig config;
+        std::string error;
+        EXPECT_FALSE(parseConfig(c.text, config, error)) << c.text;
+        EXPECT_EQ(c.error, error) << c.text;
+    }
+}
+
+TEST(ConfigFormatTest, SkipsValuesItCannotUse) {
+    const char* text =
+        "version = 0\n"
+        "[settings]\n"
+        "screenOffDelay = \"10\"\n"
+        "startOnBoot = 1\n"
+        "deviceDebounceMs = 99999999999\n"
+        "selectedDeviceId = \"dev1\"\n"
+        "\n"
+        "[future]\n"
+        "ratio = 1.5\n"
+        "since = 1979-05-27T07:32:00Z\n"
+        "limits = { low = 1, names = [\"a\", 'b'] }\n"
+        "matrix = [\n"
+        "    [1, 2],  # rows\n"
+        "    [3, 4],\n"
+        "]\n"
+        "text = \"\"\"spans\n"
+        "lines\"\"\"\n"
+        "\n"
+        "[outputs]\n"
+        "\"dev1\" = [\"HDMI-1\"]\n"
+        "\"dev2\" = \"DP-1\"\n";
+    
+    AppConfig config;
+    std::vector<std::string> warnings;
+    std::string error;
+    ASSERT_TRUE(parseConfig(text, config, error, nullptr, &warnings)) << error;
+    
+    // Every other setting still applies; mistyped ones keep their value
+    EXPECT_EQ("dev1", config.selectedDeviceId);
+    EXPECT_EQ(AppConfig().screenOffDelay, config.screenOffDelay);
+    EXPECT_EQ(AppConfig().deviceDebounceMs, config.deviceDebounceMs);
+    EXPECT_TRUE(config.startOnBoot);
+    EXPECT_EQ((std::vector<std::string>{"HDMI-1"}), config.deviceOutputs["dev1"]);
+    EXPECT_EQ(0u, config.deviceOutputs.count("dev2"));
+    
+    EXPECT_EQ((std::vector<std::string>{
+        "line 1: version must be a positive integer, ignored",
+        "line 3: screenOffDelay expects an integer, ignored",
+        "line 4: startOnBoot expects true or false, ignored",
+        "line 5: deviceDebounceMs expects an integer, ignored",
+        "line 9: cannot read the value of ratio, skipped",
+        "line 10: cannot read the value of since, skipped",
+        "line 11: cannot read the value of limits, skipped",
+        "line 12: cannot read the value of matrix, skipped",
+        "line 16: cannot read the value of text, skipped",
+        "line 21: dev2 expects an array of strings, ignored",
+    }), warnings);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "core/device_debouncer.h"
+#include <vector>
+
+namespace {
+
+using Clock = DeviceDebouncer::Clock;
+using std::chrono::milliseconds;
+
+struct Transition {
+    std::string deviceId;
+    bool connected;
+    Clock::time_point detectedAt;
+};
+
+class DeviceDebouncerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        debouncer.setWindow(milliseconds(300));
+        debouncer.setOnTransition([this](const UsbDevice& device, bool connected, Clock::time_point detectedAt) {
+            transitions.push_back({device.deviceId(), connected, detectedAt});
+        });
+    }
+    
+    DeviceDelta removed(const UsbDevice& device) {
+        DeviceDelta delta;
+        delta.removed.push_back(device);
+        return delta;
+    }
+    
+    DeviceDelta added(const UsbDevice& device) {
+        DeviceDelta delta;
+        delta.added.push_back(device);
+        return delta;
+    }
+    
+    StringPool pool;
+    DeviceDebouncer debouncer;
+    std::vector<Transition> transitions;
+    UsbDevice keyboard{pool, "USB_VID_046d&PID_c52b", "Keyboard"};
+    Clock::time_point start = Clock::now();
+};
+
+} // namespace
+
+TEST_F(DeviceDebouncerTest, FlapIsSuppressed) {
+    EXPECT_TRUE(debouncer.submit(removed(keyboard), start));
+    EXPECT_TRUE(debouncer.submit(added(keyboard), start + milliseconds(20)));
+    EXPECT_TRUE(debouncer.submit(removed(keyboard), start + milliseconds(40)));
+    EXPECT_TRUE(debouncer.submit(added(keyboard), start + milliseconds(60)));
+    
+    EXPECT_FALSE(debouncer.flush(start + milliseconds(360)));
+    EXPECT_TRUE(transitions.empty());
+    EXPECT_EQ(4u, debouncer.stats().rawEvents);
+    EXPECT_EQ(4u, debouncer.stats().suppressedEvents);
+    EXPECT_EQ(0u, debouncer.stats().transitions);
+}
+
+TEST_F(DeviceDebouncerTest, BurstCollapsesToNetTransition) {
+    debouncer.submit(removed(keyboard), start);
+    debouncer.submit(added(keyboard), start + milliseconds(20));
+    debouncer.submit(removed(keyboard), start + milliseconds(40));
+    
+    // Not settled until the window has elapsed since the last event
+    EXPECT_TRUE(debouncer.flush(start + milliseconds(310)));
+    EXPECT_TRUE(transitions.empty());
+    EXPECT_EQ(start + milliseconds(340), debouncer.nextDeadline());
+    
+    EXPECT_FALSE(debouncer.flush(start + milliseconds(340)));
+    ASSERT_EQ(1u, transitions.size());
+    EXPECT_EQ(keyboard.deviceId(), transitions[0].deviceId);
+    EXPECT_FALSE(transitions[0].connected);
+    EXPECT_EQ(2u, debouncer.stats().suppressedEvents);
+    EXPECT_EQ(1u, debouncer.stats().transitions);
+}
+
+TEST_F(DeviceDebouncerTest, ZeroWindowPassesThrough) {
+    debouncer.setWindow(milliseconds(0));
+    
+    EXPECT_FALSE(debouncer.submit(removed(keyboard), start));
+    EXPECT_FALSE(debouncer.submit(added(keyboard), start));
+    
+    ASSERT_EQ(2u, transitions.size());
+    EXPECT_FALSE(transitions[0].connected);
+    EXPECT_TRUE(transitions[1].connected);
+    EXPECT_EQ(0u, debouncer.stats().suppressedEvents);
+}
+
+TEST_F(DeviceDebouncerTest, DevicesSettleIndependently) {
+    UsbDevice mouse(pool, "USB_VID_1234&PID_5678", "Mouse");
+    
+    debouncer.submit(added(keyboard), start);
+    debouncer.submit(added(mouse), start + milliseconds(200));
+    
+    EXPECT_TRUE(debouncer.flush(start + milliseconds(300)));
+    ASSERT_EQ(1u, transitions.size());
+    EXPECT_EQ(keyboard.deviceId(), transitions[0].deviceId);
+    EXPECT_TRUE(transitions[0].connected);
+    
+    EXPECT_FALSE(debouncer.flush(start + milliseconds(500)));
+    ASSERT_EQ(2u, transitions.size());
+    EXPECT_EQ(mouse.deviceId(), transitions[1].deviceId);
+}
+
+TEST_F(DeviceDebouncerTest, TransitionKeepsFirstDetectionTime) {
+    // The kernel saw the first event before it was submitted
+    DeviceDelta first = removed(keyboard);
+    first.detectedAt = start - milliseconds(5);
+    debouncer.submit(first, start);
+    debouncer.submit(added(keyboard), start + milliseconds(20));
+    debouncer.submit(removed(keyboard), start + milliseconds(40));
+    
+    EXPECT_FALSE(debouncer.flush(start + milliseconds(340)));
+    ASSERT_EQ(1u, transitions.size());
+    EXPECT_EQ(start - milliseconds(5), transitions[0].detectedAt);
+}
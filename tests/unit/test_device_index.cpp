@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include "services/usb/device_index.h"
+
+namespace {
+
+StringPool pool;
+
+UsbDevice makeDevice(const std::string& vid, const std::string& pid) {
+    return UsbDevice(pool, "USB_VID_" + vid + "&PID_" + pid, "Device " + pid);
+}
+
+std::vector<UsbDevice> makeDevices(int count) {
+    std::vector<UsbDevice> devices;
+    for (int i = 0; i < count; ++i) {
+        devices.push_back(makeDevice("046d", std::to_string(1000 + i)));
+    }
+    return devices;
+}
+
+} // namespace
+
+TEST(DeviceIndexTest, FindsIndexedDevices) {
+    auto devices = makeDevices(50);
+    DeviceIndex index;
+    index.rebuild(devices);
+    
+    for (size_t i = 0; i < devices.size(); ++i) {
+        EXPECT_EQ(i, index.find(devices, devices[i]));
+    }
+    EXPECT_EQ(DeviceIndex::npos, index.find(devices, makeDevice("1234", "5678")));
+}
+
+TEST(DeviceIndexTest, EmptyIndexFindsNothing) {
+    std::vector<UsbDevice> devices;
+    DeviceIndex index;
+    EXPECT_EQ(DeviceIndex::npos, index.find(devices, makeDevice("046d", "c52b")));
+    
+    index.rebuild(devices);
+    EXPECT_EQ(DeviceIndex::npos, index.find(devices, makeDevice("046d", "c52b")));
+}
+
+TEST(DeviceIndexTest, DeltaReportsAddedAndRemoved) {
+    auto previous = makeDevices(40);
+    auto current = previous;
+    current.erase(current.begin() + 7);
+    current.push_back(makeDevice("1d6b", "0003"));
+    
+    DeviceIndex previousIndex;
+    DeviceIndex currentIndex;
+    previousIndex.rebuild(previous);
+    currentIndex.rebuild(current);
+    
+    DeviceDelta delta;
+    computeDeviceDelta(previous, previousIndex, current, currentIndex, delta);
+    
+    ASSERT_EQ(1u, delta.added.size());
+    EXPECT_EQ("USB_VID_1d6b&PID_0003", delta.added[0].deviceId());
+    EXPECT_TRUE(delta.added[0].isConnected);
+    
+    ASSERT_EQ(1u, delta.removed.size());
+    EXPECT_EQ(previous[7].deviceId(), delta.removed[0].deviceId());
+    EXPECT_FALSE(delta.removed[0].isConnected);
+}
+
+TEST(DeviceIndexTest, IdenticalSetsProduceEmptyDelta) {
+    auto previous = makeDevices(10);
+    auto current = previous;
+    
+    DeviceIndex previousIndex;
+    DeviceIndex currentIndex;
+    previousIndex.rebuild(previous);
+    currentIndex.rebuild(current);
+    
+    DeviceDelta delta;
+    computeDeviceDelta(previous, previousIndex, current, currentIndex, delta);
+    EXPECT_TRUE(delta.empty());
+}
+
+TEST(DeviceIndexTest, DeviceSetFindsById) {
+    DeviceSet set;
+    set.devices = makeDevices(20);
+    set.index.rebuild(set.devices);
+    
+    const UsbDevice* found = set.find(set.devices[3].deviceId());
+    ASSERT_NE(nullptr, found);
+    EXPECT_EQ(set.devices[3].friendlyName(), found->friendlyName());
+    EXPECT_EQ(nullptr, set.find("USB_VID_ffff&PID_ffff"));
+}
+
+TEST(DeviceIndexTest, IdenticalModelsOnDifferentPortsAreDistinct) {
+    UsbDeviceKey left;
+    left.vendorId = 0x046d;
+    left.productId = 0xc52b;
+    unsigned leftPorts[] = {2, 1};
+    left.portPath = packPortPath(1, leftPorts, 2);
+    UsbDeviceKey right = left;
+    unsigned rightPorts[] = {2, 3};
+    right.portPath = packPortPath(1, rightPorts, 2);
+    
+    std::vector<UsbDevice> previous = {
+        UsbDevice(pool, formatDeviceId(left), "Keyboard"),
+        UsbDevice(pool, formatDeviceId(right), "Keyboard")
+    };
+    std::vector<UsbDevice> current = {previous[0]};
+    
+    DeviceIndex previousIndex;
+    DeviceIndex currentIndex;
+    previousIndex.rebuild(previous);
+    currentIndex.rebuild(current);
+    
+    DeviceDelta delta;
+    computeDeviceDelta(previous, previousIndex, current, currentIndex, delta);
+    EXPECT_TRUE(delta.added.empty());
+    ASSERT_EQ(1u, delta.removed.size());
+    EXPECT_EQ(right, delta.removed[0].key);
+}
+
+TEST(DeviceKeyTest, FormatAndParseRoundTrip) {
+    UsbDeviceKey key;
+    key.vendorId = 0x046d;
+    key.productId = 0xc52b;
+    key.serialHash = hashSerial("ABC123", 6);
+    unsigned ports[] = {4, 2};
+    key.portPath = packPortPath(3, ports, 2);
+    
+    EXPECT_EQ(key, parseDeviceKey(formatDeviceId(key)));
+    
+    UsbDeviceKey legacy = parseDeviceKey("USB_VID_046d&PID_c52b");
+    EXPECT_EQ(0x046d, legacy.vendorId);
+    EXPECT_EQ(0xc52b, legacy.productId);
+    EXPECT_EQ(0u, legacy.serialHash);
+    EXPECT_EQ(0u, legacy.portPath);
+    
+    UsbDeviceKey windows = parseDeviceKey("USB\\VID_046D&PID_C52B\\5&2A2C1D0&0&3");
+    EXPECT_EQ(0x046d, windows.vendorId);
+    EXPECT_NE(0u, windows.serialHash);
+}
+
+TEST(DeviceKeyTest, MatchPolicies) {
+    UsbDeviceKey selected;
+    selected.vendorId = 0x046d;
+    selected.productId = 0xc52b;
+    selected.serialHash = 0x1234;
+    selected.portPath = 0x0102000000000000ULL;
+    
+    UsbDeviceKey movedPort = selected;
+    movedPort.portPath = 0x0103000000000000ULL;
+    UsbDeviceKey otherModel = selected;
+    otherModel.productId = 0xc534;
+    
+    EXPECT_TRUE(matchDeviceKey(selected, selected, DeviceMatchPolicy::Exact));
+    EXPECT_FALSE(matchDeviceKey(selected, movedPort, DeviceMatchPolicy::Exact));
+    EXPECT_TRUE(matchDeviceKey(selected, movedPort, DeviceMatchPolicy::VidPidOnly));
+    EXPECT_FALSE(matchDeviceKey(selected, movedPort, DeviceMatchPolicy::PortOnly));
+    EXPECT_TRUE(matchDeviceKey(selected, otherModel, DeviceMatchPolicy::PortOnly));
+    
+    // IDs saved before serial/port were recorded match any device of the model
+    UsbDeviceKey legacy = parseDeviceKey("USB_VID_046d&PID_c52b");
+    EXPECT_TRUE(matchDeviceKey(legacy, movedPort, DeviceMatchPolicy::Exact));
+    EXPECT_FALSE(matchDeviceKey(legacy, otherModel, DeviceMatchPolicy::Exact));
+    
+    DeviceSet set;
+    set.devices = {UsbDevice(pool, formatDeviceId(movedPort), "Keyboard")};
+    set.index.rebuild(set.devices);
+    EXPECT_NE(nullptr, set.findMatch(legacy, DeviceMatchPolicy::Exact));
+    EXPECT_EQ(nullptr, set.findMatch(selected, DeviceMatchPolicy::Exact));
+    
+    // A serial saved without a port still finds the device on another port
+    UsbDeviceKey anyPort = selected;
+    anyPort.portPath = 0;
+    EXPECT_NE(nullptr, set.findMatch(anyPort, DeviceMatchPolicy::Exact));
+}
+
+TEST(StringPoolTest, InternsEachValueOnce) {
+    StringPool strings;
+    const std::string& first = strings.intern("Logitech USB Receiver");
+    const std::string& second = strings.intern(std::string("Logitech USB Receiver"));
+    
+    EXPECT_EQ(&first, &second);
+    EXPECT_EQ(1u, strings.size());
+    EXPECT_NE(&first, &strings.intern("Other"));
+    
+    UsbDevice device(strings, "USB_VID_046d&PID_c52b", "Logitech USB Receiver");
+    EXPECT_EQ(&first, device.name);
+    EXPECT_EQ(0x046d, device.vendorId());
+    EXPECT_EQ(0xc52b, device.productId());
+    EXPECT_TRUE(UsbDevice().deviceId().empty());
+}
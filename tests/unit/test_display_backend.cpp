@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "fake_display_backend.h"
+#include <memory>
+
+namespace {
+
+// Registers a fake and keeps a handle on it for assertions
+FakeDisplayBackend* addFake(DisplayBackendRegistry& registry, const std::string& name,
+                            std::chrono::milliseconds latency = std::chrono::milliseconds(0)) {
+    auto backend = std::make_unique<FakeDisplayBackend>(name, latency);
+    FakeDisplayBackend* handle = backend.get();
+    registry.add(std::move(backend));
+    return handle;
+}
+
+} // namespace
+
+TEST(DisplayBackendRegistryTest, ProbesAndPicksFastestWorkingBackend) {
+    DisplayBackendRegistry registry;
+    FakeDisplayBackend* slow = addFake(registry, "slow", std::chrono::milliseconds(30));
+    FakeDisplayBackend* broken = addFake(registry, "broken");
+    FakeDisplayBackend* missing = addFake(registry, "missing");
+    FakeDisplayBackend* fast = addFake(registry, "fast", std::chrono::milliseconds(1));
+    broken->working = false;
+    missing->available = false;
+    
+    EXPECT_EQ("fast", registry.select(""));
+    EXPECT_EQ(fast, registry.active());
+    
+    // Every available backend is exercised once, unavailable ones never
+    EXPECT_EQ(1, slow->powerRequests);
+    EXPECT_EQ(1, broken->powerRequests);
+    EXPECT_EQ(0, missing->powerRequests);
+    
+    ASSERT_EQ(4u, registry.probeResults().size());
+    EXPECT_TRUE(registry.probeResults()[0].working);
+    EXPECT_GE(registry.probeResults()[0].latency, registry.probeResults()[3].latency);
+    EXPECT_FALSE(registry.probeResults()[1].working);
+    EXPECT_FALSE(registry.probeResults()[2].available);
+}
+
+TEST(DisplayBackendRegistryTest, PrefersFullCoverageOverLatency) {
+    DisplayBackendRegistry registry;
+    FakeDisplayBackend* backlight = addFake(registry, "backlight");
+    FakeDisplayBackend* dpms = addFake(registry, "dpms", std::chrono::milliseconds(20));
+    FakeDisplayBackend* slower = addFake(registry, "slower", std::chrono::milliseconds(40));
+    backlight->allOutputs = false;
+    
+    EXPECT_EQ("dpms", registry.select(""));
+    EXPECT_EQ(1, slower->powerRequests);
+    
+    // The backlight is still used when nothing else works
+    dpms->working = false;
+    slower->working = false;
+    EXPECT_EQ("backlight", registry.select(""));
+}
+
+TEST(DisplayBackendRegistryTest, CachedBackendSkipsProbing) {
+    DisplayBackendRegistry registry;
+    FakeDisplayBackend* first = addFake(registry, "first");
+    FakeDisplayBackend* cached = addFake(registry, "cached");
+    
+    EXPECT_EQ("cached", registry.select("cached"));
+    EXPECT_EQ(0, first->powerRequests);
+    EXPECT_EQ(0, cached->powerRequests);
+    EXPECT_TRUE(registry.probeResults().empty());
+    
+    // A cached backend that disappeared triggers a fresh probe
+    cached->available = false;
+    EXPECT_EQ("first", registry.select("cached"));
+    EXPECT_EQ(2u, registry.probeResults().size());
+}
+
+TEST(DisplayBackendRegistryTest, FallsBackWhenActiveBackendFails) {
+    DisplayBackendRegistry registry;
+    FakeDisplayBackend* primary = addFake(registry, "primary");
+    FakeDisplayBackend* secondary = addFake(registry, "secondary", std::chrono::milliseconds(5));
+    ASSERT_EQ("primary", registry.select(""));
+    
+    primary->working = false;
+    EXPECT_TRUE(registry.setPower(false));
+    EXPECT_FALSE(secondary->powerOn);
+    EXPECT_EQ(secondary, registry.active());
+    
+    bool on = true;
+    EXPECT_TRUE(registry.queryPower(on));
+    EXPECT_FALSE(on);
+    
+    secondary->working = false;
+    EXPECT_FALSE(registry.setPower(true));
+}
+
+TEST(DisplayBackendRegistryTest, NoBackendMeansNoControl) {
+    DisplayBackendRegistry registry;
+    EXPECT_EQ("", registry.select("x11-dpms"));
+    EXPECT_EQ(nullptr, registry.active());
+    EXPECT_FALSE(registry.setPower(false));
+    
+    bool on;
+    EXPECT_FALSE(registry.queryPower(on));
+}
+
+TEST(DisplayBackendRegistryTest, RoutesOutputControlToCapableBackend) {
+    DisplayBackendRegistry registry;
+    FakeDisplayBackend* dpms = addFake(registry, "dpms");
+    FakeDisplayBackend* randr = addFake(registry, "randr", std::chrono::milliseconds(5));
+    randr->outputsSupported = true;
+    ASSERT_EQ("dpms", registry.select(""));
+    
+    // The whole screen stays on; only the listed outputs are switched
+    EXPECT_TRUE(registry.setOutputPower({"HDMI-1", "DP-2"}, false));
+    EXPECT_EQ((std::set<std::string>{"HDMI-1", "DP-2"}), randr->outputsOff);
+    EXPECT_TRUE(dpms->powerOn);
+    EXPECT_EQ(dpms, registry.active());
+    
+    EXPECT_TRUE(registry.setOutputPower({"DP-2"}, true));
+    EXPECT_EQ((std::set<std::string>{"HDMI-1"}), randr->outputsOff);
+    
+    randr->available = false;
+    EXPECT_FALSE(registry.setOutputPower({"HDMI-1"}, true));
+}
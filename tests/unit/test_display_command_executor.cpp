@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "services/display/display_command_executor.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Holds the executor thread inside a command until released
+struct Gate {
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool entered = false;
+    bool open = false;
+    
+    bool pass() {
+        std::unique_lock<std::mutex> lock(mutex);
+        entered = true;
+        changed.notify_all();
+        changed.wait(lock, [this] { return open; });
+        return true;
+    }
+    
+    bool waitEntered() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, 2s, [this] { return entered; });
+    }
+    
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+        changed.notify_all();
+    }
+};
+
+class DisplayCommandExecutorTest : public ::testing::Test {
+protected:
+    std::shared_ptr<TimerScheduler> scheduler = std::make_shared<TimerScheduler>();
+    DisplayCommandExecutor executor{scheduler};
+    Gate gate;
+    
+    // Occupy the executor thread so later commands have to wait
+    std::future<DisplayCommandResult> block(std::chrono::milliseconds timeout = 2000ms, bool on = true) {
+        auto future = executor.submit(on, [this] { return gate.pass(); }, timeout);
+        EXPECT_TRUE(gate.waitEntered());
+        return future;
+    }
+};
+
+} // namespace
+
+TEST_F(DisplayCommandExecutorTest, ReportsCommandOutcome) {
+    auto ok = executor.submit(false, [] { return true; }, 2s);
+    ASSERT_EQ(std::future_status::ready, ok.wait_for(2s));
+    EXPECT_EQ(DisplayCommandResult::Completed, ok.get());
+    
+    std::atomic<bool> called(false);
+    auto failed = executor.submit(true, [] { return false; }, 2s, [&](DisplayCommandResult result) {
+        called = result == DisplayCommandResult::Failed;
+    });
+    ASSERT_EQ(std::future_status::ready, failed.wait_for(2s));
+    EXPECT_EQ(DisplayCommandResult::Failed, failed.get());
+    EXPECT_TRUE(called);
+}
+
+TEST_F(DisplayCommandExecutorTest, OffThenOnWhileWaitingCancelsBoth) {
+    auto running = block();
+    
+    std::atomic<int> runs(0);
+    auto off = executor.submit(false, [&] { ++runs; return true; }, 2s);
+    auto on = executor.submit(true, [&] { ++runs; return true; }, 2s);
+    
+    EXPECT_EQ(DisplayCommandResult::Collapsed, off.get());
+    EXPECT_EQ(DisplayCommandResult::Collapsed, on.get());
+    EXPECT_FALSE(executor.hasPending());
+    
+    gate.release();
+    EXPECT_EQ(DisplayCommandResult::Completed, running.get());
+    EXPECT_EQ(0, runs.load());
+}
+
+TEST_F(DisplayCommandExecutorTest, OnThenOffWhileOffRunsCancelsBoth) {
+    // Device back then gone again while the display is switching off
+    auto running = block(2000ms, false);
+    
+    std::atomic<int> runs(0);
+    auto on = executor.submit(true, [&] { ++runs; return true; }, 2s);
+    auto off = executor.submit(false, [&] { ++runs; return true; }, 2s);
+    
+    EXPECT_EQ(DisplayCommandResult::Collapsed, on.get());
+    EXPECT_EQ(DisplayCommandResult::Collapsed, off.get());
+    EXPECT_FALSE(executor.hasPending());
+    
+    gate.release();
+    EXPECT_EQ(DisplayCommandResult::Completed, running.get());
+    EXPECT_EQ(0, runs.load());
+}
+
+TEST_F(DisplayCommandExecutorTest, OppositeCommandReplacesARepeatOfTheRunningOne) {
+    auto running = block();
+    
+    // The waiting turn-on changes nothing; cancelling the turn-off with it
+    // would leave the display on
+    std::atomic<int> ons(0), offs(0);
+    auto on = executor.submit(true, [&] { ++ons; return true; }, 2s);
+    auto off = executor.submit(false, [&] { ++offs; return true; }, 2s);
+    EXPECT_EQ(DisplayCommandResult::Collapsed, on.get());
+    
+    gate.release();
+    EXPECT_EQ(DisplayCommandResult::Completed, off.get());
+    EXPECT_EQ(0, ons.load());
+    EXPECT_EQ(1, offs.load());
+}
+
+TEST_F(DisplayCommandExecutorTest, LaterCommandOfSameKindWins) {
+    auto running = block();
+    
+    std::atomic<int> first(0), second(0);
+    auto older = executor.submit(false, [&] { ++first; return true; }, 2s);
+    auto newer = executor.submit(false, [&] { ++second; return true; }, 2s);
+    EXPECT_EQ(DisplayCommandResult::Collapsed, older.get());
+    
+    gate.release();
+    EXPECT_EQ(DisplayCommandResult::Completed, newer.get());
+    EXPECT_EQ(0, first.load());
+    EXPECT_EQ(1, second.load());
+}
+
+TEST_F(DisplayCommandExecutorTest, HungCommandTimesOutAndStaleCommandNeverStarts) {
+    auto running = block(30ms);
+    
+    std::atomic<bool> started(false);
+    auto waiting = executor.submit(false, [&] { started = true; return true; }, 30ms);
+    
+    // The caller is released although the executor thread is still stuck
+    ASSERT_EQ(std::future_status::ready, running.wait_for(2s));
+    EXPECT_EQ(DisplayCommandResult::TimedOut, running.get());
+    ASSERT_EQ(std::future_status::ready, waiting.wait_for(2s));
+    EXPECT_EQ(DisplayCommandResult::TimedOut, waiting.get());
+    
+    gate.release();
+    auto next = executor.submit(true, [] { return true; }, 2s);
+    EXPECT_EQ(DisplayCommandResult::Completed, next.get());
+    EXPECT_FALSE(started);
+}
+
+TEST_F(DisplayCommandExecutorTest, TimedOutCommandStillCompletes) {
+    std::atomic<int> reports(0);
+    std::atomic<bool> switched(false);
+    auto slow = executor.submit(false, [&] {
+        gate.pass();
+        switched = true;
+        return true;
+    }, 30ms, [&](DisplayCommandResult) { ++reports; });
+    ASSERT_TRUE(gate.waitEntered());
+    
+    ASSERT_EQ(std::future_status::ready, slow.wait_for(2s));
+    EXPECT_EQ(DisplayCommandResult::TimedOut, slow.get());
+    
+    // The backend call goes on and takes effect; only the first outcome is reported
+    gate.release();
+    auto next = executor.submit(true, [] { return true; }, 2s);
+    EXPECT_EQ(DisplayCommandResult::Completed, next.get());
+    EXPECT_TRUE(switched);
+    EXPECT_EQ(1, reports.load());
+}
+
+TEST_F(DisplayCommandExecutorTest, StopRejectsWaitingCommand) {
+    auto running = block();
+    auto waiting = executor.submit(false, [] { return true; }, 2s);
+    
+    std::thread releaser([this] {
+        std::this_thread::sleep_for(20ms);
+        gate.release();
+    });
+    executor.stop();
+    releaser.join();
+    
+    EXPECT_EQ(DisplayCommandResult::Completed, running.get());
+    EXPECT_EQ(DisplayCommandResult::Rejected, waiting.get());
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include "services/display/display_service.h"
+#include "services/display/display_backend.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// Stands in for the platform file: the scheduling shared by every platform
+// (display_service_common.cpp) drives a display that only records its state
+
+namespace {
+
+std::atomic<bool> displayOn(true);
+std::atomic<int> switches(0);
+std::atomic<bool> held(false);     // turnOn() waits while set
+std::atomic<int> holding(0);       // turnOn() calls waiting right now
+
+void waitWhileHeld() {
+    ++holding;
+    while (held) {
+        std::this_thread::sleep_for(1ms);
+    }
+    --holding;
+}
+
+bool waitForDisplay(bool on) {
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (displayOn != on && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(2ms);
+    }
+    return displayOn == on;
+}
+
+} // namespace
+
+DisplayService::DisplayService()
+    : m_scheduler(std::make_shared<TimerScheduler>()),
+      m_executor(std::make_unique<DisplayCommandExecutor>(m_scheduler)),
+      m_displayOffRequested(false), m_offGeneration(0),
+      m_earlyWakeTimeoutMs(DefaultEarlyWakeTimeout.count()), m_externalToolFallback(false) {
+}
+
+DisplayService::~DisplayService() {
+    cancelScheduledOperations();
+    m_executor->stop();
+}
+
+bool DisplayService::turnOn() {
+    waitWhileHeld();
+    displayOn = true;
+    ++switches;
+    return true;
+}
+
+bool DisplayService::turnOff() {
+    displayOn = false;
+    ++switches;
+    return true;
+}
+
+class DisplayServiceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        displayOn = true;
+        switches = 0;
+        held = false;
+        display.setEarlyWakeTimeout(50ms);
+    }
+    
+    // Keeps the command thread busy in a turn-on, so later commands wait
+    std::future<DisplayCommandResult> holdCommandThread() {
+        held = true;
+        auto running = display.requestPower(true);
+        while (holding == 0) {
+            std::this_thread::sleep_for(1ms);
+        }
+        return running;
+    }
+    
+    DisplayService display;
+};
+
+TEST_F(DisplayServiceTest, UnconfirmedEarlyWakeIsTurnedOffAgain) {
+    ASSERT_EQ(DisplayCommandResult::Completed, display.scheduleDisplayOff(60).get());
+    
+    auto early = display.onDeviceReturning();
+    ASSERT_TRUE(early.valid());
+    EXPECT_EQ(DisplayCommandResult::Completed, early.get());
+    EXPECT_TRUE(displayOn);
+    
+    // No reconnect follows the hint
+    EXPECT_TRUE(waitForDisplay(false));
+    
+    // Still waiting for the device: its reconnect turns the display on
+    auto reconnected = display.onDeviceReconnected();
+    ASSERT_TRUE(reconnected.valid());
+    EXPECT_EQ(DisplayCommandResult::Completed, reconnected.get());
+    EXPECT_TRUE(displayOn);
+}
+
+TEST_F(DisplayServiceTest, ConfirmedEarlyWakeStaysOn) {
+    ASSERT_EQ(DisplayCommandResult::Completed, display.scheduleDisplayOff(60).get());
+    EXPECT_EQ(DisplayCommandResult::Completed, display.onDeviceReturning().get());
+    EXPECT_EQ(DisplayCommandResult::Completed, display.onDeviceReconnected().get());
+    int switched = switches;
+    
+    std::this_thread::sleep_for(150ms);
+    EXPECT_TRUE(displayOn);
+    EXPECT_EQ(switched, switches.load());
+}
+
+TEST_F(DisplayServiceTest, ReconnectBeforeTheOffRunsCancelsIt) {
+    auto running = holdCommandThread();
+    std::atomic<bool> completed(false);
+    auto off = display.scheduleDisplayOff(60, [&completed]() { completed = true; });
+    auto on = display.onDeviceReconnected();
+    ASSERT_TRUE(on.valid());
+    EXPECT_EQ(DisplayCommandResult::Collapsed, off.get());
+    EXPECT_EQ(DisplayCommandResult::Collapsed, on.get());
+    
+    held = false;
+    EXPECT_EQ(DisplayCommandResult::Completed, running.get());
+    EXPECT_TRUE(displayOn);
+    EXPECT_FALSE(completed);
+    
+    // Nothing left pending from the cancelled turn-off
+    EXPECT_FALSE(display.onDeviceReconnected().valid());
+}
+
+TEST_F(DisplayServiceTest, UnconfirmedEarlyWakeBeforeTheOffRunsBlanksAgain) {
+    auto running = holdCommandThread();
+    std::atomic<bool> completed(false);
+    auto off = display.scheduleDisplayOff(60, [&completed]() { completed = true; });
+    auto early = display.onDeviceReturning();
+    ASSERT_TRUE(early.valid());
+    EXPECT_EQ(DisplayCommandResult::Collapsed, off.get());
+    EXPECT_EQ(DisplayCommandResult::Collapsed, early.get());
+    
+    held = false;
+    EXPECT_EQ(DisplayCommandResult::Completed, running.get());
+    
+    // The hint was wrong: the display goes off and stays requested off
+    EXPECT_TRUE(waitForDisplay(false));
+    EXPECT_FALSE(completed);
+    
+    auto reconnected = display.onDeviceReconnected();
+    ASSERT_TRUE(reconnected.valid());
+    EXPECT_EQ(DisplayCommandResult::Completed, reconnected.get());
+    EXPECT_TRUE(displayOn);
+}
+
+TEST_F(DisplayServiceTest, ExpiringTurnOnNeverUndoesANewerTurnOff) {
+    for (int i = 0; i < 50; ++i) {
+        ASSERT_EQ(DisplayCommandResult::Completed, display.scheduleDisplayOff(0).get());
+        
+        // The delayed turn-on of the first schedule fires about now; once it
+        // has started, cancelling it from the new schedule fails
+        auto off = display.scheduleDisplayOff(60);
+        DisplayCommandResult result = off.get();
+        EXPECT_TRUE(result == DisplayCommandResult::Completed || result == DisplayCommandResult::Collapsed);
+        
+        std::this_thread::sleep_for(10ms);
+        EXPECT_FALSE(displayOn) << "iteration " << i;
+        
+        display.cancelScheduledOperations();
+        displayOn = true;
+    }
+}
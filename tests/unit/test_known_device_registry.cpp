@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "services/storage/known_device_registry.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+bool writeFile(const std::string& path, const std::string& content) {
+    std::ofstream file(path + ".tmp", std::ios::binary | std::ios::trunc);
+    file << content;
+    file.close();
+    return file && std::rename((path + ".tmp").c_str(), path.c_str()) == 0;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+class KnownDeviceRegistryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        const char* test = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        m_dir = std::filesystem::temp_directory_path() / (std::string("monitorswitch-registry-") + test);
+        std::filesystem::remove_all(m_dir);
+        std::filesystem::create_directories(m_dir);
+        m_path = (m_dir / "devices.log").string();
+    }
+    
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+    
+    std::filesystem::path m_dir;
+    std::string m_path;
+};
+
+const KnownDeviceRegistry::Clock::time_point T0 = KnownDeviceRegistry::Clock::time_point(1700000000s);
+
+} // namespace
+
+TEST_F(KnownDeviceRegistryTest, PersistsAcrossReopen) {
+    {
+        KnownDeviceRegistry registry(writeFile);
+        ASSERT_TRUE(registry.open(m_path));
+        EXPECT_TRUE(registry.touch("046d:c52b", "Receiver", T0));
+        EXPECT_TRUE(registry.touch("tab\there", "", T0 + 1s));
+        EXPECT_TRUE(registry.touch("gone", "", T0 + 2s));
+        EXPECT_TRUE(registry.remove("gone"));
+        EXPECT_TRUE(registry.touch("046d:c52b", "Unifying Receiver", T0 + 10s));
+    }
+    
+    KnownDeviceRegistry registry(writeFile);
+    ASSERT_TRUE(registry.open(m_path));
+    EXPECT_EQ(2u, registry.size());
+    EXPECT_FALSE(registry.contains("gone"));
+    
+    auto devices = registry.devices();
+    ASSERT_EQ(2u, devices.size());
+    EXPECT_EQ("046d:c52b", devices[0].id);
+    EXPECT_EQ("Unifying Receiver", devices[0].friendlyName);
+    EXPECT_EQ(T0, devices[0].firstSeen);
+    EXPECT_EQ(T0 + 10s, devices[0].lastSeen);
+    EXPECT_EQ("tab\there", devices[1].id);
+}
+
+TEST_F(KnownDeviceRegistryTest, RepeatedSightingsAreNotWritten) {
+    KnownDeviceRegistry registry(writeFile);
+    ASSERT_TRUE(registry.open(m_path));
+    registry.touch("kvm", "", T0);
+    size_t records = registry.journalRecords();
+    
+    for (int i = 1; i < 50; ++i) {
+        registry.touch("kvm", "", T0 + std::chrono::seconds(i));
+    }
+    EXPECT_EQ(records, registry.journalRecords());
+    
+    registry.touch("kvm", "", T0 + KnownDeviceRegistry::TouchGranularity);
+    EXPECT_EQ(records + 1, registry.journalRecords());
+    EXPECT_EQ(T0 + KnownDeviceRegistry::TouchGranularity, registry.find("kvm")->lastSeen);
+}
+
+TEST_F(KnownDeviceRegistryTest, CompactsStaleRecords) {
+    KnownDeviceRegistry registry(writeFile);
+    ASSERT_TRUE(registry.open(m_path));
+    registry.touch("a", "", T0);
+    for (int i = 1; i <= 40; ++i) {
+        registry.touch("a", "", T0 + i * KnownDeviceRegistry::TouchGranularity);
+    }
+    
+    // Compaction runs by itself before stale lines pile up
+    EXPECT_LE(registry.journalRecords(), 2u * registry.size() + 16);
+    EXPECT_TRUE(registry.compact());
+    EXPECT_EQ(1u, registry.journalRecords());
+    
+    registry.touch("b", "", T0 + 1h);
+    registry.close();
+    KnownDeviceRegistry reopened(writeFile);
+    ASSERT_TRUE(reopened.open(m_path));
+    EXPECT_EQ(2u, reopened.size());
+    EXPECT_EQ(T0 + 40 * KnownDeviceRegistry::TouchGranularity, reopened.find("a")->lastSeen);
+}
+
+TEST_F(KnownDeviceRegistryTest, IgnoresATornLastLine) {
+    {
+        KnownDeviceRegistry registry(writeFile);
+        ASSERT_TRUE(registry.open(m_path));
+        registry.touch("kept", "", T0);
+    }
+    {
+        std::ofstream file(m_path, std::ios::binary | std::ios::app);
+        file << "+\tpartial\t17000";
+    }
+    
+    KnownDeviceRegistry registry(writeFile);
+    ASSERT_TRUE(registry.open(m_path));
+    EXPECT_TRUE(registry.contains("kept"));
+    EXPECT_FALSE(registry.contains("partial"));
+    
+    // The torn line is gone, so the next record starts on its own line
+    registry.touch("next", "", T0 + 1s);
+    std::string content = readFile(m_path);
+    EXPECT_EQ(std::string::npos, content.find("partial"));
+    EXPECT_NE(std::string::npos, content.find("\n+\tnext\t"));
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "core/latency_histogram.h"
+#include <chrono>
+#include <string>
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+TEST(LatencyHistogramTest, BucketsCoverTheirRangeWithoutGaps) {
+    uint64_t expectedLowest = 0;
+    for (size_t i = 0; i < LatencyHistogram::BucketCount; ++i) {
+        ASSERT_EQ(expectedLowest, LatencyHistogram::bucketLowest(i)) << "bucket " << i;
+        ASSERT_EQ(i, LatencyHistogram::bucketIndex(LatencyHistogram::bucketLowest(i)));
+        ASSERT_EQ(i, LatencyHistogram::bucketIndex(LatencyHistogram::bucketHighest(i)));
+        expectedLowest = LatencyHistogram::bucketHighest(i) + 1;
+    }
+    
+    // Out of range values land in the last bucket
+    EXPECT_EQ(LatencyHistogram::BucketCount - 1, LatencyHistogram::bucketIndex(UINT64_MAX));
+}
+
+TEST(LatencyHistogramTest, PercentilesStayWithinRelativeError) {
+    LatencyHistogram histogram;
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.record(microseconds(i * 100));
+    }
+    
+    EXPECT_EQ(1000u, histogram.count());
+    EXPECT_EQ(microseconds(100), histogram.min());
+    EXPECT_EQ(microseconds(100000), histogram.max());
+    EXPECT_EQ(microseconds(50050), histogram.mean());
+    
+    const double percents[] = {50.0, 90.0, 99.0};
+    const int64_t exact[] = {50000, 90000, 99000};
+    for (int i = 0; i < 3; ++i) {
+        int64_t reported = histogram.percentile(percents[i]).count();
+        EXPECT_GE(reported, exact[i]);
+        EXPECT_LE(reported, exact[i] + exact[i] / 32);
+    }
+    EXPECT_EQ(histogram.max(), histogram.percentile(100.0));
+}
+
+TEST(LatencyHistogramTest, EmptyAndNegativeSamples) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(microseconds(0), histogram.percentile(99.0));
+    EXPECT_EQ(microseconds(0), histogram.min());
+    
+    histogram.record(microseconds(-5));
+    EXPECT_EQ(1u, histogram.count());
+    EXPECT_EQ(microseconds(0), histogram.max());
+    
+    histogram.reset();
+    EXPECT_EQ(0u, histogram.count());
+}
+
+TEST(TransitionLatencyTrackerTest, RecordsEachStageAndTotal) {
+    using Tracker = TransitionLatencyTracker;
+    Tracker tracker;
+    
+    Tracker::Timeline timeline;
+    timeline.detected = Tracker::Clock::now();
+    timeline.delivered = timeline.detected + milliseconds(300);
+    timeline.issued = timeline.delivered + milliseconds(1);
+    timeline.acknowledged = timeline.issued + milliseconds(20);
+    tracker.record(Tracker::Direction::Off, timeline);
+    
+    EXPECT_EQ(milliseconds(300), tracker.histogram(Tracker::Direction::Off, Tracker::Stage::Delivery).max());
+    EXPECT_EQ(milliseconds(1), tracker.histogram(Tracker::Direction::Off, Tracker::Stage::Dispatch).max());
+    EXPECT_EQ(milliseconds(20), tracker.histogram(Tracker::Direction::Off, Tracker::Stage::Command).max());
+    EXPECT_EQ(milliseconds(321), tracker.histogram(Tracker::Direction::Off, Tracker::Stage::Total).max());
+    EXPECT_EQ(0u, tracker.histogram(Tracker::Direction::On, Tracker::Stage::Total).count());
+    
+    // Without a kernel timestamp only the later stages are known
+    timeline.detected = Tracker::Clock::time_point();
+    tracker.record(Tracker::Direction::On, timeline);
+    EXPECT_EQ(0u, tracker.histogram(Tracker::Direction::On, Tracker::Stage::Total).count());
+    EXPECT_EQ(1u, tracker.histogram(Tracker::Direction::On, Tracker::Stage::Command).count());
+    
+    std::string json = tracker.toJson();
+    EXPECT_NE(std::string::npos, json.find("\"off\":{\"delivery\":{\"count\":1"));
+    EXPECT_NE(std::string::npos, json.find("\"total\":{\"count\":1,\"min\":321000"));
+}
+
+TEST(TransitionLatencyTrackerTest, RecordsLeadOfHintedReconnect) {
+    using Tracker = TransitionLatencyTracker;
+    Tracker tracker;
+    
+    Tracker::Timeline timeline;
+    timeline.detected = Tracker::Clock::now();
+    timeline.delivered = timeline.detected + milliseconds(300);
+    tracker.record(Tracker::Direction::On, timeline);
+    EXPECT_EQ(0u, tracker.histogram(Tracker::Direction::On, Tracker::Stage::Lead).count());
+    
+    timeline.hinted = timeline.detected - milliseconds(40);
+    tracker.record(Tracker::Direction::On, timeline);
+    EXPECT_EQ(1u, tracker.histogram(Tracker::Direction::On, Tracker::Stage::Lead).count());
+    EXPECT_EQ(milliseconds(40), tracker.histogram(Tracker::Direction::On, Tracker::Stage::Lead).max());
+    EXPECT_NE(std::string::npos, tracker.toJson().find("\"early on\":{"));
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include "core/logger.h"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Collects what a logger writes to the console and to the UI
+struct Capture {
+    std::mutex mutex;
+    std::vector<std::string> batches;
+    std::vector<std::string> uiMessages;
+    
+    explicit Capture(Logger& logger) {
+        logger.setConsoleSink([this](const std::string& text) {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.push_back(text);
+        });
+        logger.setUiSink([this](std::vector<Logger::Entry> entries) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Logger::Entry& entry : entries) {
+                uiMessages.push_back(entry.message);
+            }
+        });
+    }
+    
+    std::string text() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string all;
+        for (const std::string& batch : batches) {
+            all += batch;
+        }
+        return all;
+    }
+};
+
+int countLines(const std::string& text) {
+    int lines = 0;
+    for (char c : text) {
+        lines += c == '\n';
+    }
+    return lines;
+}
+
+} // namespace
+
+TEST(LoggerTest, WritesABurstAsOneBatch) {
+    Logger logger;
+    Capture capture(logger);
+    logger.setLevel(LogLevel::Debug);
+    
+    EXPECT_TRUE(logger.write(LogLevel::Debug, "CONFIG", "one"));
+    EXPECT_TRUE(logger.write(LogLevel::Info, "CONFIG", "two"));
+    EXPECT_TRUE(logger.write(LogLevel::Error, "DISPLAY", "three"));
+    logger.flush();
+    
+    ASSERT_EQ(1u, capture.batches.size());
+    EXPECT_EQ("[CONFIG] one\n[CONFIG] two\n[DISPLAY] Error: three\n", capture.batches[0]);
+    EXPECT_EQ((std::vector<std::string>{"two", "three"}), capture.uiMessages);
+}
+
+TEST(LoggerTest, FlushesInTheBackground) {
+    Logger logger;
+    Capture capture(logger);
+    logger.write(LogLevel::Info, "APP", "hello");
+    
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (capture.text().empty() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(5ms);
+    }
+    EXPECT_EQ("[APP] hello\n", capture.text());
+}
+
+TEST(LoggerTest, DropsAndCountsWhenFull) {
+    Logger logger(4);
+    Capture capture(logger);
+    
+    // Written faster than the 50 ms batching delay lets the ring drain
+    int written = 0;
+    for (int i = 0; i < 6; ++i) {
+        written += logger.write(LogLevel::Info, "APP", std::to_string(i)) ? 1 : 0;
+    }
+    EXPECT_EQ(4, written);
+    EXPECT_EQ(2u, logger.droppedCount());
+    
+    logger.flush();
+    EXPECT_EQ("[APP] 0\n[APP] 1\n[APP] 2\n[APP] 3\n[LOG] 2 messages dropped\n", capture.text());
+}
+
+TEST(LoggerTest, KeepsEveryMessageFromConcurrentWriters) {
+    const int threads = 4;
+    const int perThread = 2000;
+    Logger logger(threads * perThread);
+    Capture capture(logger);
+    
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t) {
+        writers.emplace_back([&logger, t]() {
+            for (int i = 0; i < perThread; ++i) {
+                logger.write(LogLevel::Info, "USB", std::to_string(t) + ":" + std::to_string(i));
+            }
+        });
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    logger.flush();
+    
+    EXPECT_EQ(0u, logger.droppedCount());
+    EXPECT_EQ(threads * perThread, countLines(capture.text()));
+    std::lock_guard<std::mutex> lock(capture.mutex);
+    EXPECT_EQ(static_cast<size_t>(threads * perThread), capture.uiMessages.size());
+}
+
+TEST(LoggerTest, DisabledLevelsAreNotFormatted) {
+    Logger& logger = Logger::instance();
+    LogLevel saved = logger.level();
+    logger.setLevel(LogLevel::Warning);
+    
+    int formatted = 0;
+    auto expensive = [&formatted]() {
+        ++formatted;
+        return std::string("value");
+    };
+    LOG_DEBUG("TEST", "debug " << expensive());
+    LOG_INFO("TEST", "info " << expensive());
+    EXPECT_EQ(0, formatted);
+    
+    logger.setConsoleSink(nullptr);
+    LOG_WARNING("TEST", "warning " << expensive());
+    EXPECT_EQ(1, formatted);
+    logger.flush();
+    
+    logger.setConsoleSink([](const std::string& text) { std::cout << text << std::flush; });
+    logger.setLevel(saved);
+}
+
+TEST(LoggerTest, ParsesLevelNames) {
+    LogLevel level = LogLevel::Info;
+    EXPECT_TRUE(Logger::parseLevel("debug", level));
+    EXPECT_EQ(LogLevel::Debug, level);
+    EXPECT_TRUE(Logger::parseLevel("off", level));
+    EXPECT_EQ(LogLevel::Off, level);
+    EXPECT_FALSE(Logger::parseLevel("verbose", level));
+    EXPECT_EQ(LogLevel::Off, level);
+}
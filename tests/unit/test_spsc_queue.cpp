@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "core/spsc_queue.h"
+#include <string>
+#include <thread>
+
+TEST(SpscQueueTest, PreservesOrder) {
+    SpscQueue<std::string> queue(4);
+    EXPECT_TRUE(queue.tryPush("a"));
+    EXPECT_TRUE(queue.tryPush("b"));
+    
+    std::string value;
+    ASSERT_TRUE(queue.tryPop(value));
+    EXPECT_EQ("a", value);
+    ASSERT_TRUE(queue.tryPop(value));
+    EXPECT_EQ("b", value);
+    EXPECT_FALSE(queue.tryPop(value));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueueTest, RejectsWhenFull) {
+    SpscQueue<int> queue(3);
+    ASSERT_EQ(4u, queue.capacity());
+    
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.tryPush(int(i)));
+    }
+    EXPECT_FALSE(queue.tryPush(99));
+    
+    int value = -1;
+    ASSERT_TRUE(queue.tryPop(value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(queue.tryPush(4));
+}
+
+TEST(SpscQueueTest, TransfersAcrossThreads) {
+    constexpr int count = 100000;
+    SpscQueue<int> queue(64);
+    
+    std::thread producer([&queue]() {
+        for (int i = 0; i < count; ++i) {
+            while (!queue.tryPush(int(i))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    
+    int expected = 0;
+    int value = 0;
+    while (expected < count) {
+        if (queue.tryPop(value)) {
+            ASSERT_EQ(expected, value);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(queue.empty());
+}
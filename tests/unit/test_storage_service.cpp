@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+#include "services/storage/storage_service.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Points the storage directory at a fresh temporary home
+class StorageServiceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        const char* home = getenv("HOME");
+        m_savedHome = home ? home : "";
+        const char* xdgConfig = getenv("XDG_CONFIG_HOME");
+        m_savedXdgConfig = xdgConfig ? xdgConfig : "";
+        unsetenv("XDG_CONFIG_HOME");
+        char dir[] = "/tmp/monitorswitch-storage-XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(dir));
+        m_home = dir;
+        setenv("HOME", dir, 1);
+    }
+    
+    void TearDown() override {
+        setenv("HOME", m_savedHome.c_str(), 1);
+        if (!m_savedXdgConfig.empty()) {
+            setenv("XDG_CONFIG_HOME", m_savedXdgConfig.c_str(), 1);
+        }
+        std::filesystem::remove_all(m_home);
+    }
+    
+    std::string readConfig(StorageService& storage) {
+        std::ifstream file(storage.getAppDataPath() + "/config.toml");
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+    
+    std::string m_home;
+    std::string m_savedHome;
+    std::string m_savedXdgConfig;
+};
+
+// Configurations reported by the file watcher
+struct Reloads {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<AppConfig> configs;
+    
+    StorageService::ConfigChangedCallback callback() {
+        return [this](const AppConfig& config) {
+            std::lock_guard<std::mutex> lock(mutex);
+            configs.push_back(config);
+            changed.notify_all();
+        };
+    }
+    
+    size_t waitFor(size_t count, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait_for(lock, timeout, [this, count]() { return configs.size() >= count; });
+        return configs.size();
+    }
+};
+
+AppConfig configWithDelay(int delay) {
+    AppConfig config;
+    config.screenOffDelay = delay;
+    return config;
+}
+
+} // namespace
+
+TEST_F(StorageServiceTest, CoalescesChangesIntoOneWrite) {
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    storage.setSaveDelay(std::chrono::hours(1));
+    
+    for (int delay = 1; delay <= 50; ++delay) {
+        storage.saveConfigDeferred(configWithDelay(delay));
+    }
+    EXPECT_EQ("", readConfig(storage));
+    
+    EXPECT_TRUE(storage.flush());
+    EXPECT_NE(std::string::npos, readConfig(storage).find("screenOffDelay = 50\n"));
+    EXPECT_EQ(50, storage.loadConfig().screenOffDelay);
+}
+
+TEST_F(StorageServiceTest, WritesAfterTheDelayWithoutTemporaryFiles) {
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    storage.setSaveDelay(10ms);
+    storage.saveConfigDeferred(configWithDelay(42));
+    
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (readConfig(storage).empty() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(5ms);
+    }
+    EXPECT_EQ(42, storage.loadConfig().screenOffDelay);
+    
+    storage.shutdown();  // the device list may still be on its way
+    for (const auto& entry : std::filesystem::directory_iterator(storage.getAppDataPath())) {
+        EXPECT_NE(".tmp", entry.path().extension().string()) << entry.path();
+    }
+}
+
+TEST_F(StorageServiceTest, ShutdownFlushesPendingChanges) {
+    {
+        StorageService storage;
+        ASSERT_TRUE(storage.initialize());
+        storage.setSaveDelay(std::chrono::hours(1));
+        storage.saveConfigDeferred(configWithDelay(7));
+        storage.shutdown();
+        EXPECT_EQ(7, storage.loadConfig().screenOffDelay);
+    }
+    
+    // The destructor flushes too
+    {
+        StorageService storage;
+        ASSERT_TRUE(storage.initialize());
+        storage.setSaveDelay(std::chrono::hours(1));
+        storage.saveConfigDeferred(configWithDelay(8));
+    }
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    EXPECT_EQ(8, storage.loadConfig().screenOffDelay);
+}
+
+TEST_F(StorageServiceTest, MigratesLegacyFiles) {
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    std::string dir = storage.getAppDataPath();
+    std::ofstream(dir + "/config.ini") << "# old format\nscreenOffDelay=12\noutput.dev1=HDMI-1,DP-2\n";
+    std::ofstream(dir + "/devices.txt") << "# Known USB Devices\ndev1\ndev2\n";
+    
+    AppConfig config = storage.loadConfig();
+    EXPECT_EQ(12, config.screenOffDelay);
+    EXPECT_EQ((std::vector<std::string>{"HDMI-1", "DP-2"}), config.deviceOutputs["dev1"]);
+    EXPECT_EQ((std::vector<std::string>{"dev1", "dev2"}), storage.loadDeviceList());
+    
+    EXPECT_FALSE(std::filesystem::exists(dir + "/config.ini"));
+    EXPECT_TRUE(std::filesystem::exists(dir + "/config.ini.bak"));
+    EXPECT_TRUE(std::filesystem::exists(dir + "/devices.txt.bak"));
+    
+    // Known devices now live in the registry journal
+    EXPECT_TRUE(storage.removeKnownDevice("dev1"));
+    EXPECT_TRUE(storage.addKnownDevice("dev3", "Keyboard"));
+    StorageService restarted;
+    ASSERT_TRUE(restarted.initialize());
+    EXPECT_EQ(12, restarted.loadConfig().screenOffDelay);
+    EXPECT_EQ((std::vector<std::string>{"dev2", "dev3"}), restarted.loadDeviceList());
+    EXPECT_EQ("Keyboard", restarted.knownDevices().find("dev3")->friendlyName);
+}
+
+TEST_F(StorageServiceTest, SetsAsideAnInvalidFile) {
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    std::string path = storage.getAppDataPath() + "/config.toml";
+    std::ofstream(path) << "[settings]\nselectedDeviceId = \"open\n";
+    
+    EXPECT_EQ(AppConfig().screenOffDelay, storage.loadConfig().screenOffDelay);
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_TRUE(std::filesystem::exists(path + ".invalid"));
+}
+
+#ifdef PLATFORM_LINUX
+
+TEST_F(StorageServiceTest, AppliesExternalEdits) {
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    storage.loadConfig();
+    std::string path = storage.getAppDataPath() + "/config.toml";
+    ASSERT_TRUE(std::filesystem::exists(path));
+    
+    Reloads reloads;
+    ASSERT_TRUE(storage.startWatching(reloads.callback()));
+    std::ofstream(path) << "# managed elsewhere\n[settings]\nscreenOffDelay = 33\nselectedDeviceId = \"dev1\"\n";
+    ASSERT_EQ(1u, reloads.waitFor(1, 2s));
+    EXPECT_EQ(33, reloads.configs[0].screenOffDelay);
+    EXPECT_EQ("dev1", reloads.configs[0].selectedDeviceId);
+    
+    // Saving the same settings leaves the edited file alone
+    EXPECT_TRUE(storage.saveConfig(reloads.configs[0]));
+    EXPECT_NE(std::string::npos, readConfig(storage).find("# managed elsewhere\n"));
+    
+    // The service's own saves are not reported back
+    AppConfig changed = reloads.configs[0];
+    changed.screenOffDelay = 34;
+    EXPECT_TRUE(storage.saveConfig(changed));
+    EXPECT_EQ(1u, reloads.waitFor(2, 300ms));
+    storage.stopWatching();
+}
+
+TEST_F(StorageServiceTest, EditsReplacePendingSaves) {
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    storage.loadConfig();
+    storage.setSaveDelay(std::chrono::hours(1));
+    
+    Reloads reloads;
+    ASSERT_TRUE(storage.startWatching(reloads.callback()));
+    storage.saveConfigDeferred(configWithDelay(5));
+    std::ofstream(storage.getAppDataPath() + "/config.toml") << "[settings]\nscreenOffDelay = 6\n";
+    ASSERT_EQ(1u, reloads.waitFor(1, 2s));
+    
+    storage.shutdown();
+    EXPECT_EQ(6, storage.loadConfig().screenOffDelay);
+}
+
+TEST_F(StorageServiceTest, DeferredSaveDoesNotOverwriteAnUnreadEdit) {
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    storage.loadConfig();
+    storage.setSaveDelay(std::chrono::hours(1));
+    
+    Reloads reloads;
+    ASSERT_TRUE(storage.startWatching(reloads.callback()));
+    storage.saveConfigDeferred(configWithDelay(5));
+    
+    // The save comes due while the watcher waits for the edit to settle
+    std::ofstream(storage.getAppDataPath() + "/config.toml") << "[settings]\nscreenOffDelay = 6\n";
+    EXPECT_TRUE(storage.flush());
+    EXPECT_EQ("[settings]\nscreenOffDelay = 6\n", readConfig(storage));
+    
+    ASSERT_EQ(1u, reloads.waitFor(1, 2s));
+    EXPECT_EQ(6, reloads.configs[0].screenOffDelay);
+    storage.stopWatching();
+}
+
+TEST_F(StorageServiceTest, LeavesAnInvalidEditAlone) {
+    StorageService storage;
+    ASSERT_TRUE(storage.initialize());
+    storage.loadConfig();
+    std::string path = storage.getAppDataPath() + "/config.toml";
+    
+    Reloads reloads;
+    ASSERT_TRUE(storage.startWatching(reloads.callback()));
+    std::ofstream(path) << "[settings]\nscreenOffDelay = \n";
+    EXPECT_EQ(0u, reloads.waitFor(1, 300ms));
+    storage.stopWatching();
+    
+    EXPECT_EQ("[settings]\nscreenOffDelay = \n", readConfig(storage));
+    EXPECT_FALSE(std::filesystem::exists(path + ".invalid"));
+}
+
+#endif // PLATFORM_LINUX
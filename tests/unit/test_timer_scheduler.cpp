@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "core/timer_scheduler.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Collects task output and lets the test wait for a number of runs
+struct RunLog {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::string> entries;
+    
+    void add(const std::string& entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(entry);
+        changed.notify_all();
+    }
+    
+    bool waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, 2s, [&] { return entries.size() >= count; });
+    }
+};
+
+} // namespace
+
+TEST(TimerSchedulerTest, RunsTasksInDeadlineOrder) {
+    TimerScheduler scheduler;
+    RunLog log;
+    
+    scheduler.schedule(30ms, [&] { log.add("late"); });
+    scheduler.schedule(10ms, [&] { log.add("early"); });
+    scheduler.schedule(20ms, [&] { log.add("middle"); });
+    
+    ASSERT_TRUE(log.waitFor(3));
+    EXPECT_EQ((std::vector<std::string>{"early", "middle", "late"}), log.entries);
+    EXPECT_EQ(0u, scheduler.pending());
+}
+
+TEST(TimerSchedulerTest, CancelledTaskNeverRuns) {
+    TimerScheduler scheduler;
+    RunLog log;
+    
+    TimerScheduler::Token cancelled = scheduler.schedule(10ms, [&] { log.add("cancelled"); });
+    scheduler.schedule(30ms, [&] { log.add("kept"); });
+    
+    EXPECT_TRUE(scheduler.cancel(cancelled));
+    EXPECT_FALSE(scheduler.cancel(cancelled));
+    
+    ASSERT_TRUE(log.waitFor(1));
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ((std::vector<std::string>{"kept"}), log.entries);
+}
+
+TEST(TimerSchedulerTest, StaleTokenCannotCancelNewerTimer) {
+    TimerScheduler scheduler;
+    RunLog log;
+    
+    TimerScheduler::Token first = scheduler.schedule(1ms, [&] { log.add("first"); });
+    ASSERT_TRUE(log.waitFor(1));
+    
+    // The first timer already fired; its token must not reach the second one
+    scheduler.schedule(10ms, [&] { log.add("second"); });
+    EXPECT_FALSE(scheduler.cancel(first));
+    EXPECT_FALSE(scheduler.cancel(TimerScheduler::Token()));
+    
+    ASSERT_TRUE(log.waitFor(2));
+    EXPECT_EQ("second", log.entries[1]);
+}
+
+TEST(TimerSchedulerTest, EarlierTimerWakesSleepingThread) {
+    TimerScheduler scheduler;
+    RunLog log;
+    
+    scheduler.schedule(10s, [&] { log.add("distant"); });
+    auto start = std::chrono::steady_clock::now();
+    scheduler.schedule(5ms, [&] { log.add("soon"); });
+    
+    ASSERT_TRUE(log.waitFor(1));
+    EXPECT_EQ("soon", log.entries[0]);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+    
+    // Stopping drops the distant timer without waiting for it
+    scheduler.stop();
+    EXPECT_EQ(0u, scheduler.pending());
+    EXPECT_EQ(1u, log.entries.size());
+}
+
+TEST(TimerSchedulerTest, TasksMayRescheduleThemselves) {
+    TimerScheduler scheduler;
+    std::atomic<int> runs{0};
+    RunLog log;
+    
+    std::function<void()> tick = [&] {
+        if (++runs < 3) {
+            scheduler.schedule(1ms, tick);
+        } else {
+            log.add("done");
+        }
+    };
+    scheduler.schedule(1ms, tick);
+    
+    ASSERT_TRUE(log.waitFor(1));
+    EXPECT_EQ(3, runs.load());
+}
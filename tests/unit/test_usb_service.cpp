@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "services/usb/usb_service.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// Stands in for the platform file: the event delivery shared by every
+// platform (usb_service_common.cpp) runs over a scripted device list, with a
+// one-slot queue so that any backlog overflows it
+
+namespace {
+
+std::mutex attachedMutex;
+std::set<std::string> attached;
+std::atomic<int> scansRequested(0);
+std::atomic<int> scansDone(0);
+std::atomic<int> toggles(0);  // scans that first flip one of four devices
+
+std::string deviceId(int n) {
+    return "USB_VID_046d&PID_" + std::to_string(1000 + n);
+}
+
+void setAttached(const std::string& id, bool present) {
+    std::lock_guard<std::mutex> lock(attachedMutex);
+    if (present) {
+        attached.insert(id);
+    } else {
+        attached.erase(id);
+    }
+}
+
+} // namespace
+
+UsbService::UsbService()
+    : m_hiddenWindow(nullptr), m_deviceNotification(nullptr), m_snapshotStale(false),
+      m_matchPolicy(DeviceMatchPolicy::Exact), m_isMonitoring(false),
+      m_eventQueue(1), m_dispatchPending(false),
+      m_resyncPending(false), m_resyncWatched(false), m_resyncWatchedBefore(false),
+      m_monitorMode(MonitorMode::Polling), m_udev(nullptr), m_udevMonitor(nullptr), m_kernelMonitor(nullptr),
+      m_wakeFd(-1), m_scanGeneration(0) {
+}
+
+UsbService::~UsbService() {
+    stopMonitoring();
+}
+
+void UsbService::enumerateUsbDevices(std::vector<UsbDevice>& devices) {
+    std::lock_guard<std::mutex> lock(attachedMutex);
+    for (const std::string& id : attached) {
+        devices.emplace_back(m_stringPool, id, "Device");
+    }
+}
+
+bool UsbService::startMonitoring() {
+    m_isMonitoring = true;
+    refreshDeviceSet(false);
+    
+    m_monitorThread = std::thread([this]() {
+        enterMonitorThread();
+        int toggled = 0;
+        while (m_isMonitoring) {
+            if (toggled < toggles) {
+                std::string id = deviceId(toggled++ % 4);
+                bool present;
+                {
+                    std::lock_guard<std::mutex> lock(attachedMutex);
+                    present = attached.count(id) != 0;
+                }
+                setAttached(id, !present);
+                refreshDeviceSet();
+                ++scansDone;
+            } else if (scansDone < scansRequested) {
+                refreshDeviceSet();
+                ++scansDone;
+            } else {
+                std::this_thread::sleep_for(100us);
+            }
+        }
+    });
+    return true;
+}
+
+void UsbService::stopMonitoring() {
+    joinMonitorThread();
+}
+
+class UsbServiceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        attached.clear();
+        scansRequested = 0;
+        scansDone = 0;
+        toggles = 0;
+        
+        usb.setOnDevicesChanged([this](const DeviceDelta& delta) {
+            for (const auto& device : delta.added) {
+                events.push_back("+" + device.deviceId());
+            }
+            for (const auto& device : delta.removed) {
+                events.push_back("-" + device.deviceId());
+            }
+        });
+        usb.setEventNotifier([]() {});
+        ASSERT_TRUE(usb.startMonitoring());
+    }
+    
+    void scan() {
+        ++scansRequested;
+        while (scansDone < scansRequested) {
+            std::this_thread::sleep_for(100us);
+        }
+    }
+    
+    UsbService usb;
+    std::vector<std::string> events;
+};
+
+TEST_F(UsbServiceTest, OverflowIsReportedOnceAfterTheQueuedEvents) {
+    setAttached(deviceId(0), true);
+    scan();  // fills the queue
+    setAttached(deviceId(1), true);
+    scan();  // overflows it
+    setAttached(deviceId(0), false);
+    scan();  // joins the pending resync
+    
+    usb.dispatchPendingEvents();
+    EXPECT_EQ((std::vector<std::string>{"+" + deviceId(0), "+" + deviceId(1), "-" + deviceId(0)}), events);
+    
+    // The queue is in use again afterwards
+    events.clear();
+    setAttached(deviceId(2), true);
+    scan();
+    usb.dispatchPendingEvents();
+    EXPECT_EQ((std::vector<std::string>{"+" + deviceId(2)}), events);
+}
+
+TEST_F(UsbServiceTest, ListenersFollowTheDeviceSetWhileOverflowing) {
+    const int total = 2000;
+    toggles = total;
+    while (scansDone < total) {
+        usb.dispatchPendingEvents();
+    }
+    usb.dispatchPendingEvents();
+    
+    // Replaying the events never adds a device twice or removes an absent one
+    std::set<std::string> known;
+    for (const std::string& event : events) {
+        std::string id = event.substr(1);
+        if (event[0] == '+') {
+            EXPECT_TRUE(known.insert(id).second) << "duplicate " << event;
+        } else {
+            EXPECT_EQ(1u, known.erase(id)) << "duplicate " << event;
+        }
+    }
+    EXPECT_EQ(attached, known);
+}
@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include "services/display/display_backends_linux.h"
+#include <cstdlib>
+
+// Runs against a compositor implementing wlr-output-power-management, e.g.
+// WLR_BACKENDS=headless sway; skipped everywhere else
+TEST(WaylandOutputPowerBackendTest, SwitchesOutputsAndReportsModes) {
+    if (!getenv("WAYLAND_DISPLAY")) {
+        GTEST_SKIP() << "No Wayland session";
+    }
+    
+    WaylandOutputPowerBackend backend;
+    if (!backend.isAvailable()) {
+        GTEST_SKIP() << "Compositor lacks wlr-output-power-management";
+    }
+    EXPECT_GE(backend.notificationFd(), 0);
+    EXPECT_TRUE(backend.reportsAllChanges());
+    
+    bool on = true;
+    ASSERT_TRUE(backend.setPower(false));
+    ASSERT_TRUE(backend.queryPower(on));
+    EXPECT_FALSE(on);
+    
+    ASSERT_TRUE(backend.setPower(true));
+    ASSERT_TRUE(backend.queryPower(on));
+    EXPECT_TRUE(on);
+}